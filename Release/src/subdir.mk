@@ -4,7 +4,15 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
+../src/ArrowBatch.cpp \
+../src/ArrowWriter.cpp \
+../src/ColumnIterator.cpp \
 ../src/CommandBuffer.cpp \
+../src/DictionaryProvider.cpp \
+../src/FileDictionaryProvider.cpp \
+../src/FormatterBuffer.cpp \
+../src/FormatterPool.cpp \
+../src/FormatterThread.cpp \
 ../src/KafkaWriter.cpp \
 ../src/MemoryException.cpp \
 ../src/OpCode.cpp \
@@ -26,22 +34,35 @@ CPP_SRCS += \
 ../src/OpCode1801.cpp \
 ../src/OpenLogReplicator.cpp \
 ../src/OracleColumn.cpp \
+../src/OracleDictionaryProvider.cpp \
+../src/OracleNumber.cpp \
 ../src/OracleObject.cpp \
 ../src/OracleReader.cpp \
 ../src/OracleReaderRedo.cpp \
 ../src/OracleStatement.cpp \
+../src/OutputCursor.cpp \
 ../src/RedoLogException.cpp \
 ../src/RedoLogRecord.cpp \
+../src/RowFilter.cpp \
 ../src/Thread.cpp \
 ../src/Transaction.cpp \
 ../src/TransactionBuffer.cpp \
 ../src/TransactionChunk.cpp \
 ../src/TransactionHeap.cpp \
 ../src/TransactionMap.cpp \
+../src/TransactionXidMap.cpp \
 ../src/Writer.cpp 
 
 OBJS += \
+./src/ArrowBatch.o \
+./src/ArrowWriter.o \
+./src/ColumnIterator.o \
 ./src/CommandBuffer.o \
+./src/DictionaryProvider.o \
+./src/FileDictionaryProvider.o \
+./src/FormatterBuffer.o \
+./src/FormatterPool.o \
+./src/FormatterThread.o \
 ./src/KafkaWriter.o \
 ./src/MemoryException.o \
 ./src/OpCode.o \
@@ -63,22 +84,35 @@ OBJS += \
 ./src/OpCode1801.o \
 ./src/OpenLogReplicator.o \
 ./src/OracleColumn.o \
+./src/OracleDictionaryProvider.o \
+./src/OracleNumber.o \
 ./src/OracleObject.o \
 ./src/OracleReader.o \
 ./src/OracleReaderRedo.o \
 ./src/OracleStatement.o \
+./src/OutputCursor.o \
 ./src/RedoLogException.o \
 ./src/RedoLogRecord.o \
+./src/RowFilter.o \
 ./src/Thread.o \
 ./src/Transaction.o \
 ./src/TransactionBuffer.o \
 ./src/TransactionChunk.o \
 ./src/TransactionHeap.o \
 ./src/TransactionMap.o \
+./src/TransactionXidMap.o \
 ./src/Writer.o 
 
 CPP_DEPS += \
+./src/ArrowBatch.d \
+./src/ArrowWriter.d \
+./src/ColumnIterator.d \
 ./src/CommandBuffer.d \
+./src/DictionaryProvider.d \
+./src/FileDictionaryProvider.d \
+./src/FormatterBuffer.d \
+./src/FormatterPool.d \
+./src/FormatterThread.d \
 ./src/KafkaWriter.d \
 ./src/MemoryException.d \
 ./src/OpCode.d \
@@ -100,18 +134,23 @@ CPP_DEPS += \
 ./src/OpCode1801.d \
 ./src/OpenLogReplicator.d \
 ./src/OracleColumn.d \
+./src/OracleDictionaryProvider.d \
+./src/OracleNumber.d \
 ./src/OracleObject.d \
 ./src/OracleReader.d \
 ./src/OracleReaderRedo.d \
 ./src/OracleStatement.d \
+./src/OutputCursor.d \
 ./src/RedoLogException.d \
 ./src/RedoLogRecord.d \
+./src/RowFilter.d \
 ./src/Thread.d \
 ./src/Transaction.d \
 ./src/TransactionBuffer.d \
 ./src/TransactionChunk.d \
 ./src/TransactionHeap.d \
 ./src/TransactionMap.d \
+./src/TransactionXidMap.d \
 ./src/Writer.d 
 
 
@@ -0,0 +1,456 @@
+/* Columnar batches written as Apache Arrow IPC streams
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <iostream>
+#include <string.h>
+#include "ArrowBatch.h"
+#include "CommandBuffer.h"
+#include "MemoryException.h"
+#include "OracleColumn.h"
+#include "OracleObject.h"
+
+using namespace std;
+
+namespace OpenLogReplicator {
+
+    //data: name length, name, field count, field types and the IPC schema message
+    ArrowBatch::ArrowBatch(const uint8_t *data, uint64_t length) :
+        fieldCnt(0),
+        types(nullptr),
+        validity(nullptr),
+        offsets(nullptr),
+        values(nullptr),
+        nullCnt(nullptr),
+        rows(0),
+        startTime(0),
+        firstScn(0) {
+
+        uint16_t nameLength;
+        memcpy(&nameLength, data, sizeof(uint16_t));
+        name.assign((const char*)data + 2, nameLength);
+        data += 2 + nameLength;
+
+        uint16_t fields;
+        memcpy(&fields, data, sizeof(uint16_t));
+        fieldCnt = fields;
+        data += 2;
+
+        types = new uint8_t[fieldCnt];
+        validity = new vector<uint8_t>[fieldCnt];
+        offsets = new vector<uint8_t>[fieldCnt];
+        values = new vector<uint8_t>[fieldCnt];
+        nullCnt = new uint64_t[fieldCnt];
+        if (types == nullptr || validity == nullptr || offsets == nullptr || values == nullptr || nullCnt == nullptr) {
+            cerr << "ERROR: could not allocate memory for Arrow batch (" << dec << fieldCnt << " fields)" << endl;
+            throw MemoryException("out of memory");
+        }
+
+        memcpy(types, data, fieldCnt);
+        data += fieldCnt;
+        schema.assign((const char*)data, length - 4 - nameLength - fieldCnt);
+
+        for (uint64_t i = 0; i < fieldCnt; ++i) {
+            nullCnt[i] = 0;
+            if (fixedWidth(types[i]) == 0)
+                offsets[i].resize(4, 0);
+        }
+    }
+
+    ArrowBatch::~ArrowBatch() {
+        if (types != nullptr) {
+            delete[] types;
+            types = nullptr;
+        }
+        if (validity != nullptr) {
+            delete[] validity;
+            validity = nullptr;
+        }
+        if (offsets != nullptr) {
+            delete[] offsets;
+            offsets = nullptr;
+        }
+        if (values != nullptr) {
+            delete[] values;
+            values = nullptr;
+        }
+        if (nullCnt != nullptr) {
+            delete[] nullCnt;
+            nullCnt = nullptr;
+        }
+    }
+
+    uint64_t ArrowBatch::columnType(OracleColumn *column) {
+        switch (CommandBuffer::avroType(column)) {
+        case AVRO_TYPE_STRING:
+            return ARROW_TYPE_UTF8;
+        case AVRO_TYPE_LONG:
+            return ARROW_TYPE_INT64;
+        case AVRO_TYPE_DECIMAL:
+            return ARROW_TYPE_DECIMAL;
+        case AVRO_TYPE_TIMESTAMP_MILLIS:
+            return ARROW_TYPE_TIMESTAMP_MILLIS;
+        case AVRO_TYPE_TIMESTAMP_MICROS:
+            return ARROW_TYPE_TIMESTAMP_MICROS;
+        default:
+            return ARROW_TYPE_BINARY;
+        }
+    }
+
+    //0 - variable length value with offsets
+    uint64_t ArrowBatch::fixedWidth(uint64_t type) {
+        switch (type) {
+        case ARROW_TYPE_INT64:
+        case ARROW_TYPE_UINT64:
+        case ARROW_TYPE_TIMESTAMP_MILLIS:
+        case ARROW_TYPE_TIMESTAMP_MICROS:
+            return 8;
+        case ARROW_TYPE_DECIMAL:
+            return 16;
+        default:
+            return 0;
+        }
+    }
+
+    //FlatBuffers are built front to back: vtable, table and then the objects it refers to, so every offset points forward
+    uint64_t ArrowBatch::fbTable(string &fb, uint64_t fields, const uint64_t *sizes, uint64_t *pos) {
+        uint64_t vtableSize = 4 + 2 * fields, tableSize = 4, fieldOffset[8];
+
+        for (uint64_t i = 0; i < fields; ++i) {
+            if (sizes[i] == 0) {
+                fieldOffset[i] = 0;
+                continue;
+            }
+            tableSize = (tableSize + sizes[i] - 1) & ~(sizes[i] - 1);
+            fieldOffset[i] = tableSize;
+            tableSize += sizes[i];
+        }
+
+        //table is 8 byte aligned and follows its vtable
+        while (((fb.length() + vtableSize) & 7) != 0)
+            fb.append(1, 0);
+        uint64_t vtable = fb.length();
+        fb.append(vtableSize + tableSize, 0);
+        fbPut(fb, vtable, vtableSize, 2);
+        fbPut(fb, vtable + 2, tableSize, 2);
+        for (uint64_t i = 0; i < fields; ++i)
+            fbPut(fb, vtable + 4 + i * 2, fieldOffset[i], 2);
+
+        uint64_t table = vtable + vtableSize;
+        fbPut(fb, table, vtableSize, 4);
+        for (uint64_t i = 0; i < fields; ++i)
+            pos[i] = table + fieldOffset[i];
+        return table;
+    }
+
+    //elements of 4 or 16 bytes, structs of two longs are 8 byte aligned
+    uint64_t ArrowBatch::fbVector(string &fb, uint64_t count, uint64_t elementSize) {
+        uint64_t align = (elementSize >= 8) ? 8 : 4;
+        while (((fb.length() + 4) & (align - 1)) != 0 || (fb.length() & 3) != 0)
+            fb.append(1, 0);
+        uint64_t vector = fb.length();
+        fb.append(4 + count * elementSize, 0);
+        fbPut(fb, vector, count, 4);
+        return vector;
+    }
+
+    uint64_t ArrowBatch::fbString(string &fb, const string &str) {
+        while ((fb.length() & 3) != 0)
+            fb.append(1, 0);
+        uint64_t pos = fb.length();
+        fb.append(4, 0);
+        fbPut(fb, pos, str.length(), 4);
+        fb.append(str);
+        fb.append(1, 0);
+        return pos;
+    }
+
+    void ArrowBatch::fbPut(string &fb, uint64_t pos, uint64_t val, uint64_t size) {
+        for (uint64_t i = 0; i < size; ++i)
+            fb[pos + i] = (char)(val >> (i * 8));
+    }
+
+    void ArrowBatch::fbRef(string &fb, uint64_t pos, uint64_t target) {
+        fbPut(fb, pos, target - pos, 4);
+    }
+
+    //Field: name, nullable, type union, dictionary and children
+    void ArrowBatch::fbField(string &fb, uint64_t ref, const string &name, bool nullable, uint64_t type, OracleColumn *column) {
+        uint64_t sizes[6] = {4, 1, 1, 4, 0, 4}, pos[6];
+        uint64_t field = fbTable(fb, 6, sizes, pos);
+        fbRef(fb, ref, field);
+        if (nullable)
+            fbPut(fb, pos[1], 1, 1);
+
+        uint64_t typePos[3];
+        switch (type) {
+        case ARROW_TYPE_INT64:
+        case ARROW_TYPE_UINT64: {
+            //Int: bitWidth, is_signed
+            uint64_t intSizes[2] = {4, 1};
+            fbPut(fb, pos[2], 2, 1);
+            fbRef(fb, pos[3], fbTable(fb, 2, intSizes, typePos));
+            fbPut(fb, typePos[0], 64, 4);
+            if (type == ARROW_TYPE_INT64)
+                fbPut(fb, typePos[1], 1, 1);
+            break;
+        }
+
+        case ARROW_TYPE_DECIMAL: {
+            //Decimal: precision, scale, bitWidth
+            uint64_t decimalSizes[3] = {4, 4, 4};
+            fbPut(fb, pos[2], 7, 1);
+            fbRef(fb, pos[3], fbTable(fb, 3, decimalSizes, typePos));
+            fbPut(fb, typePos[0], column->precision, 4);
+            fbPut(fb, typePos[1], column->scale, 4);
+            fbPut(fb, typePos[2], 128, 4);
+            break;
+        }
+
+        case ARROW_TYPE_TIMESTAMP_MILLIS:
+        case ARROW_TYPE_TIMESTAMP_MICROS: {
+            //Timestamp: unit, no timezone as DATE and TIMESTAMP hold local time
+            uint64_t timestampSizes[2] = {2, 0};
+            fbPut(fb, pos[2], 10, 1);
+            fbRef(fb, pos[3], fbTable(fb, 2, timestampSizes, typePos));
+            fbPut(fb, typePos[0], type == ARROW_TYPE_TIMESTAMP_MILLIS ? 1 : 2, 2);
+            break;
+        }
+
+        case ARROW_TYPE_BINARY:
+            fbPut(fb, pos[2], 4, 1);
+            fbRef(fb, pos[3], fbTable(fb, 0, nullptr, typePos));
+            break;
+
+        default:
+            fbPut(fb, pos[2], 5, 1);
+            fbRef(fb, pos[3], fbTable(fb, 0, nullptr, typePos));
+        }
+
+        fbRef(fb, pos[0], fbString(fb, name));
+        fbRef(fb, pos[5], fbVector(fb, 0, 4));
+    }
+
+    //Message: version V5, header union and body length, the header is built after it, returns reference to the header
+    uint64_t ArrowBatch::fbMessage(string &fb, uint64_t headerType, uint64_t bodyLength) {
+        uint64_t sizes[4] = {2, 1, 4, 8}, pos[4];
+        uint64_t message = fbTable(fb, 4, sizes, pos);
+        fbRef(fb, 0, message);
+        fbPut(fb, pos[0], 4, 2);
+        fbPut(fb, pos[1], headerType, 1);
+        fbPut(fb, pos[3], bodyLength, 8);
+        return pos[2];
+    }
+
+    //encapsulated message: continuation marker, metadata length and the Message padded to 8 bytes
+    void ArrowBatch::ipcMessage(string &out, string &fb) {
+        while ((fb.length() & 7) != 0)
+            fb.append(1, 0);
+
+        string prefix(8, 0);
+        fbPut(prefix, 0, 0xFFFFFFFF, 4);
+        fbPut(prefix, 4, fb.length(), 4);
+        out.append(prefix);
+        out.append(fb);
+    }
+
+    //output of the formatter: name, field types and the IPC schema message, fields are op, scn, xid and projected columns
+    void ArrowBatch::buildSchema(OracleObject *object) {
+        string fb(4, 0), name = object->owner + "." + object->objectName, fieldTypes;
+        uint64_t header = fbMessage(fb, 1, 0);
+
+        //Schema: endianness (little by default), fields
+        uint64_t sizes[2] = {0, 4}, pos[2];
+        fbRef(fb, header, fbTable(fb, 2, sizes, pos));
+
+        uint64_t fields = ARROW_HEAD_FIELDS;
+        for (uint64_t i = 0; i < object->columns.size(); ++i)
+            if (COLUMNPROJECTED(object, i))
+                ++fields;
+        uint64_t vector = fbVector(fb, fields, 4);
+        fbRef(fb, pos[1], vector);
+
+        fbField(fb, vector + 4, "op", false, ARROW_TYPE_UTF8, nullptr);
+        fbField(fb, vector + 8, "scn", false, ARROW_TYPE_UINT64, nullptr);
+        fbField(fb, vector + 12, "xid", false, ARROW_TYPE_UTF8, nullptr);
+        fieldTypes.append(1, (char)ARROW_TYPE_UTF8);
+        fieldTypes.append(1, (char)ARROW_TYPE_UINT64);
+        fieldTypes.append(1, (char)ARROW_TYPE_UTF8);
+
+        uint64_t field = ARROW_HEAD_FIELDS;
+        for (uint64_t i = 0; i < object->columns.size(); ++i) {
+            if (!COLUMNPROJECTED(object, i))
+                continue;
+            uint64_t type = columnType(object->columns[i]);
+            fbField(fb, vector + 4 + field * 4, object->columns[i]->columnName, true, type, object->columns[i]);
+            fieldTypes.append(1, (char)type);
+            ++field;
+        }
+
+        object->arrowSchema.assign(4, 0);
+        fbPut(object->arrowSchema, 0, name.length(), 2);
+        fbPut(object->arrowSchema, 2, fields, 2);
+        object->arrowSchema.insert(2, name);
+        object->arrowSchema.append(fieldTypes);
+        ipcMessage(object->arrowSchema, fb);
+        object->arrowSchemaId = CommandBuffer::avroFingerprint(object->arrowSchema);
+    }
+
+    //row of the formatter: every field is a presence byte followed by the fixed width value or int32 length and bytes
+    const uint8_t *ArrowBatch::appendRow(const uint8_t *data) {
+        for (uint64_t i = 0; i < fieldCnt; ++i) {
+            uint64_t width = fixedWidth(types[i]);
+            if ((rows & 7) == 0)
+                validity[i].push_back(0);
+
+            if (*data++ != 0) {
+                validity[i].back() |= (uint8_t)(1 << (rows & 7));
+                if (i == 1 && rows == 0 && !file.is_open())
+                    memcpy(&firstScn, data, sizeof(typescn));
+
+                uint32_t length = width;
+                if (width == 0) {
+                    memcpy(&length, data, sizeof(uint32_t));
+                    data += sizeof(uint32_t);
+                }
+                values[i].insert(values[i].end(), data, data + length);
+                data += length;
+            } else {
+                ++nullCnt[i];
+                values[i].resize(values[i].size() + width, 0);
+            }
+
+            if (width == 0) {
+                uint32_t end = values[i].size();
+                offsets[i].insert(offsets[i].end(), (uint8_t*)&end, (uint8_t*)&end + sizeof(uint32_t));
+            }
+        }
+
+        ++rows;
+        return data;
+    }
+
+    //record batch is appended to the stream file of the table, the file is started with the schema
+    bool ArrowBatch::flush(const string &path) {
+        if (rows == 0)
+            return true;
+
+        bool ret = true;
+        if (!file.is_open()) {
+            string fileName = path + "/" + name + "." + to_string(firstScn) + ".arrows";
+            file.open(fileName.c_str(), ios::out | ios::trunc | ios::binary);
+            if (file.is_open())
+                file.write(schema.c_str(), schema.length());
+            else
+                cerr << "ERROR: writing Arrow stream to " << fileName << endl;
+        }
+
+        if (file.is_open()) {
+            uint64_t buffers = 0, bodyLength = 0;
+            for (uint64_t i = 0; i < fieldCnt; ++i) {
+                buffers += fixedWidth(types[i]) == 0 ? 3 : 2;
+                if (nullCnt[i] > 0)
+                    bodyLength += (validity[i].size() + 7) & ~((uint64_t)7);
+                bodyLength += (offsets[i].size() + 7) & ~((uint64_t)7);
+                bodyLength += (values[i].size() + 7) & ~((uint64_t)7);
+            }
+
+            //RecordBatch: length, nodes, buffers
+            string fb(4, 0), message;
+            uint64_t header = fbMessage(fb, 3, bodyLength);
+            uint64_t sizes[3] = {8, 4, 4}, pos[3];
+            fbRef(fb, header, fbTable(fb, 3, sizes, pos));
+            fbPut(fb, pos[0], rows, 8);
+
+            uint64_t nodes = fbVector(fb, fieldCnt, 16);
+            fbRef(fb, pos[1], nodes);
+            uint64_t buffer = fbVector(fb, buffers, 16);
+            fbRef(fb, pos[2], buffer);
+
+            uint64_t offset = 0;
+            buffer += 4;
+            for (uint64_t i = 0; i < fieldCnt; ++i) {
+                fbPut(fb, nodes + 4 + i * 16, rows, 8);
+                fbPut(fb, nodes + 12 + i * 16, nullCnt[i], 8);
+
+                //validity bitmap is left out when there are no nulls
+                uint64_t length = nullCnt[i] > 0 ? validity[i].size() : 0;
+                fbPut(fb, buffer, offset, 8);
+                fbPut(fb, buffer + 8, length, 8);
+                offset += (length + 7) & ~((uint64_t)7);
+                buffer += 16;
+
+                if (fixedWidth(types[i]) == 0) {
+                    fbPut(fb, buffer, offset, 8);
+                    fbPut(fb, buffer + 8, offsets[i].size(), 8);
+                    offset += (offsets[i].size() + 7) & ~((uint64_t)7);
+                    buffer += 16;
+                }
+
+                fbPut(fb, buffer, offset, 8);
+                fbPut(fb, buffer + 8, values[i].size(), 8);
+                offset += (values[i].size() + 7) & ~((uint64_t)7);
+                buffer += 16;
+            }
+
+            ipcMessage(message, fb);
+            file.write(message.c_str(), message.length());
+
+            static const char padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+            for (uint64_t i = 0; i < fieldCnt; ++i) {
+                if (nullCnt[i] > 0) {
+                    file.write((const char*)validity[i].data(), validity[i].size());
+                    file.write(padding, (8 - (validity[i].size() & 7)) & 7);
+                }
+                if (fixedWidth(types[i]) == 0) {
+                    file.write((const char*)offsets[i].data(), offsets[i].size());
+                    file.write(padding, (8 - (offsets[i].size() & 7)) & 7);
+                }
+                file.write((const char*)values[i].data(), values[i].size());
+                file.write(padding, (8 - (values[i].size() & 7)) & 7);
+            }
+            file.flush();
+
+            if (!file.good()) {
+                cerr << "ERROR: writing Arrow record batch of " << name << endl;
+                ret = false;
+            }
+        } else
+            ret = false;
+
+        rows = 0;
+        for (uint64_t i = 0; i < fieldCnt; ++i) {
+            validity[i].clear();
+            values[i].clear();
+            nullCnt[i] = 0;
+            if (fixedWidth(types[i]) == 0)
+                offsets[i].assign(4, 0);
+        }
+        return ret;
+    }
+
+    //end of stream marker
+    void ArrowBatch::close(void) {
+        if (!file.is_open())
+            return;
+
+        static const char endOfStream[8] = {(char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, 0, 0, 0, 0};
+        file.write(endOfStream, 8);
+        file.close();
+    }
+}
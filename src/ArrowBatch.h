@@ -0,0 +1,89 @@
+/* Header for ArrowBatch class
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "types.h"
+
+#ifndef ARROWBATCH_H_
+#define ARROWBATCH_H_
+
+#define ARROW_TYPE_UTF8 0
+#define ARROW_TYPE_BINARY 1
+#define ARROW_TYPE_INT64 2
+#define ARROW_TYPE_UINT64 3
+#define ARROW_TYPE_DECIMAL 4
+#define ARROW_TYPE_TIMESTAMP_MILLIS 5
+#define ARROW_TYPE_TIMESTAMP_MICROS 6
+
+#define ARROW_MESSAGE_SCHEMA 1
+#define ARROW_MESSAGE_ROW 2
+
+//op, scn and xid precede the columns of the table
+#define ARROW_HEAD_FIELDS 3
+
+using namespace std;
+
+namespace OpenLogReplicator {
+
+    class OracleObject;
+    class OracleColumn;
+
+    //columns of one table collected until the record batch is written to the IPC stream file of the table
+    class ArrowBatch {
+    protected:
+        uint64_t fieldCnt;
+        uint8_t *types;
+        vector<uint8_t> *validity;
+        vector<uint8_t> *offsets;       //int32 offsets of variable length values
+        vector<uint8_t> *values;
+        uint64_t *nullCnt;
+        ofstream file;
+
+        static uint64_t fbTable(string &fb, uint64_t fields, const uint64_t *sizes, uint64_t *pos);
+        static uint64_t fbVector(string &fb, uint64_t count, uint64_t elementSize);
+        static uint64_t fbString(string &fb, const string &str);
+        static void fbPut(string &fb, uint64_t pos, uint64_t val, uint64_t size);
+        static void fbRef(string &fb, uint64_t pos, uint64_t target);
+        static void fbField(string &fb, uint64_t ref, const string &name, bool nullable, uint64_t type, OracleColumn *column);
+        static uint64_t fbMessage(string &fb, uint64_t headerType, uint64_t bodyLength);
+        static void ipcMessage(string &out, string &fb);
+
+    public:
+        string name;                    //OWNER.TABLE
+        string schema;                  //IPC schema message
+        uint64_t rows;
+        uint64_t startTime;             //ms, arrival of the first row of the batch
+        typescn firstScn;               //first row of the stream, part of the file name
+
+        static uint64_t columnType(OracleColumn *column);
+        static void buildSchema(OracleObject *object);
+        static uint64_t fixedWidth(uint64_t type);
+
+        const uint8_t *appendRow(const uint8_t *data);
+        bool flush(const string &path);
+        void close(void);
+
+        ArrowBatch(const uint8_t *data, uint64_t length);
+        virtual ~ArrowBatch();
+    };
+}
+
+#endif
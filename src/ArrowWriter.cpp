@@ -0,0 +1,413 @@
+/* Thread writing redo log changes as Apache Arrow record batches
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <chrono>
+#include <iostream>
+#include <string.h>
+#include "types.h"
+#include "ArrowBatch.h"
+#include "ArrowWriter.h"
+#include "ColumnIterator.h"
+#include "CommandBuffer.h"
+#include "MemoryException.h"
+#include "OracleColumn.h"
+#include "OracleNumber.h"
+#include "OracleObject.h"
+#include "OracleReader.h"
+#include "OutputCursor.h"
+#include "RedoLogRecord.h"
+#include "RowFilter.h"
+
+using namespace std;
+
+namespace OpenLogReplicator {
+
+    ArrowWriter::ArrowWriter(const string alias, const string path, uint64_t batchRows, uint64_t batchMs, OracleReader *oracleReader,
+            uint64_t trace, uint64_t trace2) :
+        Writer(alias, oracleReader, STREAM_ARROW, 0, 0, 0, 0, 0, 0),
+        path(path),
+        batchRows(batchRows),
+        batchMs(batchMs),
+        trace(trace),
+        trace2(trace2),
+        lastScn(0),
+        rowData(nullptr),
+        rowLength(nullptr),
+        rowColumns(0) {
+    }
+
+    ArrowWriter::~ArrowWriter() {
+        for (auto it : batches)
+            delete it.second;
+        batches.clear();
+
+        if (rowData != nullptr) {
+            delete[] rowData;
+            rowData = nullptr;
+        }
+        if (rowLength != nullptr) {
+            delete[] rowLength;
+            rowLength = nullptr;
+        }
+    }
+
+    //formatted rows are collected in batches of their tables, batches are written by size or age
+    void *ArrowWriter::run() {
+        cout << "- Arrow Writer for: " << path << endl;
+        uint64_t length, lastCheck = 0;
+
+        while (true) {
+            length = commandBuffer->readerPeek(cursor, shutdown, batchMs / 10 + 1);
+            if ((trace2 & TRACE2_OUTPUT_BUFFER) != 0)
+                cerr << "Arrow writer buffer: " << dec << commandBuffer->cursors[cursor]->pos << " - " << commandBuffer->posEnd << " (" << length << ")" << endl;
+            uint64_t now = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+
+            if (length > 0) {
+                const uint8_t *data = commandBuffer->intraThreadBuffer + commandBuffer->cursors[cursor]->pos + 8;
+                uint64_t id;
+                memcpy(&id, data + 1, sizeof(uint64_t));
+
+                if (data[0] == ARROW_MESSAGE_SCHEMA) {
+                    if (batches.find(id) == batches.end())
+                        addBatch(id, data + 9, length - 17);
+                } else {
+                    auto it = batches.find(id);
+                    if (it == batches.end()) {
+                        cerr << "ERROR: Arrow row of unknown schema: " << hex << id << endl;
+                    } else {
+                        ArrowBatch *batch = it->second;
+                        activateBatch(batch);
+                        if (batch->rows == 0)
+                            batch->startTime = now;
+                        batch->appendRow(data + 9);
+                        if (batch->rows >= batchRows)
+                            batch->flush(path);
+                    }
+                }
+
+                commandBuffer->readerRelease(cursor, length);
+            } else
+                if (shutdown)
+                    break;
+
+            if (now != lastCheck) {
+                lastCheck = now;
+                for (auto it : batches)
+                    if (it.second->rows > 0 && now - it.second->startTime >= batchMs)
+                        it.second->flush(path);
+            }
+        }
+
+        for (auto it : batches) {
+            it.second->flush(path);
+            it.second->close();
+            delete it.second;
+        }
+        batches.clear();
+        activeBatches.clear();
+
+        if ((trace2 & TRACE2_OUTPUT_BUFFER) != 0)
+            cerr << "Arrow writer buffer at shutdown: " << dec << commandBuffer->cursors[cursor]->pos << " - " << commandBuffer->posEnd << endl;
+        return 0;
+    }
+
+    void ArrowWriter::addBatch(uint64_t id, const uint8_t *data, uint64_t length) {
+        ArrowBatch *batch = new ArrowBatch(data, length);
+        if (batch == nullptr) {
+            cerr << "ERROR: could not allocate " << dec << sizeof(ArrowBatch) << " bytes memory for (reason: Arrow batch)" << endl;
+            throw MemoryException("out of memory");
+        }
+
+        batches[id] = batch;
+        activateBatch(batch);
+    }
+
+    //other definition of a table ends the stream of the previous one, the next row of it starts a new file
+    void ArrowWriter::activateBatch(ArrowBatch *batch) {
+        auto it = activeBatches.find(batch->name);
+        if (it != activeBatches.end()) {
+            if (it->second == batch)
+                return;
+            it->second->flush(path);
+            it->second->close();
+        }
+        activeBatches[batch->name] = batch;
+    }
+
+    void ArrowWriter::beginTran(typescn scn, typetime, typexid) {
+        lastScn = scn;
+    }
+
+    void ArrowWriter::next() {
+    }
+
+    //every row is a separate message
+    void ArrowWriter::commitTran() {
+    }
+
+    void ArrowWriter::beginBatch(typescn scn, typexid, uint64_t) {
+        lastScn = scn;
+    }
+
+    //streaming of uncommitted transactions is disabled, batches are only parts of a committed transaction
+    void ArrowWriter::commitBatches(typescn, typetime, typexid, uint64_t) {
+    }
+
+    void ArrowWriter::rollbackBatches(typescn, typexid, uint64_t) {
+    }
+
+    void ArrowWriter::retractDml(typescn, typexid, uint64_t, uint64_t, uint64_t) {
+    }
+
+    void ArrowWriter::beginRow(OracleObject *object) {
+        if (rowColumns < object->columns.size()) {
+            if (rowData != nullptr)
+                delete[] rowData;
+            if (rowLength != nullptr)
+                delete[] rowLength;
+            rowColumns = object->columns.size();
+            rowData = new const uint8_t*[rowColumns];
+            rowLength = new uint64_t[rowColumns];
+
+            if (rowData == nullptr || rowLength == nullptr) {
+                cerr << "ERROR: could not allocate memory for Arrow row (" << dec << rowColumns << " columns)" << endl;
+                throw MemoryException("out of memory");
+            }
+        }
+
+        memset(rowData, 0, object->columns.size() * sizeof(const uint8_t*));
+        memset(rowLength, 0, object->columns.size() * sizeof(uint64_t));
+    }
+
+    //row image from the column values of the redo records
+    void ArrowWriter::setColumns(ColumnIterator &column) {
+        while (column.next()) {
+            rowData[column.colNum] = column.data;
+            rowLength[column.colNum] = column.length;
+        }
+    }
+
+    void ArrowWriter::appendRow(OracleObject *object, char op, typexid xid) {
+        if (schemasSent.find(object->arrowSchemaId) == schemasSent.end()) {
+            commandBuffer
+                    ->beginTran()
+                    ->append((char)ARROW_MESSAGE_SCHEMA)
+                    ->append((const uint8_t*)&object->arrowSchemaId, sizeof(uint64_t))
+                    ->append(object->arrowSchema)
+                    ->commitTran();
+            schemasSent.insert(object->arrowSchemaId);
+        }
+
+        uint8_t head[16];
+        uint32_t length = 1;
+        head[0] = 1;
+        memcpy(head + 1, &length, sizeof(uint32_t));
+        head[5] = op;
+        head[6] = 1;
+        memcpy(head + 7, &lastScn, sizeof(typescn));
+
+        string xidText = to_string(USN(xid)) + "." + to_string(SLT(xid)) + "." + to_string(SQN(xid));
+        uint8_t xidHead[5];
+        length = xidText.length();
+        xidHead[0] = 1;
+        memcpy(xidHead + 1, &length, sizeof(uint32_t));
+
+        commandBuffer
+                ->beginTran()
+                ->append((char)ARROW_MESSAGE_ROW)
+                ->append((const uint8_t*)&object->arrowSchemaId, sizeof(uint64_t))
+                ->append(head, 15)
+                ->append(xidHead, 5)
+                ->append(xidText);
+
+        for (uint64_t i = 0; i < object->columns.size(); ++i)
+            if (COLUMNPROJECTED(object, i))
+                appendValue(object->columns[i], rowData[i], rowLength[i]);
+
+        commandBuffer->commitTran();
+    }
+
+    //value in the physical layout of the Arrow type of the column
+    void ArrowWriter::appendValue(OracleColumn *column, const uint8_t *data, uint64_t length) {
+        uint8_t value[NUMBER_TEXT_MAX + 8];
+        uint32_t valueLength;
+
+        if (data != nullptr && length > 0) {
+            value[0] = 1;
+
+            //character data has the same layout as binary and is copied as it is
+            uint64_t type = ArrowBatch::columnType(column);
+            if (type == ARROW_TYPE_UTF8 && column->typeNo != 2)
+                type = ARROW_TYPE_BINARY;
+
+            switch (type) {
+            case ARROW_TYPE_INT64: {
+                int64_t val;
+                if (!OracleNumber::toInt64(data, length, val))
+                    break;
+                memcpy(value + 1, &val, sizeof(int64_t));
+                commandBuffer->append(value, 9);
+                return;
+            }
+
+            case ARROW_TYPE_DECIMAL: {
+                typedec128 val;
+                uint64_t scale;
+                if (!OracleNumber::toDecimal128(data, length, val, scale))
+                    break;
+                for (; scale < (uint64_t)column->scale; ++scale)
+                    val *= 10;
+                for (; scale > (uint64_t)column->scale; --scale)
+                    val /= 10;
+                memcpy(value + 1, &val, sizeof(typedec128));
+                commandBuffer->append(value, 17);
+                return;
+            }
+
+            case ARROW_TYPE_TIMESTAMP_MILLIS:
+            case ARROW_TYPE_TIMESTAMP_MICROS: {
+                int64_t val;
+                if (!CommandBuffer::epochTime(data, length, type == ARROW_TYPE_TIMESTAMP_MICROS, val))
+                    break;
+                memcpy(value + 1, &val, sizeof(int64_t));
+                commandBuffer->append(value, 9);
+                return;
+            }
+
+            case ARROW_TYPE_UTF8:
+                valueLength = OracleNumber::textLength(data, length);
+                if (valueLength == 0)
+                    break;
+                memcpy(value + 1, &valueLength, sizeof(uint32_t));
+                OracleNumber::toText(data, length, (char*)value + 5);
+                commandBuffer->append(value, 5 + valueLength);
+                return;
+
+            default:
+                valueLength = length;
+                memcpy(value + 1, &valueLength, sizeof(uint32_t));
+                commandBuffer
+                        ->append(value, 5)
+                        ->append(data, length);
+                return;
+            }
+        }
+
+        //null or value not representable in the type of the column
+        commandBuffer->append((char)0);
+    }
+
+    //0x05010B0B
+    void ArrowWriter::parseInsertMultiple(RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2) {
+        uint64_t fieldPos = redoLogRecord2->fieldPos, fieldPosStart;
+        uint16_t fieldLength;
+
+        for (uint64_t i = 1; i < 4; ++i) {
+            fieldLength = oracleReader->read16(redoLogRecord2->data + redoLogRecord2->fieldLengthsDelta + i * 2);
+            fieldPos += (fieldLength + 3) & 0xFFFC;
+        }
+        fieldPosStart = fieldPos;
+
+        for (uint64_t r = 0; r < redoLogRecord2->nrow; ++r) {
+            uint64_t rowLength = oracleReader->read16(redoLogRecord2->data + redoLogRecord2->rowLenghsDelta + r * 2);
+            if (redoLogRecord1->object->filter != nullptr && !redoLogRecord1->object->filter->matchesRow(redoLogRecord2, fieldPosStart)) {
+                fieldPosStart += rowLength;
+                continue;
+            }
+
+            commandBuffer->reserveSpan(redoLogRecord2->object->rowLengthMax + 2 * rowLength);
+            beginRow(redoLogRecord2->object);
+            ColumnIterator column(oracleReader, redoLogRecord2, fieldPosStart);
+            setColumns(column);
+
+            appendRow(redoLogRecord2->object, 'c', redoLogRecord1->xid);
+            fieldPosStart += rowLength;
+            commandBuffer->commitSpan();
+        }
+    }
+
+    //0x05010B0C
+    void ArrowWriter::parseDeleteMultiple(RedoLogRecord *redoLogRecord1, RedoLogRecord *) {
+        uint64_t fieldPos = redoLogRecord1->fieldPos, fieldPosStart;
+        uint16_t fieldLength;
+
+        for (uint64_t i = 1; i < 6; ++i) {
+            fieldLength = oracleReader->read16(redoLogRecord1->data + redoLogRecord1->fieldLengthsDelta + i * 2);
+            fieldPos += (fieldLength + 3) & 0xFFFC;
+        }
+        fieldPosStart = fieldPos;
+
+        for (uint64_t r = 0; r < redoLogRecord1->nrow; ++r) {
+            uint64_t rowLength = oracleReader->read16(redoLogRecord1->data + redoLogRecord1->rowLenghsDelta + r * 2);
+            if (redoLogRecord1->object->filter != nullptr && !redoLogRecord1->object->filter->matchesRow(redoLogRecord1, fieldPosStart)) {
+                fieldPosStart += rowLength;
+                continue;
+            }
+
+            commandBuffer->reserveSpan(redoLogRecord1->object->rowLengthMax + 2 * rowLength);
+            beginRow(redoLogRecord1->object);
+            ColumnIterator column(oracleReader, redoLogRecord1, fieldPosStart);
+            setColumns(column);
+
+            appendRow(redoLogRecord1->object, 'd', redoLogRecord1->xid);
+            fieldPosStart += rowLength;
+            commandBuffer->commitSpan();
+        }
+    }
+
+    //UPDATE carries the after image merged over the before image, DELETE the before image
+    void ArrowWriter::parseDML(RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2, uint64_t type) {
+        uint64_t dataLength = 0;
+        for (RedoLogRecord *redoLogRecord = redoLogRecord1; redoLogRecord != nullptr; redoLogRecord = redoLogRecord->next)
+            dataLength += redoLogRecord->length;
+        for (RedoLogRecord *redoLogRecord = redoLogRecord2; redoLogRecord != nullptr; redoLogRecord = redoLogRecord->next)
+            dataLength += redoLogRecord->length;
+        commandBuffer->reserveSpan(redoLogRecord2->object->rowLengthMax + 2 * dataLength);
+
+        beginRow(redoLogRecord2->object);
+        //before image with supplemental log columns, the after image overwrites it
+        if (type == TRANSACTION_DELETE || type == TRANSACTION_UPDATE) {
+            ColumnIterator column(oracleReader, redoLogRecord1);
+            setColumns(column);
+        }
+        if (type == TRANSACTION_INSERT || type == TRANSACTION_UPDATE) {
+            ColumnIterator column(oracleReader, redoLogRecord2);
+            setColumns(column);
+        }
+
+        char op = 'u';
+        if (type == TRANSACTION_INSERT)
+            op = 'c';
+        else if (type == TRANSACTION_DELETE)
+            op = 'd';
+        appendRow(redoLogRecord2->object, op, redoLogRecord1->xid);
+        commandBuffer->commitSpan();
+    }
+
+    //changed definition of a table arrives as a new schema with the next row
+    void ArrowWriter::parseDDL(RedoLogRecord *) {
+    }
+
+    //copy of the writer used only for formatting into a private buffer
+    Writer* ArrowWriter::newFormatter(CommandBuffer *commandBuffer) {
+        ArrowWriter *formatter = new ArrowWriter(alias, path, batchRows, batchMs, oracleReader, trace, trace2);
+        formatter->commandBuffer = commandBuffer;
+        return formatter;
+    }
+}
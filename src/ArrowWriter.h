@@ -0,0 +1,84 @@
+/* Header for ArrowWriter class
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <map>
+#include <set>
+#include <stdint.h>
+#include "types.h"
+#include "Writer.h"
+
+#ifndef ARROWWRITER_H_
+#define ARROWWRITER_H_
+
+using namespace std;
+
+namespace OpenLogReplicator {
+
+    class ArrowBatch;
+    class ColumnIterator;
+    class RedoLogRecord;
+    class OracleReader;
+    class OracleObject;
+    class OracleColumn;
+
+    class ArrowWriter : public Writer {
+    protected:
+        string path;
+        uint64_t batchRows;             //record batch is written after this many rows
+        uint64_t batchMs;               //or when its first row is older
+        uint64_t trace;
+        uint64_t trace2;
+        typescn lastScn;
+        set<uint64_t> schemasSent;      //schemas already output by this formatter
+        map<uint64_t, ArrowBatch*> batches;             //every schema received, rows may refer to a previous definition
+        map<string, ArrowBatch*> activeBatches;         //batch of the open stream file of every table
+        const uint8_t **rowData;        //row image by column number, nullptr - null
+        uint64_t *rowLength;
+        uint64_t rowColumns;
+
+        void beginRow(OracleObject *object);
+        void setColumns(ColumnIterator &column);
+        void appendRow(OracleObject *object, char op, typexid xid);
+        void appendValue(OracleColumn *column, const uint8_t *data, uint64_t length);
+        void addBatch(uint64_t id, const uint8_t *data, uint64_t length);
+        void activateBatch(ArrowBatch *batch);
+
+    public:
+        virtual void *run();
+
+        virtual void beginTran(typescn scn, typetime time, typexid xid);
+        virtual void next();
+        virtual void commitTran();
+        virtual void beginBatch(typescn scn, typexid xid, uint64_t batch);
+        virtual void commitBatches(typescn scn, typetime time, typexid xid, uint64_t batches);
+        virtual void rollbackBatches(typescn scn, typexid xid, uint64_t batches);
+        virtual void retractDml(typescn scn, typexid xid, uint64_t batch, uint64_t first, uint64_t last);
+        virtual void parseInsertMultiple(RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2);
+        virtual void parseDeleteMultiple(RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2);
+        virtual void parseDML(RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2, uint64_t type);
+        virtual void parseDDL(RedoLogRecord *redoLogRecord1);
+        virtual Writer* newFormatter(CommandBuffer *commandBuffer);
+
+        ArrowWriter(const string alias, const string path, uint64_t batchRows, uint64_t batchMs, OracleReader *oracleReader, uint64_t trace,
+                uint64_t trace2);
+        virtual ~ArrowWriter();
+    };
+}
+
+#endif
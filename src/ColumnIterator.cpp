@@ -0,0 +1,275 @@
+/* Iterator over column values of redo records
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <iostream>
+
+#include "ColumnIterator.h"
+#include "OracleObject.h"
+#include "OracleReader.h"
+#include "RedoLogRecord.h"
+
+#define COLUMN_STEP_RECORD          0
+#define COLUMN_STEP_COLUMNS         1
+#define COLUMN_STEP_SUPPLEMENTAL    2
+#define COLUMN_STEP_ROW             3
+
+using namespace std;
+
+namespace OpenLogReplicator {
+
+    ColumnIterator::ColumnIterator(OracleReader *oracleReader, RedoLogRecord *redoLogRecord) :
+        oracleReader(oracleReader),
+        nextRecord(redoLogRecord),
+        step(COLUMN_STEP_RECORD),
+        field(0),
+        pos(0),
+        column(0),
+        columns(0),
+        colShift(0),
+        nulls(nullptr),
+        bits(1),
+        colNums(nullptr),
+        colSizes(nullptr),
+        redoLogRecord(nullptr),
+        colNum(0),
+        fieldPos(0),
+        length(0),
+        data(nullptr),
+        isNull(true),
+        supplemental(false) {
+    }
+
+    //fieldPos - start of the row
+    ColumnIterator::ColumnIterator(OracleReader *oracleReader, RedoLogRecord *redoLogRecord, uint64_t fieldPos) :
+        oracleReader(oracleReader),
+        nextRecord(nullptr),
+        step(COLUMN_STEP_ROW),
+        field(0),
+        pos(fieldPos + 3),
+        column(0),
+        columns(redoLogRecord->data[fieldPos + 2]),
+        colShift(0),
+        nulls(nullptr),
+        bits(1),
+        colNums(nullptr),
+        colSizes(nullptr),
+        redoLogRecord(redoLogRecord),
+        colNum(0),
+        fieldPos(0),
+        length(0),
+        data(nullptr),
+        isNull(true),
+        supplemental(false) {
+
+        if ((redoLogRecord->op & OP_ROWDEPENDENCIES) != 0) {
+            if (oracleReader->version < 0x12200)
+                pos += 6;
+            else
+                pos += 8;
+        }
+    }
+
+    ColumnIterator::~ColumnIterator() {
+    }
+
+    uint16_t ColumnIterator::fieldLength(void) {
+        return oracleReader->read16(redoLogRecord->data + redoLogRecord->fieldLengthsDelta + field * 2);
+    }
+
+    void ColumnIterator::skipField(void) {
+        pos += (fieldLength() + 3) & 0xFFFC;
+        ++field;
+    }
+
+    //next record of the chain with column values, false - end of the chain
+    bool ColumnIterator::nextRecordColumns(void) {
+        uint64_t headerSize;
+
+        while (nextRecord != nullptr) {
+            redoLogRecord = nextRecord;
+            nextRecord = nextRecord->next;
+
+            if (redoLogRecord->opCode == 0x0501) {
+                if (redoLogRecord->colNumsDelta > 0) {
+                    colNums = redoLogRecord->data + redoLogRecord->colNumsDelta;
+                    colShift = redoLogRecord->suppLogBefore - 1 - oracleReader->read16(colNums);
+                    headerSize = 5;
+                } else {
+                    colNums = nullptr;
+                    colShift = redoLogRecord->suppLogBefore - 1;
+                    headerSize = 4;
+                }
+            } else if (redoLogRecord->opCode == 0x0B02) {
+                colNums = nullptr;
+                colShift = redoLogRecord->suppLogAfter - 1;
+                headerSize = 2;
+            } else if (redoLogRecord->opCode == 0x0B05 || redoLogRecord->opCode == 0x0B06) {
+                if (redoLogRecord->colNumsDelta > 0) {
+                    colNums = redoLogRecord->data + redoLogRecord->colNumsDelta;
+                    colShift = redoLogRecord->suppLogAfter - 1 - oracleReader->read16(colNums);
+                    headerSize = 3;
+                } else {
+                    colNums = nullptr;
+                    colShift = redoLogRecord->suppLogAfter - 1;
+                    headerSize = 2;
+                }
+            } else
+                continue;
+
+            field = 1;
+            pos = redoLogRecord->fieldPos;
+            nulls = redoLogRecord->data + redoLogRecord->nullsDelta;
+            bits = 1;
+            column = 0;
+            columns = redoLogRecord->cc;
+            for (uint64_t i = 1; i <= headerSize; ++i)
+                skipField();
+            return true;
+        }
+
+        return false;
+    }
+
+    //undo record: row dependencies, supplemental log header, column numbers and sizes, then the values
+    void ColumnIterator::beginSupplemental(void) {
+        step = COLUMN_STEP_RECORD;
+
+        if ((redoLogRecord->op & OP_ROWDEPENDENCIES) != 0)
+            skipField();
+
+        if (field <= redoLogRecord->fieldCnt) {
+            skipField();
+
+            if (redoLogRecord->suppLogCC > 0 && field + 2 <= redoLogRecord->fieldCnt) {
+                colNums = redoLogRecord->data + pos;
+                skipField();
+                colSizes = redoLogRecord->data + pos;
+                skipField();
+
+                column = 0;
+                columns = redoLogRecord->suppLogCC;
+                step = COLUMN_STEP_SUPPLEMENTAL;
+            }
+        }
+    }
+
+    //false - no more columns
+    bool ColumnIterator::next(void) {
+        while (true) {
+            if (step == COLUMN_STEP_ROW) {
+                if (column >= columns || (redoLogRecord->object != nullptr && column >= redoLogRecord->object->columns.size()))
+                    return false;
+
+                colNum = column++;
+                length = redoLogRecord->data[pos++];
+                if (length == 0xFF) {
+                    isNull = true;
+                    length = 0;
+                    fieldPos = pos;
+                    data = nullptr;
+                } else {
+                    if (length == 0xFE) {
+                        length = oracleReader->read16(redoLogRecord->data + pos);
+                        pos += 2;
+                    }
+                    isNull = false;
+                    fieldPos = pos;
+                    data = redoLogRecord->data + pos;
+                    pos += length;
+                }
+                return true;
+
+            } else if (step == COLUMN_STEP_RECORD) {
+                if (!nextRecordColumns())
+                    return false;
+                step = COLUMN_STEP_COLUMNS;
+                continue;
+
+            } else if (step == COLUMN_STEP_COLUMNS) {
+                if (column >= columns) {
+                    if (redoLogRecord->opCode == 0x0501)
+                        beginSupplemental();
+                    else
+                        step = COLUMN_STEP_RECORD;
+                    continue;
+                }
+
+                if (field > redoLogRecord->fieldCnt) {
+                    cerr << "ERROR: reached out of columns" << endl;
+                    step = COLUMN_STEP_RECORD;
+                    continue;
+                }
+
+                if (colNums != nullptr) {
+                    colNum = oracleReader->read16(colNums) + colShift;
+                    colNums += 2;
+                } else
+                    colNum = column + colShift;
+
+                if (redoLogRecord->object != nullptr && colNum >= redoLogRecord->object->columns.size()) {
+                    cerr << "ERROR: too big column id: " << dec << colNum << endl;
+                    step = COLUMN_STEP_RECORD;
+                    continue;
+                }
+
+                length = fieldLength();
+                isNull = (*nulls & bits) != 0 || length == 0;
+                fieldPos = pos;
+                supplemental = false;
+
+                bits <<= 1;
+                if (bits == 0) {
+                    bits = 1;
+                    ++nulls;
+                }
+                skipField();
+                ++column;
+
+            } else {
+                if (column >= columns || field > redoLogRecord->fieldCnt) {
+                    step = COLUMN_STEP_RECORD;
+                    continue;
+                }
+
+                colNum = oracleReader->read16(colNums) + colShift - 1;
+                colNums += 2;
+                length = oracleReader->read16(colSizes);
+                colSizes += 2;
+                isNull = length == 0xFFFF;
+                fieldPos = pos;
+                supplemental = true;
+                skipField();
+                ++column;
+
+                if (redoLogRecord->object != nullptr && colNum >= redoLogRecord->object->columns.size()) {
+                    cerr << "ERROR: too big column id: " << dec << colNum << endl;
+                    step = COLUMN_STEP_RECORD;
+                    continue;
+                }
+            }
+
+            if (isNull) {
+                length = 0;
+                data = nullptr;
+            } else
+                data = redoLogRecord->data + fieldPos;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,72 @@
+/* Header for ColumnIterator class
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <stdint.h>
+#include "types.h"
+
+#ifndef COLUMNITERATOR_H_
+#define COLUMNITERATOR_H_
+
+using namespace std;
+
+namespace OpenLogReplicator {
+
+    class OracleReader;
+    class RedoLogRecord;
+
+    //column values of a row image: chain of undo (0x0501 with supplemental log columns) or redo (0x0B02, 0x0B05, 0x0B06) records,
+    //or one row of multi-row insert or delete; the only place which knows the layout of the columns in redo
+    class ColumnIterator {
+    protected:
+        OracleReader *oracleReader;
+        RedoLogRecord *nextRecord;
+        uint64_t step;
+        uint64_t field;                 //number of the next field of the record
+        uint64_t pos;                   //position of the next field
+        uint64_t column;                //number of the column in the current step
+        uint64_t columns;               //columns in the current step
+        uint64_t colShift;
+        const uint8_t *nulls;
+        uint8_t bits;
+        const uint8_t *colNums;
+        const uint8_t *colSizes;
+
+        uint16_t fieldLength(void);
+        void skipField(void);
+        bool nextRecordColumns(void);
+        void beginSupplemental(void);
+
+    public:
+        RedoLogRecord *redoLogRecord;   //record holding the value
+        uint64_t colNum;
+        uint64_t fieldPos;              //value is at redoLogRecord->data + fieldPos
+        uint64_t length;                //0 - null
+        const uint8_t *data;            //nullptr - null
+        bool isNull;
+        bool supplemental;              //supplemental log column of the undo record
+
+        bool next(void);
+
+        ColumnIterator(OracleReader *oracleReader, RedoLogRecord *redoLogRecord);
+        ColumnIterator(OracleReader *oracleReader, RedoLogRecord *redoLogRecord, uint64_t fieldPos);
+        virtual ~ColumnIterator();
+    };
+}
+
+#endif
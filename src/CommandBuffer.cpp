@@ -17,15 +17,31 @@ You should have received a copy of the GNU General Public License
 along with Open Log Replicator; see the file LICENSE.txt  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <chrono>
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "types.h"
+#include "ArrowBatch.h"
+#include "ColumnIterator.h"
 #include "CommandBuffer.h"
 #include "OracleReader.h"
 #include "OracleObject.h"
 #include "OracleColumn.h"
+#include "OracleNumber.h"
+#include "OutputCursor.h"
 #include "RedoLogRecord.h"
+#include "RowFilter.h"
 #include "MemoryException.h"
 
 namespace OpenLogReplicator {
@@ -33,21 +49,52 @@ namespace OpenLogReplicator {
     CommandBuffer::CommandBuffer(uint64_t outputBufferSize) :
             oracleReader(nullptr),
             shutdown(false),
+            avroCapture(false),
+            avroData(nullptr),
+            avroLength(nullptr),
+            avroColumns(0),
+            lastDateLength(0),
             writer(nullptr),
-            posStart(0),
             posEnd(0),
             posEndTmp(0),
-            posSize(0),
+            posLimit(0),
+            posSpanEnd(0),
+            writerWaiting(false),
+            readersWaiting(0),
             test(0),
             timestampFormat(0),
-            outputBufferSize(outputBufferSize) {
-        intraThreadBuffer = new uint8_t[outputBufferSize];
+            stream(STREAM_JSON),
+            outputBufferSize(outputBufferSize),
+            shard(0),
+            shards(0),
+            shardBy(SHARD_BY_TABLE) {
+        //the same memory is mapped twice one after another, a message which crosses the end of the buffer
+        //continues in the second mapping, so writers and consumers always see it as one piece
+        uint64_t pageSize = sysconf(_SC_PAGESIZE);
+        this->outputBufferSize = ((outputBufferSize + pageSize - 1) / pageSize) * pageSize;
+        intraThreadBuffer = nullptr;
+
+        int fd = memfd_create("output-buffer", 0);
+        if (fd != -1) {
+            void *area = MAP_FAILED;
+            if (ftruncate(fd, this->outputBufferSize) == 0)
+                area = mmap(nullptr, this->outputBufferSize * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+            if (area != MAP_FAILED) {
+                if (mmap(area, this->outputBufferSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED &&
+                        mmap((uint8_t*)area + this->outputBufferSize, this->outputBufferSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED)
+                    intraThreadBuffer = (uint8_t*)area;
+                else
+                    munmap(area, this->outputBufferSize * 2);
+            }
+            close(fd);
+        }
 
         if (intraThreadBuffer == nullptr) {
-            cerr << "ERROR: could not allocate memory for output buffer (" << dec << outputBufferSize << " bytes)" << endl;
+            cerr << "ERROR: could not allocate memory for output buffer (" << dec << this->outputBufferSize << " bytes)" << endl;
             throw MemoryException("out of memory");
         }
-
     }
 
     void CommandBuffer::stop(void) {
@@ -58,73 +105,177 @@ namespace OpenLogReplicator {
         this->oracleReader = oracleReader;
     }
 
+    //FNV-1a of a column value, null differs from an empty value
+    static uint64_t hashValue(uint64_t hash, const uint8_t *data, uint64_t length) {
+        if (data == nullptr)
+            return (hash ^ 0xFF) * 0x100000001B3ULL;
 
-    CommandBuffer* CommandBuffer::appendEscape(const uint8_t *str, uint64_t length) {
-        if (this->shutdown)
-            return this;
+        for (uint64_t i = 0; i < length; ++i)
+            hash = (hash ^ data[i]) * 0x100000001B3ULL;
+        return (hash ^ length) * 0x100000001B3ULL;
+    }
 
-        {
-            unique_lock<mutex> lck(mtx);
-            while (posSize > 0 && posEndTmp + length * 2 >= posStart) {
-                cerr << "WARNING, JSON buffer full, log reader suspended (1)" << endl;
-                writerCond.wait(lck);
-                if (this->shutdown)
-                    return this;
+    //rows of one table or one primary key always go to the same shard,
+    //key not present in redo (no supplemental logging of the primary key): rows of one data block go to the same shard
+    uint64_t CommandBuffer::getShard(typeobj objn, typedba bdba, RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2) {
+        if (shardBy == SHARD_BY_TABLE)
+            return SHARDHASHINGFUNCTION(objn, shards);
+
+        OracleObject *object = redoLogRecord1->object;
+        if (object != nullptr && object->totalPk > 0) {
+            uint64_t hash = 0xCBF29CE484222325ULL ^ objn, found = 0;
+            for (uint64_t i = 0; i < object->columns.size(); ++i) {
+                if (object->columns[i]->numPk == 0)
+                    continue;
+
+                const uint8_t *data = nullptr;
+                uint64_t length = 0;
+                if (!RowFilter::findColumn(oracleReader, redoLogRecord1, i, data, length) &&
+                        !RowFilter::findColumn(oracleReader, redoLogRecord2, i, data, length))
+                    break;
+                hash = hashValue(hash, data, length);
+                ++found;
             }
-            if (this->shutdown)
-                return this;
+
+            if (found == object->totalPk)
+                return SHARDHASHINGFUNCTION(hash, shards);
         }
 
-        if (posEndTmp + length * 2 >= outputBufferSize) {
-            cerr << "ERROR: JSON buffer overflow (1)" << endl;
-            return this;
+        return SHARDHASHINGFUNCTION((((uint64_t)objn) << 32) | bdba, shards);
+    }
+
+    //one row of multi-row insert or delete
+    uint64_t CommandBuffer::getRowShard(typeobj objn, typedba bdba, RedoLogRecord *redoLogRecord, uint64_t fieldPos) {
+        if (shardBy == SHARD_BY_TABLE)
+            return SHARDHASHINGFUNCTION(objn, shards);
+
+        OracleObject *object = redoLogRecord->object;
+        if (object != nullptr && object->totalPk > 0) {
+            uint64_t hash = 0xCBF29CE484222325ULL ^ objn, found = 0;
+            ColumnIterator column(oracleReader, redoLogRecord, fieldPos);
+            while (column.next()) {
+                if (object->columns[column.colNum]->numPk == 0)
+                    continue;
+
+                hash = hashValue(hash, column.data, column.length);
+                ++found;
+            }
+
+            if (found == object->totalPk)
+                return SHARDHASHINGFUNCTION(hash, shards);
         }
 
-        while (length > 0) {
-            if (*str == '\t') {
-                intraThreadBuffer[posEndTmp++] = '\\';
-                intraThreadBuffer[posEndTmp++] = 't';
-            } else if (*str == '\r') {
-                intraThreadBuffer[posEndTmp++] = '\\';
-                intraThreadBuffer[posEndTmp++] = 'r';
-            } else if (*str == '\n') {
-                intraThreadBuffer[posEndTmp++] = '\\';
-                intraThreadBuffer[posEndTmp++] = 'n';
-            } else if (*str == '\f') {
-                intraThreadBuffer[posEndTmp++] = '\\';
-                intraThreadBuffer[posEndTmp++] = 'f';
-            } else if (*str == '\b') {
-                intraThreadBuffer[posEndTmp++] = '\\';
-                intraThreadBuffer[posEndTmp++] = 'b';
+        return SHARDHASHINGFUNCTION((((uint64_t)objn) << 32) | bdba, shards);
+    }
+
+    //character after the backslash, 0 - copied as is
+    static const uint8_t escapeJsonMap[256] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 'b', 't', 'n', 0, 'f', 'r', 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, '"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '/',
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\', 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+    };
+
+    static inline uint8_t *escapeJsonChar(uint8_t *pos, uint8_t chr) {
+        if (escapeJsonMap[chr] != 0) {
+            *pos++ = '\\';
+            *pos++ = escapeJsonMap[chr];
+        } else
+            *pos++ = chr;
+        return pos;
+    }
+
+    //writes escaped text to out which must have room for 2 * length bytes, returns number of bytes written;
+    //blocks with no quote, backslash, slash or control character are copied as a whole,
+    //a block is always stored in full and only the clean prefix is kept, the reserved room covers it
+    uint64_t CommandBuffer::escapeJson(uint8_t *out, const uint8_t *text, uint64_t length) {
+        uint8_t *pos = out;
+        const uint8_t *end = text + length;
+
+#if defined(__AVX2__)
+        const __m256i quote32 = _mm256_set1_epi8('"'), backslash32 = _mm256_set1_epi8('\\'),
+                slash32 = _mm256_set1_epi8('/'), control32 = _mm256_set1_epi8(0x1F);
+        while (end - text >= 32) {
+            __m256i chunk = _mm256_loadu_si256((const __m256i*)text);
+            __m256i special = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote32), _mm256_cmpeq_epi8(chunk, backslash32)),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(chunk, slash32), _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control32), chunk)));
+            uint32_t mask = _mm256_movemask_epi8(special);
+            _mm256_storeu_si256((__m256i*)pos, chunk);
+
+            if (mask == 0) {
+                text += 32;
+                pos += 32;
             } else {
-                if (*str == '"' || *str == '\\' || *str == '/')
-                    intraThreadBuffer[posEndTmp++] = '\\';
-                intraThreadBuffer[posEndTmp++] = *(str++);
+                uint64_t clean = __builtin_ctz(mask);
+                text += clean;
+                pos = escapeJsonChar(pos + clean, *text++);
             }
-            --length;
+        }
+#endif
+#if defined(__SSE2__)
+        const __m128i quote16 = _mm_set1_epi8('"'), backslash16 = _mm_set1_epi8('\\'),
+                slash16 = _mm_set1_epi8('/'), control16 = _mm_set1_epi8(0x1F);
+        while (end - text >= 16) {
+            __m128i chunk = _mm_loadu_si128((const __m128i*)text);
+            __m128i special = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, quote16), _mm_cmpeq_epi8(chunk, backslash16)),
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, slash16), _mm_cmpeq_epi8(_mm_min_epu8(chunk, control16), chunk)));
+            uint32_t mask = _mm_movemask_epi8(special);
+            _mm_storeu_si128((__m128i*)pos, chunk);
+
+            if (mask == 0) {
+                text += 16;
+                pos += 16;
+            } else {
+                uint64_t clean = __builtin_ctz(mask);
+                text += clean;
+                pos = escapeJsonChar(pos + clean, *text++);
+            }
+        }
+#endif
+
+        while (text < end)
+            pos = escapeJsonChar(pos, *text++);
+
+        return pos - out;
+    }
+
+    CommandBuffer* CommandBuffer::appendEscape(const uint8_t *str, uint64_t length) {
+        if (posEndTmp + length * 2 > posSpanEnd) {
+            if (this->shutdown)
+                return this;
+
+            if (!reserve(length * 2))
+                return this;
         }
 
+        posEndTmp += escapeJson(intraThreadBuffer + posEndTmp, str, length);
+
         return this;
     }
 
     CommandBuffer* CommandBuffer::appendHex(uint64_t val, uint64_t length) {
         static const char* digits = "0123456789abcdef";
-        if (this->shutdown)
-            return this;
 
-        {
-            unique_lock<mutex> lck(mtx);
-            while (posSize > 0 && posEndTmp + length >= posStart) {
-                cerr << "WARNING, JSON buffer full, log reader suspended (2)" << endl;
-                writerCond.wait(lck);
-                if (this->shutdown)
-                    return this;
-            }
-        }
+        if (posEndTmp + length > posSpanEnd) {
+            if (this->shutdown)
+                return this;
 
-        if (posEndTmp + length >= outputBufferSize) {
-            cerr << "ERROR: JSON buffer overflow (5)" << endl;
-            return this;
+            if (!reserve(length))
+                return this;
         }
 
         for (uint64_t i = 0, j = (length - 1) * 4; i < length; ++i, j -= 4)
@@ -135,8 +286,6 @@ namespace OpenLogReplicator {
     }
 
     CommandBuffer* CommandBuffer::appendDec(uint64_t val) {
-        if (this->shutdown)
-            return this;
         char buffer[21];
         uint64_t length = 0;
 
@@ -151,19 +300,12 @@ namespace OpenLogReplicator {
             }
         }
 
-        {
-            unique_lock<mutex> lck(mtx);
-            while (posSize > 0 && posEndTmp + length >= posStart) {
-                cerr << "WARNING, JSON buffer full, log reader suspended (2)" << endl;
-                writerCond.wait(lck);
-                if (this->shutdown)
-                    return this;
-            }
-        }
+        if (posEndTmp + length > posSpanEnd) {
+            if (this->shutdown)
+                return this;
 
-        if (posEndTmp + length >= outputBufferSize) {
-            cerr << "ERROR: JSON buffer overflow (5)" << endl;
-            return this;
+            if (!reserve(length))
+                return this;
         }
 
         for (uint64_t i = 0; i < length; ++i)
@@ -186,7 +328,7 @@ namespace OpenLogReplicator {
         return this;
     }
 
-    CommandBuffer* CommandBuffer::appendOperation(string operation) {
+    CommandBuffer* CommandBuffer::appendOperation(const string &operation) {
         append("\"operation\":\"");
         append(operation);
         append('"');
@@ -194,25 +336,26 @@ namespace OpenLogReplicator {
         return this;
     }
 
-    CommandBuffer* CommandBuffer::appendTable(string owner, string table) {
-        append("\"table\":\"");
-        append(owner);
-        append('.');
-        append(table);
-        append('"');
+    CommandBuffer* CommandBuffer::appendTable(OracleObject *object) {
+        append(object->tableFragment);
 
         return this;
     }
 
-    CommandBuffer* CommandBuffer::appendNull(string columnName) {
-        append('"');
-        append(columnName);
-        append("\":null");
+    CommandBuffer* CommandBuffer::appendNull(OracleColumn *column) {
+        if (avroCapture) {
+            if (column->segColNo > 0 && column->segColNo <= avroColumns)
+                avroData[column->segColNo - 1] = nullptr;
+            return this;
+        }
+
+        append(column->nameFragment);
+        append("null");
 
         return this;
     }
 
-    CommandBuffer* CommandBuffer::appendMs(string name, uint64_t time) {
+    CommandBuffer* CommandBuffer::appendMs(const string &name, uint64_t time) {
         append('"');
         append(name);
         append("\":");
@@ -233,20 +376,26 @@ namespace OpenLogReplicator {
         return this;
     }
 
-    CommandBuffer* CommandBuffer::appendValue(string columnName, RedoLogRecord *redoLogRecord, uint64_t typeNo, uint64_t fieldPos, uint64_t fieldLength) {
-        uint64_t j, jMax;
-        uint8_t digits;
+    CommandBuffer* CommandBuffer::appendValue(OracleColumn *column, RedoLogRecord *redoLogRecord, uint64_t fieldPos, uint64_t fieldLength) {
+        uint64_t length;
 
         if (redoLogRecord->length == 0) {
             cerr << "ERROR, trying to output null data" << endl;
             return this;
         }
 
-        append('"');
-        append(columnName);
-        append("\":");
+        if (avroCapture) {
+            if (column->segColNo > 0 && column->segColNo <= avroColumns) {
+                avroData[column->segColNo - 1] = redoLogRecord->data + fieldPos;
+                avroLength[column->segColNo - 1] = fieldLength;
+            }
+            return this;
+        }
+
+        reserveSpan(column->nameFragment.length() + VALUE_LENGTH_MAX(fieldLength));
+        append(column->nameFragment);
 
-        switch(typeNo) {
+        switch(column->typeNo) {
         case 1: //varchar(2)
         case 96: //char
             append('\"');
@@ -255,121 +404,14 @@ namespace OpenLogReplicator {
             break;
 
         case 2: //numeric
-            digits = redoLogRecord->data[fieldPos + 0];
-            //just zero
-            if (digits == 0x80) {
-                append('0');
-                break;
-            }
-
-            j = 1;
-            jMax = fieldLength - 1;
-
-            //positive number
-            if (digits >= 0xC0 && jMax >= 1) {
-                uint64_t val;
-                //part of the total
-                if (digits == 0xC0)
-                    append('0');
-                else {
-                    digits -= 0xC0;
-                    //part of the total - omitting first zero for first digit
-                    val = redoLogRecord->data[fieldPos + j] - 1;
-                    if (val < 10)
-                        append('0' + val);
-                    else {
-                        append('0' + (val / 10));
-                        append('0' + (val % 10));
-                    }
-
-                    ++j;
-                    --digits;
-
-                    while (digits > 0) {
-                        val = redoLogRecord->data[fieldPos + j] - 1;
-                        if (j <= jMax) {
-                            append('0' + (val / 10));
-                            append('0' + (val % 10));
-                            ++j;
-                        } else {
-                            append('0');
-                            append('0');
-                        }
-                        --digits;
-                    }
-                }
-
-                //fraction part
-                if (j <= jMax) {
-                    append('.');
-
-                    while (j <= jMax - 1) {
-                        val = redoLogRecord->data[fieldPos + j] - 1;
-                        append('0' + (val / 10));
-                        append('0' + (val % 10));
-                        ++j;
-                    }
-
-                    //last digit - omitting 0 at the end
-                    val = redoLogRecord->data[fieldPos + j] - 1;
-                    append('0' + (val / 10));
-                    if ((val % 10) != 0)
-                        append('0' + (val % 10));
-                }
-            //negative number
-            } else if (digits <= 0x3F && fieldLength >= 2) {
-                uint64_t val;
-                append('-');
-
-                if (redoLogRecord->data[fieldPos + jMax] == 0x66)
-                    --jMax;
-
-                //part of the total
-                if (digits == 0x3F)
-                    append('0');
-                else {
-                    digits = 0x3F - digits;
-
-                    val = 101 - redoLogRecord->data[fieldPos + j];
-                    if (val < 10)
-                        append('0' + val);
-                    else
-                        append('0' + (val / 10));
-                        append('0' + (val % 10));
-                    ++j;
-                    --digits;
-
-                    while (digits > 0) {
-                        if (j <= jMax) {
-                            val = 101 - redoLogRecord->data[fieldPos + j];
-                            append('0' + (val / 10));
-                            append('0' + (val % 10));
-                            ++j;
-                        } else {
-                            append('0');
-                            append('0');
-                        }
-                        --digits;
-                    }
-                }
-
-                if (j <= jMax) {
-                    append('.');
-
-                    while (j <= jMax - 1) {
-                        val = 101 - redoLogRecord->data[fieldPos + j];
-                        append('0' + (val / 10));
-                        append('0' + (val % 10));
-                        ++j;
-                    }
-
-                    val = 101 - redoLogRecord->data[fieldPos + j];
-                    append('0' + (val / 10));
-                    if ((val % 10) != 0)
-                        append('0' + (val % 10));
+            length = OracleNumber::textLength(redoLogRecord->data + fieldPos, fieldLength);
+            if (length > 0) {
+                if (reserveSpan(length)) {
+                    OracleNumber::toText(redoLogRecord->data + fieldPos, fieldLength, (char*)intraThreadBuffer + posEndTmp);
+                    posEndTmp += length;
                 }
             } else {
-                cerr << "ERROR: unknown value (type: " << typeNo << "): " << dec << fieldLength << " - ";
+                cerr << "ERROR: unknown value (type: " << column->typeNo << "): " << dec << fieldLength << " - ";
                 for (uint64_t j = 0; j < fieldLength; ++j)
                     cout << " " << hex << setw(2) << (uint64_t) redoLogRecord->data[fieldPos + j];
                 cout << endl;
@@ -378,116 +420,41 @@ namespace OpenLogReplicator {
 
         case 12:
         case 180:
-            if (fieldLength != 7 && fieldLength != 11) {
-                cerr << "ERROR: unknown value (type: " << typeNo << "): ";
+            if ((fieldLength != 7 && fieldLength != 11) ||
+                    redoLogRecord->data[fieldPos + 2] < 1 || redoLogRecord->data[fieldPos + 2] > 12 ||
+                    redoLogRecord->data[fieldPos + 3] < 1 || redoLogRecord->data[fieldPos + 3] > 31 ||
+                    redoLogRecord->data[fieldPos + 4] < 1 || redoLogRecord->data[fieldPos + 4] > 24 ||
+                    redoLogRecord->data[fieldPos + 5] < 1 || redoLogRecord->data[fieldPos + 5] > 60 ||
+                    redoLogRecord->data[fieldPos + 6] < 1 || redoLogRecord->data[fieldPos + 6] > 60) {
+                cerr << "ERROR: unknown value (type: " << column->typeNo << "): ";
                 for (uint64_t j = 0; j < fieldLength; ++j)
                     cout << " " << hex << setfill('0') << setw(2) << (uint64_t)redoLogRecord->data[fieldPos + j];
                 cout << endl;
-                append('null');
+                append("null");
             } else if (timestampFormat == 0) {
                 //2012-04-23T18:25:43.511Z - ISO 8601 format
-                append('\"');
-                uint64_t val1 = redoLogRecord->data[fieldPos + 0],
-                         val2 = redoLogRecord->data[fieldPos + 1];
-                bool bc = false;
-
-                //AD
-                if (val1 >= 100 && val2 >= 100) {
-                    val1 -= 100;
-                    val2 -= 100;
-                //BC
-                } else {
-                    val1 = 100 - val1;
-                    val2 = 100 - val2;
-                    bc = true;
-                }
-                if (val1 > 0) {
-                    if (val1 > 10) {
-                        append('0' + (val1 / 10));
-                        append('0' + (val1 % 10));
-                        append('0' + (val2 / 10));
-                        append('0' + (val2 % 10));
-                    } else {
-                        append('0' + val1);
-                        append('0' + (val2 / 10));
-                        append('0' + (val2 % 10));
-                    }
-                } else {
-                    if (val2 > 10) {
-                        append('0' + (val2 / 10));
-                        append('0' + (val2 % 10));
-                    } else
-                        append('0' + val2);
-                }
-
-                if (bc)
-                    append("BC");
-
-                append('-');
-                append('0' + (redoLogRecord->data[fieldPos + 2] / 10));
-                append('0' + (redoLogRecord->data[fieldPos + 2] % 10));
-                append('-');
-                append('0' + (redoLogRecord->data[fieldPos + 3] / 10));
-                append('0' + (redoLogRecord->data[fieldPos + 3] % 10));
-                append('T');
-                append('0' + ((redoLogRecord->data[fieldPos + 4] - 1) / 10));
-                append('0' + ((redoLogRecord->data[fieldPos + 4] - 1) % 10));
-                append(':');
-                append('0' + ((redoLogRecord->data[fieldPos + 5] - 1) / 10));
-                append('0' + ((redoLogRecord->data[fieldPos + 5] - 1) % 10));
-                append(':');
-                append('0' + ((redoLogRecord->data[fieldPos + 6] - 1) / 10));
-                append('0' + ((redoLogRecord->data[fieldPos + 6] - 1) % 10));
-
-                if (fieldLength == 11) {
-                    uint64_t digits = 0;
-                    uint8_t buffer[10];
-                    uint64_t val = oracleReader->read32Big(redoLogRecord->data + fieldPos + 7);
-
-                    for (int64_t i = 9; i > 0; --i) {
-                        buffer[i] = val % 10;
-                        val /= 10;
-                        if (buffer[i] != 0 && digits == 0)
-                            digits = i;
-                    }
-
-                    if (digits > 0) {
-                        append('.');
-                        for (uint64_t i = 1; i <= digits; ++i)
-                            append(buffer[i] + '0');
-                    }
-                }
-                append('\"');
+                if (reserveSpan(DATE_TEXT_MAX))
+                    posEndTmp += formatDate((char*)intraThreadBuffer + posEndTmp, redoLogRecord->data + fieldPos, fieldLength);
             } else if (timestampFormat == 1) {
                 //unix epoch format
-                struct tm epochtime;
-                uint64_t val1 = redoLogRecord->data[fieldPos + 0],
-                         val2 = redoLogRecord->data[fieldPos + 1];
+                const uint8_t *data = redoLogRecord->data + fieldPos;
 
                 //AD
-                if (val1 >= 100 && val2 >= 100) {
-                    val1 -= 100;
-                    val2 -= 100;
-                    uint64_t year;
-                    year = val1 * 100 + val2;
-                    if (year >= 1900) {
-                        epochtime.tm_sec = redoLogRecord->data[fieldPos + 6] - 1;
-                        epochtime.tm_min = redoLogRecord->data[fieldPos + 5] - 1;
-                        epochtime.tm_hour = redoLogRecord->data[fieldPos + 4] - 1;
-                        epochtime.tm_mday = redoLogRecord->data[fieldPos + 3];
-                        epochtime.tm_mon = redoLogRecord->data[fieldPos + 2] - 1;
-                        epochtime.tm_year = year - 1900;
-
-                        uint64_t fraction = 0;
-                        if (fieldLength == 11)
-                            fraction = oracleReader->read32Big(redoLogRecord->data + fieldPos + 7);
-
-                        appendDec(mktime(&epochtime) * 1000 + ((fraction + 500000) / 1000000));
-                    } else {
-                        append('null');
-                    }
+                if (data[0] >= 100 && data[1] >= 100) {
+                    int64_t year = (data[0] - 100) * 100 + data[1] - 100;
+                    int64_t time = (typetime::daysFromCivil(year, data[2], data[3]) * 86400 +
+                            (data[4] - 1) * 3600 + (data[5] - 1) * 60 + data[6] - 1) * 1000;
+
+                    if (fieldLength == 11)
+                        time += (oracleReader->read32Big(data + 7) + 500000) / 1000000;
+
+                    if (time < 0) {
+                        append('-');
+                        appendDec(-time);
+                    } else
+                        appendDec(time);
                 } else {
-                    append('null');
+                    append("null");
                 }
             }
             break;
@@ -499,24 +466,104 @@ namespace OpenLogReplicator {
         return this;
     }
 
-    CommandBuffer* CommandBuffer::append(const string str) {
-        if (this->shutdown)
-            return this;
+    //DATE or TIMESTAMP as quoted ISO 8601 text, the date part is kept for the next value since rows of a transaction
+    //usually share the day, returns number of characters written
+    uint64_t CommandBuffer::formatDate(char *text, const uint8_t *data, uint64_t length) {
+        const char *pairs = OracleNumber::digitPairs;
+        char *pos = text;
+        *pos++ = '"';
+
+        if (lastDateLength == 0 || memcmp(lastDate, data, 4) != 0) {
+            uint64_t val1 = data[0], val2 = data[1];
+            bool bc = false;
+            char *date = lastDateText;
+
+            //AD
+            if (val1 >= 100 && val2 >= 100) {
+                val1 -= 100;
+                val2 -= 100;
+            //BC
+            } else {
+                val1 = 100 - val1;
+                val2 = 100 - val2;
+                bc = true;
+            }
 
-        uint64_t length = str.length();
-        {
-            unique_lock<mutex> lck(mtx);
-            while (posSize > 0 && posEndTmp + length >= posStart) {
-                cerr << "WARNING, JSON buffer full, log reader suspended (2)" << endl;
-                writerCond.wait(lck);
-                if (this->shutdown)
-                    return this;
+            if (val1 >= 10) {
+                *date++ = pairs[val1 * 2];
+                *date++ = pairs[val1 * 2 + 1];
+                *date++ = pairs[val2 * 2];
+                *date++ = pairs[val2 * 2 + 1];
+            } else if (val1 > 0) {
+                *date++ = '0' + val1;
+                *date++ = pairs[val2 * 2];
+                *date++ = pairs[val2 * 2 + 1];
+            } else if (val2 >= 10) {
+                *date++ = pairs[val2 * 2];
+                *date++ = pairs[val2 * 2 + 1];
+            } else
+                *date++ = '0' + val2;
+
+            if (bc) {
+                *date++ = 'B';
+                *date++ = 'C';
             }
+
+            *date++ = '-';
+            *date++ = pairs[data[2] * 2];
+            *date++ = pairs[data[2] * 2 + 1];
+            *date++ = '-';
+            *date++ = pairs[data[3] * 2];
+            *date++ = pairs[data[3] * 2 + 1];
+
+            memcpy(lastDate, data, 4);
+            lastDateLength = date - lastDateText;
         }
 
-        if (posEndTmp + length >= outputBufferSize) {
-            cerr << "ERROR: JSON buffer overflow (2)" << endl;
-            return this;
+        memcpy(pos, lastDateText, lastDateLength);
+        pos += lastDateLength;
+
+        *pos++ = 'T';
+        *pos++ = pairs[(data[4] - 1) * 2];
+        *pos++ = pairs[(data[4] - 1) * 2 + 1];
+        *pos++ = ':';
+        *pos++ = pairs[(data[5] - 1) * 2];
+        *pos++ = pairs[(data[5] - 1) * 2 + 1];
+        *pos++ = ':';
+        *pos++ = pairs[(data[6] - 1) * 2];
+        *pos++ = pairs[(data[6] - 1) * 2 + 1];
+
+        //nanoseconds, omitting 0 at the end
+        if (length == 11) {
+            uint64_t val = oracleReader->read32Big(data + 7) % 1000000000;
+            if (val > 0) {
+                char fraction[9];
+                for (int64_t i = 8; i >= 0; --i) {
+                    fraction[i] = '0' + (val % 10);
+                    val /= 10;
+                }
+                uint64_t digits = 9;
+                while (fraction[digits - 1] == '0')
+                    --digits;
+
+                *pos++ = '.';
+                memcpy(pos, fraction, digits);
+                pos += digits;
+            }
+        }
+
+        *pos++ = '"';
+        return pos - text;
+    }
+
+    CommandBuffer* CommandBuffer::append(const string &str) {
+        uint64_t length = str.length();
+        if (posEndTmp + length > posSpanEnd) {
+            if (this->shutdown)
+                return this;
+
+            if (!reserve(length))
+                return this;
         }
 
         memcpy(intraThreadBuffer + posEndTmp, str.c_str(), length);
@@ -525,6 +572,21 @@ namespace OpenLogReplicator {
         return this;
     }
 
+    CommandBuffer* CommandBuffer::append(const uint8_t *str, uint64_t length) {
+        if (posEndTmp + length > posSpanEnd) {
+            if (this->shutdown)
+                return this;
+
+            if (!reserve(length))
+                return this;
+        }
+
+        memcpy(intraThreadBuffer + posEndTmp, str, length);
+        posEndTmp += length;
+
+        return this;
+    }
+
     char CommandBuffer::translationMap[65] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
     CommandBuffer* CommandBuffer::appendRowid(typeobj objn, typeobj objd, typedba bdba, typeslot slot) {
@@ -554,22 +616,12 @@ namespace OpenLogReplicator {
     }
 
     CommandBuffer* CommandBuffer::append(char chr) {
-        if (this->shutdown)
-            return this;
-
-        {
-            unique_lock<mutex> lck(mtx);
-            while (posSize > 0 && posEndTmp + 1 >= posStart) {
-                cerr << "WARNING, JSON buffer full, log reader suspended (3)" << endl;
-                writerCond.wait(lck);
-                if (this->shutdown)
-                    return this;
-            }
-        }
+        if (posEndTmp + 1 > posSpanEnd) {
+            if (this->shutdown)
+                return this;
 
-        if (posEndTmp + 1 >= outputBufferSize) {
-            cerr << "ERROR: JSON buffer overflow (3)" << endl;
-            return this;
+            if (!reserve(1))
+                return this;
         }
 
         intraThreadBuffer[posEndTmp++] = chr;
@@ -577,82 +629,109 @@ namespace OpenLogReplicator {
         return this;
     }
 
-    CommandBuffer* CommandBuffer::appendDbzCols(OracleObject *object) {
+    void CommandBuffer::escapeString(string &str, const uint8_t *text, uint64_t length) {
+        while (length > 0) {
+            if (*text == '\t')
+                str.append("\\t");
+            else if (*text == '\r')
+                str.append("\\r");
+            else if (*text == '\n')
+                str.append("\\n");
+            else if (*text == '\f')
+                str.append("\\f");
+            else if (*text == '\b')
+                str.append("\\b");
+            else {
+                if (*text == '"' || *text == '\\' || *text == '/')
+                    str.append(1, '\\');
+                str.append(1, (char)*text);
+            }
+            ++text;
+            --length;
+        }
+    }
+
+    void CommandBuffer::buildDbzCols(string &str, OracleObject *object) {
+        bool prevValue = false;
         for (uint64_t i = 0; i < object->columns.size(); ++i) {
             bool microTimestamp = false;
 
-            if (i > 0)
-                append(',');
+            if (!COLUMNPROJECTED(object, i))
+                continue;
+            if (prevValue)
+                str.append(1, ',');
+            else
+                prevValue = true;
 
-            append("{\"type\":\"");
+            str.append("{\"type\":\"");
             switch(object->columns[i]->typeNo) {
             case 1: //varchar(2)
             case 96: //char
-                append("string");
+                str.append("string");
                 break;
 
             case 2: //numeric
                 if (object->columns[i]->scale > 0)
-                    append("Decimal");
+                    str.append("Decimal");
                 else {
                     uint64_t digits = object->columns[i]->precision - object->columns[i]->scale;
                     if (digits < 3)
-                        append("int8");
+                        str.append("int8");
                     else if (digits < 5)
-                        append("int16");
+                        str.append("int16");
                     else if (digits < 10)
-                        append("int32");
+                        str.append("int32");
                     else if (digits < 19)
-                        append("int64");
+                        str.append("int64");
                     else
-                        append("Decimal");
+                        str.append("Decimal");
                 }
                 break;
 
             case 12:
             case 180:
                 if (timestampFormat == 0)
-                    append("datetime");
+                    str.append("datetime");
                 else if (timestampFormat == 1) {
-                    append("int64");
+                    str.append("int64");
                     microTimestamp = true;
                 }
                 break;
             }
-            append("\",\"optional\":");
+            str.append("\",\"optional\":");
             if (object->columns[i]->nullable)
-                append("true");
+                str.append("true");
             else
-                append("false");
+                str.append("false");
 
             if (microTimestamp)
-                append(",\"name\":\"io.debezium.time.MicroTimestamp\",\"version\":1");
-            append(",\"field\":\"");
-            append(object->columns[i]->columnName);
-            append("\"}");
+                str.append(",\"name\":\"io.debezium.time.MicroTimestamp\",\"version\":1");
+            str.append(",\"field\":\"");
+            escapeString(str, (const uint8_t*)object->columns[i]->columnName.c_str(), object->columns[i]->columnName.length());
+            str.append("\"}");
         }
     }
 
-    CommandBuffer* CommandBuffer::appendDbzHead(OracleObject *object) {
-        append("{\"schema\":{\"type\":\"struct\",\"fields\":[");
-        append("{\"type\":\"struct\",\"fields\":[");
-        appendDbzCols(object);
-        append("],\"optional\":true,\"name\":\"");
-        append(oracleReader->alias);
-        append('.');
-        append(object->owner);
-        append('.');
-        append(object->objectName);
-        append(".Value\",\"field\":\"before\"},");
-        append("{\"type\":\"struct\",\"fields\":[");
-        appendDbzCols(object);
-        append("],\"optional\":true,\"name\":\"");
-        append(oracleReader->alias);
-        append('.');
-        append(object->owner);
-        append('.');
-        append(object->objectName);
-        append(".Value\",\"field\":\"after\"},"
+    void CommandBuffer::buildDbzHead(string &str, OracleObject *object) {
+        str.append("{\"schema\":{\"type\":\"struct\",\"fields\":[");
+        str.append("{\"type\":\"struct\",\"fields\":[");
+        buildDbzCols(str, object);
+        str.append("],\"optional\":true,\"name\":\"");
+        str.append(oracleReader->alias);
+        str.append(1, '.');
+        str.append(object->owner);
+        str.append(1, '.');
+        str.append(object->objectName);
+        str.append(".Value\",\"field\":\"before\"},");
+        str.append("{\"type\":\"struct\",\"fields\":[");
+        buildDbzCols(str, object);
+        str.append("],\"optional\":true,\"name\":\"");
+        str.append(oracleReader->alias);
+        str.append(1, '.');
+        str.append(object->owner);
+        str.append(1, '.');
+        str.append(object->objectName);
+        str.append(".Value\",\"field\":\"after\"},"
                 "{\"type\":\"struct\",\"fields\":["
                 "{\"type\":\"string\",\"optional\":false,\"field\":\"version\"},"
                 "{\"type\":\"string\",\"optional\":false,\"field\":\"connector\"},"
@@ -674,6 +753,44 @@ namespace OpenLogReplicator {
                 "{\"type\":\"int64\",\"optional\":false,\"field\":\"data_collection_order\"}],\"optional\":true,\"field\":\"transaction\"},"
                 "{\"type\":\"string\",\"optional\":true,\"field\":\"messagetopic\"},"
                 "{\"type\":\"string\",\"optional\":true,\"field\":\"messagesource\"}],\"optional\":false,\"name\":\"asgard.DEBEZIUM.CUSTOMERS.Envelope\"},\"payload\":{");
+    }
+
+    //fragments of output which do not change from row to row, built once when table is added to dictionary
+    void CommandBuffer::buildFragments(OracleObject *object) {
+        object->tableFragment = "\"table\":\"";
+        escapeString(object->tableFragment, (const uint8_t*)object->owner.c_str(), object->owner.length());
+        object->tableFragment.append(1, '.');
+        escapeString(object->tableFragment, (const uint8_t*)object->objectName.c_str(), object->objectName.length());
+        object->tableFragment.append(1, '"');
+
+        for (auto column : object->columns) {
+            column->nameFragment = "\"";
+            escapeString(column->nameFragment, (const uint8_t*)column->columnName.c_str(), column->columnName.length());
+            column->nameFragment.append("\":");
+        }
+
+        object->dbzHeadFragment.clear();
+        buildDbzHead(object->dbzHeadFragment, object);
+
+        if (stream == STREAM_AVRO) {
+            buildAvroSchema(object);
+            publishAvroSchema(object);
+        }
+
+        if (stream == STREAM_ARROW)
+            ArrowBatch::buildSchema(object);
+
+        //row without values: message envelope and every column name twice (before and after image)
+        object->rowLengthMax = 512 + object->tableFragment.length() + object->dbzHeadFragment.length() +
+                object->owner.length() + object->objectName.length();
+        if (oracleReader != nullptr)
+            object->rowLengthMax += oracleReader->alias.length() + oracleReader->databaseContext.length();
+        for (auto column : object->columns)
+            object->rowLengthMax += 2 * (column->nameFragment.length() + 1 + VALUE_LENGTH_MAX(0));
+    }
+
+    CommandBuffer* CommandBuffer::appendDbzHead(OracleObject *object) {
+        append(object->dbzHeadFragment);
         return this;
     }
 
@@ -712,25 +829,374 @@ namespace OpenLogReplicator {
         return this;
     }
 
-    CommandBuffer* CommandBuffer::beginTran() {
-        if (this->shutdown)
+    uint64_t CommandBuffer::avroType(OracleColumn *column) {
+        switch (column->typeNo) {
+        case 1: //varchar(2)
+        case 96: //char
+            return AVRO_TYPE_STRING;
+
+        case 2: //numeric
+            if (column->precision > 0 && column->precision <= 18 && column->scale == 0)
+                return AVRO_TYPE_LONG;
+            if (column->precision > 0 && column->precision <= 38 && column->scale >= 0)
+                return AVRO_TYPE_DECIMAL;
+            return AVRO_TYPE_STRING;
+
+        case 12:
+            return AVRO_TYPE_TIMESTAMP_MILLIS;
+
+        case 180:
+            return AVRO_TYPE_TIMESTAMP_MICROS;
+
+        default:
+            return AVRO_TYPE_BYTES;
+        }
+    }
+
+    //Rabin fingerprint of the Avro specification
+    uint64_t CommandBuffer::avroFingerprint(const string &schema) {
+        static uint64_t table[256];
+        static bool initialized = false;
+
+        if (!initialized) {
+            for (uint64_t i = 0; i < 256; ++i) {
+                uint64_t fp = i;
+                for (uint64_t j = 0; j < 8; ++j)
+                    fp = (fp >> 1) ^ (0xC15D213AA4D7A795ULL & (0 - (fp & 1)));
+                table[i] = fp;
+            }
+            initialized = true;
+        }
+
+        uint64_t fp = 0xC15D213AA4D7A795ULL;
+        for (uint64_t i = 0; i < schema.length(); ++i)
+            fp = (fp >> 8) ^ table[(fp ^ (uint8_t)schema[i]) & 0xFF];
+        return fp;
+    }
+
+    //Avro names allow only letters, digits and underscore
+    static void appendAvroName(string &str, const string &name) {
+        for (uint64_t i = 0; i < name.length(); ++i) {
+            char chr = name[i];
+            if ((chr >= 'A' && chr <= 'Z') || (chr >= 'a' && chr <= 'z') || chr == '_' || (chr >= '0' && chr <= '9' && i > 0))
+                str.append(1, chr);
+            else
+                str.append(1, '_');
+        }
+    }
+
+    //full schema is published, fingerprint is taken from the parsing canonical form which has no logical types and defaults
+    void CommandBuffer::buildAvroSchema(OracleObject *object) {
+        string ns, canonical, cols, canonicalCols;
+        appendAvroName(ns, object->owner);
+        ns.append(1, '.');
+        appendAvroName(ns, object->objectName);
+
+        for (uint64_t i = 0; i < object->columns.size(); ++i) {
+            if (!COLUMNPROJECTED(object, i))
+                continue;
+            OracleColumn *column = object->columns[i];
+
+            if (cols.length() > 0) {
+                cols.append(1, ',');
+                canonicalCols.append(1, ',');
+            }
+            cols.append("{\"name\":\"");
+            appendAvroName(cols, column->columnName);
+            cols.append("\",\"type\":[\"null\",");
+            canonicalCols.append("{\"name\":\"");
+            appendAvroName(canonicalCols, column->columnName);
+            canonicalCols.append("\",\"type\":[\"null\",");
+
+            switch (avroType(column)) {
+            case AVRO_TYPE_STRING:
+                cols.append("\"string\"");
+                canonicalCols.append("\"string\"");
+                break;
+
+            case AVRO_TYPE_LONG:
+                cols.append("\"long\"");
+                canonicalCols.append("\"long\"");
+                break;
+
+            case AVRO_TYPE_DECIMAL:
+                cols.append("{\"type\":\"bytes\",\"logicalType\":\"decimal\",\"precision\":" + to_string(column->precision) +
+                        ",\"scale\":" + to_string(column->scale) + "}");
+                canonicalCols.append("\"bytes\"");
+                break;
+
+            case AVRO_TYPE_TIMESTAMP_MILLIS:
+                cols.append("{\"type\":\"long\",\"logicalType\":\"timestamp-millis\"}");
+                canonicalCols.append("\"long\"");
+                break;
+
+            case AVRO_TYPE_TIMESTAMP_MICROS:
+                cols.append("{\"type\":\"long\",\"logicalType\":\"timestamp-micros\"}");
+                canonicalCols.append("\"long\"");
+                break;
+
+            default:
+                cols.append("\"bytes\"");
+                canonicalCols.append("\"bytes\"");
+            }
+            cols.append("],\"default\":null}");
+            canonicalCols.append("]}");
+        }
+
+        object->avroSchema = "{\"type\":\"record\",\"name\":\"Envelope\",\"namespace\":\"" + ns + "\",\"fields\":["
+                "{\"name\":\"op\",\"type\":{\"type\":\"enum\",\"name\":\"Operation\",\"symbols\":[\"c\",\"u\",\"d\"]}},"
+                "{\"name\":\"scn\",\"type\":\"long\"},"
+                "{\"name\":\"xid\",\"type\":\"string\"},"
+                "{\"name\":\"ts_ms\",\"type\":{\"type\":\"long\",\"logicalType\":\"timestamp-millis\"}},"
+                "{\"name\":\"before\",\"type\":[\"null\",{\"type\":\"record\",\"name\":\"Value\",\"fields\":[" + cols + "]}],\"default\":null},"
+                "{\"name\":\"after\",\"type\":[\"null\",\"Value\"],\"default\":null}]}";
+
+        canonical = "{\"name\":\"" + ns + ".Envelope\",\"type\":\"record\",\"fields\":["
+                "{\"name\":\"op\",\"type\":{\"name\":\"" + ns + ".Operation\",\"type\":\"enum\",\"symbols\":[\"c\",\"u\",\"d\"]}},"
+                "{\"name\":\"scn\",\"type\":\"long\"},"
+                "{\"name\":\"xid\",\"type\":\"string\"},"
+                "{\"name\":\"ts_ms\",\"type\":\"long\"},"
+                "{\"name\":\"before\",\"type\":[\"null\",{\"name\":\"" + ns + ".Value\",\"type\":\"record\",\"fields\":[" + canonicalCols + "]}]},"
+                "{\"name\":\"after\",\"type\":[\"null\",\"" + ns + ".Value\"]}]}";
+
+        object->avroFingerprint = avroFingerprint(canonical);
+    }
+
+    //schema store stand-in: one file per fingerprint, written once
+    void CommandBuffer::publishAvroSchema(OracleObject *object) {
+        stringstream name;
+        name << avroSchemaPath << "/" << setfill('0') << setw(16) << hex << object->avroFingerprint << ".avsc";
+
+        struct stat fileStat;
+        if (stat(name.str().c_str(), &fileStat) == 0)
+            return;
+
+        ofstream outfile;
+        outfile.open(name.str().c_str(), ios::out | ios::trunc);
+        if (!outfile.is_open()) {
+            cerr << "ERROR: writing Avro schema to " << name.str() << endl;
+            return;
+        }
+        outfile << object->avroSchema << endl;
+        outfile.close();
+    }
+
+    //zigzag varint
+    uint8_t *CommandBuffer::writeAvroLong(uint8_t *pos, int64_t val) {
+        uint64_t zigzag = (((uint64_t)val) << 1) ^ ((uint64_t)(val >> 63));
+        while (zigzag >= 0x80) {
+            *pos++ = (uint8_t)(zigzag | 0x80);
+            zigzag >>= 7;
+        }
+        *pos++ = (uint8_t)zigzag;
+        return pos;
+    }
+
+    //DATE or TIMESTAMP as milliseconds or microseconds since epoch, false - not a valid value
+    bool CommandBuffer::epochTime(const uint8_t *data, uint64_t length, bool micros, int64_t &time) {
+        if ((length != 7 && length != 11) || data[0] < 100 || data[1] < 100 || data[2] < 1 || data[2] > 12 || data[3] < 1 || data[3] > 31 ||
+                data[4] < 1 || data[4] > 24 || data[5] < 1 || data[5] > 60 || data[6] < 1 || data[6] > 60)
+            return false;
+
+        int64_t year = (data[0] - 100) * 100 + data[1] - 100;
+        time = typetime::daysFromCivil(year, data[2], data[3]) * 86400 + (data[4] - 1) * 3600 + (data[5] - 1) * 60 + data[6] - 1;
+        uint64_t fraction = 0;
+        if (length == 11)
+            fraction = OracleReader::read32Big(data + 7);
+
+        if (micros)
+            time = time * 1000000 + fraction / 1000;
+        else
+            time = time * 1000 + fraction / 1000000;
+        return true;
+    }
+
+    //union of null and the column type, out needs length + NUMBER_TEXT_MAX + 24 bytes
+    uint8_t *CommandBuffer::writeAvroValue(uint8_t *pos, OracleColumn *column, const uint8_t *data, uint64_t length) {
+        if (data == nullptr || length == 0) {
+            *pos++ = 0;
+            return pos;
+        }
+
+        switch (avroType(column)) {
+        case AVRO_TYPE_STRING:
+            if (column->typeNo == 2) {
+                uint64_t textLength = OracleNumber::textLength(data, length);
+                if (textLength == 0)
+                    break;
+                *pos++ = 2;
+                pos = writeAvroLong(pos, textLength);
+                pos += OracleNumber::toText(data, length, (char*)pos);
+                return pos;
+            }
+            *pos++ = 2;
+            pos = writeAvroLong(pos, length);
+            memcpy(pos, data, length);
+            return pos + length;
+
+        case AVRO_TYPE_LONG: {
+            int64_t val;
+            if (!OracleNumber::toInt64(data, length, val))
+                break;
+            *pos++ = 2;
+            return writeAvroLong(pos, val);
+        }
+
+        case AVRO_TYPE_DECIMAL: {
+            //unscaled value in big-endian two's complement with the scale of the column
+            typedec128 val;
+            uint64_t scale;
+            if (!OracleNumber::toDecimal128(data, length, val, scale))
+                break;
+            for (; scale < (uint64_t)column->scale; ++scale)
+                val *= 10;
+            for (; scale > (uint64_t)column->scale; --scale)
+                val /= 10;
+
+            uint8_t bytes[16];
+            for (int64_t i = 15; i >= 0; --i) {
+                bytes[i] = (uint8_t)val;
+                val >>= 8;
+            }
+            uint64_t start = 0;
+            while (start < 15 && ((bytes[start] == 0x00 && (bytes[start + 1] & 0x80) == 0) ||
+                    (bytes[start] == 0xFF && (bytes[start + 1] & 0x80) != 0)))
+                ++start;
+
+            *pos++ = 2;
+            pos = writeAvroLong(pos, 16 - start);
+            memcpy(pos, bytes + start, 16 - start);
+            return pos + 16 - start;
+        }
+
+        case AVRO_TYPE_TIMESTAMP_MILLIS:
+        case AVRO_TYPE_TIMESTAMP_MICROS: {
+            int64_t time;
+            if (!epochTime(data, length, avroType(column) == AVRO_TYPE_TIMESTAMP_MICROS, time))
+                break;
+
+            *pos++ = 2;
+            return writeAvroLong(pos, time);
+        }
+
+        default:
+            *pos++ = 2;
+            pos = writeAvroLong(pos, length);
+            memcpy(pos, data, length);
+            return pos + length;
+        }
+
+        //value not representable in the declared type
+        *pos++ = 0;
+        return pos;
+    }
+
+    //single object encoding: marker, schema fingerprint and the envelope fields before the row images
+    CommandBuffer* CommandBuffer::appendAvroHead(OracleObject *object, uint64_t op, typescn scn, typexid xid, uint64_t time) {
+        if (!reserveSpan(128))
             return this;
 
-        {
-            unique_lock<mutex> lck(mtx);
-            while (posSize > 0 && posEndTmp + 8 >= posStart) {
-                cerr << "WARNING, JSON buffer full, log reader suspended (8)" << endl;
-                writerCond.wait(lck);
-                if (this->shutdown)
-                    return this;
+        uint8_t *pos = intraThreadBuffer + posEndTmp;
+        *pos++ = 0xC3;
+        *pos++ = 0x01;
+        for (uint64_t i = 0; i < 8; ++i)
+            *pos++ = (uint8_t)(object->avroFingerprint >> (i * 8));
+
+        pos = writeAvroLong(pos, op);
+        pos = writeAvroLong(pos, scn);
+
+        string xidText = to_string(USN(xid)) + "." + to_string(SLT(xid)) + "." + to_string(SQN(xid));
+        pos = writeAvroLong(pos, xidText.length());
+        memcpy(pos, xidText.c_str(), xidText.length());
+        pos += xidText.length();
+
+        pos = writeAvroLong(pos, time);
+        posEndTmp = pos - intraThreadBuffer;
+
+        return this;
+    }
+
+    CommandBuffer* CommandBuffer::beginAvroImage(OracleObject *object) {
+        if (avroColumns < object->columns.size()) {
+            if (avroData != nullptr)
+                delete[] avroData;
+            if (avroLength != nullptr)
+                delete[] avroLength;
+            avroColumns = object->columns.size();
+            avroData = new const uint8_t*[avroColumns];
+            avroLength = new uint64_t[avroColumns];
+
+            if (avroData == nullptr || avroLength == nullptr) {
+                cerr << "ERROR: could not allocate memory for Avro row (" << dec << avroColumns << " columns)" << endl;
+                throw MemoryException("out of memory");
             }
         }
 
-        if (posEndTmp + 8 >= outputBufferSize) {
-            cerr << "ERROR: JSON buffer overflow (8)" << endl;
+        memset(avroData, 0, object->columns.size() * sizeof(const uint8_t*));
+        avroCapture = true;
+        return this;
+    }
+
+    CommandBuffer* CommandBuffer::endAvroImage(OracleObject *object) {
+        avroCapture = false;
+        if (!reserveSpan(1))
             return this;
+        intraThreadBuffer[posEndTmp++] = 2;
+
+        for (uint64_t i = 0; i < object->columns.size(); ++i) {
+            if (!COLUMNPROJECTED(object, i))
+                continue;
+
+            OracleColumn *column = object->columns[i];
+            const uint8_t *data = nullptr;
+            uint64_t length = 0;
+            if (column->segColNo > 0 && column->segColNo <= avroColumns && avroData[column->segColNo - 1] != nullptr) {
+                data = avroData[column->segColNo - 1];
+                length = avroLength[column->segColNo - 1];
+            }
+
+            if (!reserveSpan(length + NUMBER_TEXT_MAX + 24))
+                return this;
+            posEndTmp = writeAvroValue(intraThreadBuffer + posEndTmp, column, data, length) - intraThreadBuffer;
         }
 
+        return this;
+    }
+
+    //missing before or after image
+    CommandBuffer* CommandBuffer::appendAvroNullImage(void) {
+        append((char)0);
+        return this;
+    }
+
+    //one check for a whole row: space up to posSpanEnd is guaranteed, so appends inside it skip
+    //the shutdown, wait and overflow checks, spans too big for the buffer fall back to checked appends
+    bool CommandBuffer::reserveSpan(uint64_t length) {
+        if (posEndTmp + length <= posSpanEnd)
+            return true;
+
+        if (this->shutdown || length > outputBufferSize / 4)
+            return false;
+
+        if (!reserve(length))
+            return false;
+
+        posSpanEnd = posEndTmp + length;
+        return true;
+    }
+
+    //unused part of the span is given back
+    void CommandBuffer::commitSpan(void) {
+        posSpanEnd = 0;
+    }
+
+    CommandBuffer* CommandBuffer::beginTran() {
+        if (this->shutdown)
+            return this;
+
+        if (!reserve(8))
+            return this;
+
         *((uint64_t*)(intraThreadBuffer + posEndTmp)) = 0;
         posEndTmp += 8;
 
@@ -743,42 +1209,175 @@ namespace OpenLogReplicator {
             return this;
         }
 
-        {
+        posSpanEnd = 0;
+        *((uint64_t*)(intraThreadBuffer + posEnd)) = posEndTmp - posEnd;
+        posEndTmp = (posEndTmp + 7) & 0xFFFFFFFFFFFFFFF8;
+        //message which crossed the end continued in the mirror, the next one starts in the first mapping
+        if (posEndTmp >= outputBufferSize) {
+            posEndTmp -= outputBufferSize;
+            posLimit -= outputBufferSize;
+        }
+        //message is published with a single store
+        posEnd.store(posEndTmp, memory_order_seq_cst);
+        if (readersWaiting.load(memory_order_seq_cst) > 0) {
             unique_lock<mutex> lck(mtx);
-            *((uint64_t*)(intraThreadBuffer + posEnd)) = posEndTmp - posEnd;
-            posEndTmp = (posEndTmp + 7) & 0xFFFFFFFFFFFFFFF8;
-            posEnd = posEndTmp;
-
             readersCond.notify_all();
         }
 
-        if (posEndTmp + 1 >= outputBufferSize) {
-            cerr << "ERROR: JSON buffer overflow (8)" << endl;
-            return this;
+        return this;
+    }
+
+    //how far the writer may write before it reaches the cursor from behind, counted from the start of the current lap,
+    //cursor equal to the end of published messages has read everything
+    uint64_t CommandBuffer::cursorLimit(OutputCursor *cursor, uint64_t end) {
+        uint64_t pos = cursor->pos.load(memory_order_acquire);
+        if (pos > end)
+            return pos;
+        return pos + outputBufferSize;
+    }
+
+    //lowest limit of the cursors, private buffer without consumers is not circular
+    uint64_t CommandBuffer::cursorsLimit(void) {
+        if (cursors.size() == 0)
+            return outputBufferSize;
+
+        uint64_t end = posEnd.load(memory_order_relaxed);
+        uint64_t limit = end + outputBufferSize;
+        for (auto cursor : cursors) {
+            if (cursor->state.load(memory_order_acquire) == CURSOR_DROPPED)
+                continue;
+            uint64_t cursorEnd = cursorLimit(cursor, end);
+            if (cursorEnd < limit)
+                limit = cursorEnd;
         }
+        return limit;
+    }
 
-        return this;
+    //cursor with the drop policy which holds back the writer is dropped, unless it is reading a message
+    bool CommandBuffer::dropCursor(uint64_t cursorNo) {
+        OutputCursor *cursor = cursors[cursorNo];
+        if (cursor->lagPolicy != LAG_POLICY_DROP)
+            return false;
+
+        uint64_t state = CURSOR_IDLE;
+        if (!cursor->state.compare_exchange_strong(state, CURSOR_DROPPED, memory_order_seq_cst))
+            return state == CURSOR_DROPPED;
+
+        ++cursor->drops;
+        cerr << "WARNING: output consumer " << dec << cursorNo << " lags behind, messages are skipped (" << cursor->drops << ")" << endl;
+        return true;
     }
 
-    CommandBuffer* CommandBuffer::rewind() {
-        if (this->shutdown)
-            return this;
+    //producer side: the writer must not overtake the slowest cursor by a whole buffer,
+    //7 bytes are kept for alignment on commit so that a full buffer never looks empty
+    bool CommandBuffer::reserve(uint64_t length) {
+        if (posEndTmp + length + 7 < posLimit)
+            return true;
 
-        {
-            unique_lock<mutex> lck(mtx);
-            while (posSize > 0 || posStart == 0) {
-                cerr << "WARNING, JSON buffer full, log reader suspended (5)" << endl;
-                writerCond.wait(lck);
-                if (this->shutdown)
-                    return this;
+        posLimit = cursorsLimit();
+        if (posEndTmp + length + 7 < posLimit)
+            return true;
+
+        //no consumer could ever make the space free
+        if (cursors.size() == 0 || posEndTmp + length + 7 >= posEnd + outputBufferSize) {
+            cerr << "ERROR: JSON buffer overflow (message size: " << dec << (posEndTmp + length - posEnd) << ")" << endl;
+            return false;
+        }
+
+        unique_lock<mutex> lck(mtx);
+        writerWaiting.store(true, memory_order_seq_cst);
+        while (true) {
+            posLimit = cursorsLimit();
+            if (posEndTmp + length + 7 < posLimit)
+                break;
+
+            uint64_t end = posEnd.load(memory_order_relaxed);
+            bool dropped = false;
+            for (uint64_t i = 0; i < cursors.size(); ++i) {
+                OutputCursor *cursor = cursors[i];
+                if (cursor->state.load(memory_order_seq_cst) != CURSOR_DROPPED &&
+                        posEndTmp + length + 7 >= cursorLimit(cursor, end) && dropCursor(i))
+                    dropped = true;
+            }
+            if (dropped)
+                continue;
+
+            cerr << "WARNING, JSON buffer full, log reader suspended" << endl;
+            writerCond.wait(lck);
+            if (this->shutdown) {
+                writerWaiting.store(false, memory_order_relaxed);
+                return false;
             }
+        }
+        writerWaiting.store(false, memory_order_relaxed);
+        return true;
+    }
 
-            posSize = posEnd;
-            posEnd = 0;
-            posEndTmp = 0;
+    uint64_t CommandBuffer::addCursor(uint64_t lagPolicy) {
+        OutputCursor *cursor = new OutputCursor(lagPolicy);
+        if (cursor == nullptr) {
+            cerr << "ERROR: could not allocate " << dec << sizeof(OutputCursor) << " bytes memory for (reason: output cursor)" << endl;
+            throw MemoryException("out of memory");
         }
+        cursors.push_back(cursor);
+        return cursors.size() - 1;
+    }
 
-        return this;
+    //consumer side: length of next message, 0 when buffer is empty and the writer is stopping
+    //waitMs - 0 waits until a message is published, otherwise returns 0 after the time passes
+    uint64_t CommandBuffer::readerPeek(uint64_t cursorNo, volatile bool &stop, uint64_t waitMs) {
+        OutputCursor *cursor = cursors[cursorNo];
+
+        while (true) {
+            //dropped cursor rejoins at the end of published messages
+            if (cursor->lagPolicy == LAG_POLICY_DROP && cursor->state.load(memory_order_acquire) == CURSOR_DROPPED) {
+                unique_lock<mutex> lck(mtx);
+                cursor->pos.store(posEnd.load(memory_order_seq_cst), memory_order_seq_cst);
+                cursor->state.store(CURSOR_IDLE, memory_order_seq_cst);
+            }
+
+            uint64_t end = posEnd.load(memory_order_acquire);
+            uint64_t start = cursor->pos.load(memory_order_relaxed);
+
+            if (start != end) {
+                if (cursor->lagPolicy == LAG_POLICY_DROP) {
+                    uint64_t state = CURSOR_IDLE;
+                    if (!cursor->state.compare_exchange_strong(state, CURSOR_BUSY, memory_order_seq_cst))
+                        continue;
+                }
+                return *((uint64_t*)(intraThreadBuffer + start));
+            }
+
+            unique_lock<mutex> lck(mtx);
+            readersWaiting.fetch_add(1, memory_order_seq_cst);
+            if (posEnd.load(memory_order_seq_cst) == end) {
+                if (stop) {
+                    readersWaiting.fetch_sub(1, memory_order_relaxed);
+                    return 0;
+                }
+                if (waitMs == 0)
+                    readersCond.wait(lck);
+                else if (readersCond.wait_for(lck, chrono::milliseconds(waitMs)) == cv_status::timeout) {
+                    readersWaiting.fetch_sub(1, memory_order_relaxed);
+                    return 0;
+                }
+            }
+            readersWaiting.fetch_sub(1, memory_order_relaxed);
+        }
+    }
+
+    void CommandBuffer::readerRelease(uint64_t cursorNo, uint64_t length) {
+        OutputCursor *cursor = cursors[cursorNo];
+        uint64_t pos = cursor->pos.load(memory_order_relaxed) + ((length + 7) & 0xFFFFFFFFFFFFFFF8);
+        if (pos >= outputBufferSize)
+            pos -= outputBufferSize;
+        cursor->pos.store(pos, memory_order_seq_cst);
+        if (cursor->lagPolicy == LAG_POLICY_DROP)
+            cursor->state.store(CURSOR_IDLE, memory_order_seq_cst);
+        if (writerWaiting.load(memory_order_seq_cst)) {
+            unique_lock<mutex> lck(mtx);
+            writerCond.notify_all();
+        }
     }
 
     uint64_t CommandBuffer::currentTranSize() {
@@ -787,8 +1386,22 @@ namespace OpenLogReplicator {
 
     CommandBuffer::~CommandBuffer() {
         if (intraThreadBuffer != nullptr) {
-            delete[] intraThreadBuffer;
+            munmap(intraThreadBuffer, outputBufferSize * 2);
             intraThreadBuffer = nullptr;
         }
+
+        if (avroData != nullptr) {
+            delete[] avroData;
+            avroData = nullptr;
+        }
+
+        if (avroLength != nullptr) {
+            delete[] avroLength;
+            avroLength = nullptr;
+        }
+
+        for (auto cursor : cursors)
+            delete cursor;
+        cursors.clear();
     }
 }
@@ -19,13 +19,34 @@ along with Open Log Replicator; see the file LICENSE.txt  If not see
 
 #include <stdint.h>
 #include <string>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <vector>
 #include "types.h"
 
 #ifndef COMMANDBUFFER_H_
 #define COMMANDBUFFER_H_
 
+//worst case text length of a column value: every byte escaped, NUMBER exponent padding, sign, dot and quotes
+#define VALUE_LENGTH_MAX(fieldLength) (2 * ((uint64_t)(fieldLength)) + 136)
+
+//"YYYYBC-MM-DDTHH:MI:SS.FFFFFFFFF" with quotes
+#define DATE_TEXT_MAX 34
+
+#define AVRO_OP_CREATE 0
+#define AVRO_OP_UPDATE 1
+#define AVRO_OP_DELETE 2
+
+#define AVRO_TYPE_STRING 0
+#define AVRO_TYPE_LONG 1
+#define AVRO_TYPE_DECIMAL 2
+#define AVRO_TYPE_TIMESTAMP_MILLIS 3
+#define AVRO_TYPE_TIMESTAMP_MICROS 4
+#define AVRO_TYPE_BYTES 5
+
+#define SHARDHASHINGFUNCTION(key,n) ((((((uint64_t)(key))*0x9E3779B97F4A7C15ULL)>>32)*(n))>>32)
+
 using namespace std;
 
 namespace OpenLogReplicator {
@@ -34,49 +55,97 @@ namespace OpenLogReplicator {
     class RedoLogRecord;
     class OracleReader;
     class OracleObject;
+    class OracleColumn;
+    class OutputCursor;
 
     class CommandBuffer {
     protected:
         volatile bool shutdown;
         OracleReader *oracleReader;
+
+        void buildDbzCols(string &str, OracleObject *object);
+        void buildDbzHead(string &str, OracleObject *object);
+        bool reserve(uint64_t length);
+        uint64_t cursorLimit(OutputCursor *cursor, uint64_t end);
+        uint64_t cursorsLimit(void);
+        bool dropCursor(uint64_t cursorNo);
+        uint64_t formatDate(char *text, const uint8_t *data, uint64_t length);
+
+        void buildAvroSchema(OracleObject *object);
+        void publishAvroSchema(OracleObject *object);
+        uint8_t *writeAvroValue(uint8_t *pos, OracleColumn *column, const uint8_t *data, uint64_t length);
+
+        bool avroCapture;               //appendValue and appendNull collect the row image instead of writing JSON
+        const uint8_t **avroData;       //value of every column by segment column number, nullptr - null
+        uint64_t *avroLength;
+        uint64_t avroColumns;
+
+        uint8_t lastDate[4];            //century, year, month and day of the last formatted date
+        char lastDateText[12];
+        uint64_t lastDateLength;        //0 - no date cached
     public:
         static char translationMap[65];
         Writer *writer;
-        uint8_t *intraThreadBuffer;
+        uint8_t *intraThreadBuffer;     //outputBufferSize bytes mapped twice one after another
         mutex mtx;
         condition_variable readersCond;
         condition_variable writerCond;
-        volatile uint64_t posStart;
-        volatile uint64_t posEnd;
-        volatile uint64_t posEndTmp;
-        volatile uint64_t posSize;
+        vector<OutputCursor*> cursors;  //consumers, added before the threads start
+        atomic<uint64_t> posEnd;        //end of published messages, written only by the writer
+        volatile uint64_t posEndTmp;    //message being written may run past outputBufferSize into the second mapping
+        uint64_t posLimit;              //writer may not reach it, refreshed only when it shows no space
+        uint64_t posSpanEnd;            //end of space reserved with reserveSpan, appends below it are not checked
+        atomic<bool> writerWaiting;
+        atomic<uint64_t> readersWaiting;
         uint64_t test;
         uint64_t timestampFormat;
+        uint64_t stream;
+        string avroSchemaPath;          //directory where Avro schemas are published
         uint64_t outputBufferSize;
+        uint64_t shard;
+        uint64_t shards;            //0 - not sharded output
+        uint64_t shardBy;
 
         void stop(void);
         void setOracleReader(OracleReader *oracleReader);
+        uint64_t getShard(typeobj objn, typedba bdba, RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2);
+        uint64_t getRowShard(typeobj objn, typedba bdba, RedoLogRecord *redoLogRecord, uint64_t fieldPos);
+        static void escapeString(string &str, const uint8_t *text, uint64_t length);
+        static uint64_t escapeJson(uint8_t *out, const uint8_t *text, uint64_t length);
+        void buildFragments(OracleObject *object);
         CommandBuffer* appendRowid(typeobj objn, typeobj objd, typedba bdba, typeslot slot);
         CommandBuffer* appendEscape(const uint8_t *str, uint64_t length);
-        CommandBuffer* append(const string str);
+        CommandBuffer* append(const string &str);
         CommandBuffer* append(char chr);
+        CommandBuffer* append(const uint8_t *str, uint64_t length);
         CommandBuffer* appendHex(uint64_t val, uint64_t length);
         CommandBuffer* appendDec(uint64_t val);
         CommandBuffer* appendScn(typescn scn);
-        CommandBuffer* appendOperation(string operation);
-        CommandBuffer* appendTable(string owner, string table);
-        CommandBuffer* appendValue(string columnName, RedoLogRecord *redoLogRecord, uint64_t typeNo, uint64_t fieldPos, uint64_t fieldLength);
-        CommandBuffer* appendNull(string columnName);
-        CommandBuffer* appendMs(string name, uint64_t time);
+        CommandBuffer* appendOperation(const string &operation);
+        CommandBuffer* appendTable(OracleObject *object);
+        CommandBuffer* appendValue(OracleColumn *column, RedoLogRecord *redoLogRecord, uint64_t fieldPos, uint64_t fieldLength);
+        CommandBuffer* appendNull(OracleColumn *column);
+        CommandBuffer* appendMs(const string &name, uint64_t time);
         CommandBuffer* appendXid(typexid xid);
-        CommandBuffer* appendDbzCols(OracleObject *object);
         CommandBuffer* appendDbzHead(OracleObject *object);
         CommandBuffer* appendDbzTail(OracleObject *object, uint64_t time, typescn scn, char op, typexid xid);
+        static uint64_t avroType(OracleColumn *column);
+        static uint64_t avroFingerprint(const string &schema);
+        static uint8_t *writeAvroLong(uint8_t *pos, int64_t val);
+        static bool epochTime(const uint8_t *data, uint64_t length, bool micros, int64_t &time);
+        CommandBuffer* appendAvroHead(OracleObject *object, uint64_t op, typescn scn, typexid xid, uint64_t time);
+        CommandBuffer* beginAvroImage(OracleObject *object);
+        CommandBuffer* endAvroImage(OracleObject *object);
+        CommandBuffer* appendAvroNullImage(void);
 
-        CommandBuffer* beginTran();
+        bool reserveSpan(uint64_t length);
+        void commitSpan(void);
+        virtual CommandBuffer* beginTran();
         CommandBuffer* commitTran();
-        CommandBuffer* rewind();
         uint64_t currentTranSize();
+        uint64_t addCursor(uint64_t lagPolicy);
+        uint64_t readerPeek(uint64_t cursor, volatile bool &stop, uint64_t waitMs = 0);
+        void readerRelease(uint64_t cursor, uint64_t length);
 
         CommandBuffer(uint64_t outputBufferSize);
         virtual ~CommandBuffer();
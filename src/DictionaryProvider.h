@@ -0,0 +1,53 @@
+/* Header for DictionaryProvider class
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <string>
+#include "types.h"
+
+#ifndef DICTIONARYPROVIDER_H_
+#define DICTIONARYPROVIDER_H_
+
+using namespace std;
+
+namespace OpenLogReplicator {
+
+    class OracleObject;
+    class OracleReader;
+    struct OracleTableMask;
+
+    //source of database parameters, table definitions and redo log lists
+    class DictionaryProvider {
+    public:
+        OracleReader *oracleReader;
+        bool schemaCache;           //table definitions are worth keeping in schema cache
+
+        virtual uint64_t initialize(void) = 0;
+        virtual void readTables(OracleTableMask &tableMask) = 0;
+        virtual bool validateTables(OracleTableMask &tableMask) = 0;
+        virtual OracleObject *reloadObject(typeobj objn, uint64_t options, typescn scn) = 0;
+        virtual void archLogGetList(void) = 0;
+        virtual void onlineLogGetList(void) = 0;
+        virtual bool isOffline(void) = 0;
+
+        DictionaryProvider(bool schemaCache);
+        virtual ~DictionaryProvider();
+    };
+}
+
+#endif
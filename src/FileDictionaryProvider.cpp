@@ -0,0 +1,210 @@
+/* Dictionary read from JSON snapshot file, no database connection is needed
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <string>
+#include <iostream>
+#include <fstream>
+#include "types.h"
+#include "FileDictionaryProvider.h"
+#include "OracleColumn.h"
+#include "OracleObject.h"
+#include "OracleReader.h"
+#include "OracleReaderRedo.h"
+
+using namespace std;
+using namespace rapidjson;
+
+const Value& getJSONfield(const Value& value, const char* field);
+const Value& getJSONfield(const Document& document, const char* field);
+
+namespace OpenLogReplicator {
+
+    FileDictionaryProvider::FileDictionaryProvider(const string fileName) :
+        DictionaryProvider(false),
+        fileName(fileName),
+        archiveListed(false) {
+    }
+
+    FileDictionaryProvider::~FileDictionaryProvider() {
+    }
+
+    bool FileDictionaryProvider::parseFile(void) {
+        ifstream infile;
+        infile.open(fileName.c_str(), ios::in);
+        if (!infile.is_open())
+            {cerr << "ERROR: can't open dictionary file " << fileName << endl; return false;}
+
+        string dictionaryJSON((istreambuf_iterator<char>(infile)), istreambuf_iterator<char>());
+        infile.close();
+
+        if (dictionaryJSON.length() == 0 || document.Parse(dictionaryJSON.c_str()).HasParseError())
+            {cerr << "ERROR: parsing " << fileName << " at byte " << dec << document.GetErrorOffset() << endl; return false;}
+        return true;
+    }
+
+    uint64_t FileDictionaryProvider::initialize(void) {
+        if (!parseFile())
+            return 0;
+
+        const Value& databaseJSON = getJSONfield(document, "database");
+        if (oracleReader->database.compare(databaseJSON.GetString()) != 0)
+            {cerr << "ERROR: dictionary file " << fileName << " is for database " << databaseJSON.GetString() << endl; return 0;}
+
+        const Value& resetlogsJSON = getJSONfield(document, "resetlogs");
+        typeresetlogs currentResetlogs = resetlogsJSON.GetUint64();
+        if (oracleReader->resetlogs != 0 && currentResetlogs != oracleReader->resetlogs) {
+            cerr << "Error: Incorrect database incarnation. Previous resetlogs:" << dec << oracleReader->resetlogs << ", current: " << currentResetlogs << endl;
+            return 0;
+        }
+        oracleReader->resetlogs = currentResetlogs;
+
+        const Value& bigEndianJSON = getJSONfield(document, "big-endian");
+        if (bigEndianJSON.GetUint64() != 0)
+            oracleReader->setBigEndian();
+
+        const Value& conIdJSON = getJSONfield(document, "con-id");
+        oracleReader->conId = conIdJSON.GetUint64();
+        oracleReader->databaseContext = databaseJSON.GetString();
+
+        //position from checkpoint file has precedence
+        if (oracleReader->databaseSequence == 0 || oracleReader->databaseScn == 0) {
+            const Value& sequenceJSON = getJSONfield(document, "sequence");
+            oracleReader->databaseSequence = sequenceJSON.GetUint64();
+            const Value& scnJSON = getJSONfield(document, "scn");
+            oracleReader->databaseScn = scnJSON.GetUint64();
+        }
+
+        return 1;
+    }
+
+    //same as LIKE: % matches any string, _ matches any character
+    bool FileDictionaryProvider::isMatching(const char *name, const char *mask) {
+        while (*mask != 0) {
+            if (*mask == '%') {
+                while (*mask == '%')
+                    ++mask;
+                if (*mask == 0)
+                    return true;
+                for (; *name != 0; ++name)
+                    if (isMatching(name, mask))
+                        return true;
+                return false;
+            }
+            if (*name == 0 || (*mask != '_' && *mask != *name))
+                return false;
+            ++name;
+            ++mask;
+        }
+        return *name == 0;
+    }
+
+    OracleObject *FileDictionaryProvider::readObject(const Value& table, uint64_t options) {
+        typeobj objn = getJSONfield(table, "objn").GetUint64();
+        typeobj objd = getJSONfield(table, "objd").GetUint64();
+        uint64_t cluCols = getJSONfield(table, "clu-cols").GetUint64();
+        uint64_t depdendencies = getJSONfield(table, "dependencies").GetUint64();
+        uint64_t totalPk = 0, totalCols = 0;
+        OracleObject *object = new OracleObject(objn, objd, depdendencies, cluCols, options, getJSONfield(table, "owner").GetString(),
+                getJSONfield(table, "name").GetString());
+
+        const Value& columns = getJSONfield(table, "columns");
+        for (SizeType j = 0; j < columns.Size(); ++j) {
+            const Value& column = columns[j];
+            uint64_t numPk = getJSONfield(column, "num-pk").GetUint64();
+            object->addColumn(new OracleColumn(getJSONfield(column, "col-no").GetUint64(), getJSONfield(column, "seg-col-no").GetUint64(),
+                    getJSONfield(column, "name").GetString(), getJSONfield(column, "type-no").GetUint64(),
+                    getJSONfield(column, "length").GetUint64(), getJSONfield(column, "precision").GetInt64(),
+                    getJSONfield(column, "scale").GetInt64(), numPk, getJSONfield(column, "nullable").GetUint64() != 0));
+            totalPk += numPk;
+            ++totalCols;
+        }
+
+        object->totalCols = totalCols;
+        object->totalPk = totalPk;
+        return object;
+    }
+
+    void FileDictionaryProvider::readTables(OracleTableMask &tableMask) {
+        const Value& tables = getJSONfield(document, "tables");
+        if (!tables.IsArray())
+            {cerr << "ERROR: bad JSON, tables in " << fileName << " should be an array!" << endl; return;}
+
+        for (SizeType i = 0; i < tables.Size(); ++i) {
+            const Value& table = tables[i];
+            string owner = getJSONfield(table, "owner").GetString();
+            string objectName = getJSONfield(table, "name").GetString();
+            if (!isMatching((owner + "." + objectName).c_str(), tableMask.mask.c_str()))
+                continue;
+
+            OracleObject *object = readObject(table, tableMask.options);
+            tableMask.objects.push_back(object->objn);
+
+            cout << endl << "  * found: " << owner << "." << objectName << " (OBJD: " << dec << object->objd << ", OBJN: " << dec << object->objn <<
+                    ", DEP: " << dec << object->depdendencies << ")";
+            oracleReader->addToDict(object);
+        }
+    }
+
+    //snapshot file may have been refreshed after DDL, it has no history of table definitions
+    OracleObject *FileDictionaryProvider::reloadObject(typeobj objn, uint64_t options, typescn) {
+        if (!parseFile())
+            return nullptr;
+
+        const Value& tables = getJSONfield(document, "tables");
+        if (!tables.IsArray())
+            {cerr << "ERROR: bad JSON, tables in " << fileName << " should be an array!" << endl; return nullptr;}
+
+        for (SizeType i = 0; i < tables.Size(); ++i) {
+            const Value& table = tables[i];
+            if (getJSONfield(table, "objn").GetUint64() == objn)
+                return readObject(table, options);
+        }
+        return nullptr;
+    }
+
+    bool FileDictionaryProvider::validateTables(OracleTableMask &) {
+        return false;
+    }
+
+    //redo logs copied with the snapshot are read once
+    void FileDictionaryProvider::archLogGetList(void) {
+        if (archiveListed || !document.HasMember("archive-logs"))
+            return;
+        archiveListed = true;
+
+        const Value& archiveLogs = getJSONfield(document, "archive-logs");
+        for (SizeType i = 0; i < archiveLogs.Size(); ++i) {
+            const Value& archiveLog = archiveLogs[i];
+            typeseq sequence = getJSONfield(archiveLog, "sequence").GetUint64();
+            if (sequence < oracleReader->databaseSequence)
+                continue;
+
+            OracleReaderRedo* redo = new OracleReaderRedo(oracleReader, 0, getJSONfield(archiveLog, "path").GetString());
+            redo->sequence = sequence;
+            oracleReader->archiveRedoQueue.push(redo);
+        }
+    }
+
+    void FileDictionaryProvider::onlineLogGetList(void) {
+    }
+
+    bool FileDictionaryProvider::isOffline(void) {
+        return true;
+    }
+}
@@ -0,0 +1,59 @@
+/* Header for FileDictionaryProvider class
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <string>
+#include <rapidjson/document.h>
+#include "types.h"
+#include "DictionaryProvider.h"
+
+#ifndef FILEDICTIONARYPROVIDER_H_
+#define FILEDICTIONARYPROVIDER_H_
+
+using namespace std;
+using namespace rapidjson;
+
+namespace OpenLogReplicator {
+
+    class OracleObject;
+
+    class FileDictionaryProvider : public DictionaryProvider {
+    protected:
+        string fileName;
+        Document document;
+        bool archiveListed;
+
+        bool isMatching(const char *name, const char *mask);
+        bool parseFile(void);
+        OracleObject *readObject(const Value& table, uint64_t options);
+
+    public:
+        virtual uint64_t initialize(void);
+        virtual void readTables(OracleTableMask &tableMask);
+        virtual bool validateTables(OracleTableMask &tableMask);
+        virtual OracleObject *reloadObject(typeobj objn, uint64_t options, typescn scn);
+        virtual void archLogGetList(void);
+        virtual void onlineLogGetList(void);
+        virtual bool isOffline(void);
+
+        FileDictionaryProvider(const string fileName);
+        virtual ~FileDictionaryProvider();
+    };
+}
+
+#endif
@@ -0,0 +1,45 @@
+/* Header for FormatterBuffer class
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include "types.h"
+#include "CommandBuffer.h"
+
+#ifndef FORMATTERBUFFER_H_
+#define FORMATTERBUFFER_H_
+
+using namespace std;
+
+namespace OpenLogReplicator {
+
+    class FormatterThread;
+
+    //private output buffer of formatter thread, full buffer is published instead of waiting for the writer
+    class FormatterBuffer : public CommandBuffer {
+    protected:
+        FormatterThread *formatterThread;
+
+    public:
+        virtual CommandBuffer* beginTran();
+
+        FormatterBuffer(uint64_t outputBufferSize, FormatterThread *formatterThread);
+        virtual ~FormatterBuffer();
+    };
+}
+
+#endif
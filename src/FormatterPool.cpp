@@ -0,0 +1,235 @@
+/* Pool of threads formatting committed transactions
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <iostream>
+#include <string>
+#include <pthread.h>
+#include "FormatterPool.h"
+#include "FormatterThread.h"
+#include "MemoryException.h"
+#include "OracleReader.h"
+#include "Transaction.h"
+#include "TransactionBuffer.h"
+
+using namespace std;
+
+namespace OpenLogReplicator {
+
+    FormatterPool::FormatterPool(OracleReader *oracleReader, uint64_t threads, uint64_t bufferSize, CommandBuffer **shardBuffers) :
+        oracleReader(oracleReader),
+        threads(threads),
+        queues(shardBuffers != nullptr ? threads : 1),
+        formatters(nullptr),
+        shardBuffers(shardBuffers),
+        shardTransactions(nullptr),
+        shardRows(nullptr),
+        jobs(new Transaction*[queues * FORMATTER_QUEUE_SIZE]),
+        jobsSubmitted(new uint64_t[queues]),
+        jobsPublished(new uint64_t[queues]),
+        jobsReaped(new uint64_t[queues]),
+        jobsStarted(0),
+        shutdown(false),
+        bufferSize(bufferSize) {
+
+        if (jobs == nullptr || jobsSubmitted == nullptr || jobsPublished == nullptr || jobsReaped == nullptr) {
+            cerr << "ERROR: could not allocate memory for formatter queue (" << dec << (queues * FORMATTER_QUEUE_SIZE) << " elements)" << endl;
+            throw MemoryException("out of memory");
+        }
+        for (uint64_t i = 0; i < queues; ++i) {
+            jobsSubmitted[i] = 0;
+            jobsPublished[i] = 0;
+            jobsReaped[i] = 0;
+        }
+
+        if (shardBuffers != nullptr) {
+            shardTransactions = new Transaction*[threads];
+            shardRows = new bool[threads];
+            if (shardTransactions == nullptr || shardRows == nullptr) {
+                cerr << "ERROR: could not allocate memory for formatter lanes (" << dec << threads << " elements)" << endl;
+                throw MemoryException("out of memory");
+            }
+        }
+    }
+
+    FormatterPool::~FormatterPool() {
+        stop();
+        reap();
+
+        if (jobs != nullptr) {
+            delete[] jobs;
+            jobs = nullptr;
+        }
+        if (jobsSubmitted != nullptr) {
+            delete[] jobsSubmitted;
+            jobsSubmitted = nullptr;
+        }
+        if (jobsPublished != nullptr) {
+            delete[] jobsPublished;
+            jobsPublished = nullptr;
+        }
+        if (jobsReaped != nullptr) {
+            delete[] jobsReaped;
+            jobsReaped = nullptr;
+        }
+        if (shardTransactions != nullptr) {
+            delete[] shardTransactions;
+            shardTransactions = nullptr;
+        }
+        if (shardRows != nullptr) {
+            delete[] shardRows;
+            shardRows = nullptr;
+        }
+        if (shardBuffers != nullptr) {
+            delete[] shardBuffers;
+            shardBuffers = nullptr;
+        }
+    }
+
+    //threads are started with the first transaction, the writer is not known before
+    void FormatterPool::start(void) {
+        formatters = new FormatterThread*[threads];
+        for (uint64_t i = 0; i < threads; ++i) {
+            formatters[i] = new FormatterThread(oracleReader->alias + "-F" + to_string(i), oracleReader, this, i,
+                    shardBuffers != nullptr ? shardBuffers[i] : nullptr);
+            pthread_create(&formatters[i]->pthread, nullptr, &FormatterThread::runStatic, (void*)formatters[i]);
+        }
+    }
+
+    void FormatterPool::stop(void) {
+        if (formatters == nullptr)
+            return;
+
+        {
+            unique_lock<mutex> lck(mtx);
+            shutdown = true;
+            formattersCond.notify_all();
+        }
+
+        for (uint64_t i = 0; i < threads; ++i) {
+            pthread_join(formatters[i]->pthread, nullptr);
+            delete formatters[i];
+        }
+        delete[] formatters;
+        formatters = nullptr;
+    }
+
+    //full queue of one lane stops only the reader, other lanes keep working on their queues
+    void FormatterPool::enqueue(uint64_t queue, Transaction *transaction) {
+        while (jobsSubmitted[queue] - jobsReaped[queue] >= FORMATTER_QUEUE_SIZE) {
+            {
+                unique_lock<mutex> lck(mtx);
+                while (jobsPublished[queue] == jobsReaped[queue])
+                    readerCond.wait(lck);
+            }
+            reapQueue(queue);
+        }
+
+        unique_lock<mutex> lck(mtx);
+        jobs[queue * FORMATTER_QUEUE_SIZE + jobsSubmitted[queue] % FORMATTER_QUEUE_SIZE] = transaction;
+        ++jobsSubmitted[queue];
+        formattersCond.notify_all();
+    }
+
+    void FormatterPool::submit(Transaction *transaction) {
+        if (formatters == nullptr)
+            start();
+
+        if (shardBuffers == nullptr) {
+            enqueue(0, transaction);
+            return;
+        }
+
+        transaction->split(oracleReader, oracleReader->transactionBuffer, shardBuffers[0], shardTransactions, shardRows);
+        oracleReader->transactionBuffer->deleteTransactionChunks(transaction->firstTc, transaction->lastTc);
+        oracleReader->transactionBuffer->deleteTransaction(transaction);
+
+        for (uint64_t i = 0; i < threads; ++i)
+            if (shardTransactions[i] != nullptr)
+                enqueue(i, shardTransactions[i]);
+    }
+
+    //published transactions are freed by the reader thread, transaction buffer is not shared
+    void FormatterPool::reapQueue(uint64_t queue) {
+        uint64_t published;
+        {
+            unique_lock<mutex> lck(mtx);
+            published = jobsPublished[queue];
+        }
+
+        while (jobsReaped[queue] < published) {
+            Transaction *transaction = jobs[queue * FORMATTER_QUEUE_SIZE + jobsReaped[queue] % FORMATTER_QUEUE_SIZE];
+            oracleReader->transactionBuffer->deleteTransactionChunks(transaction->firstTc, transaction->lastTc);
+            oracleReader->transactionBuffer->deleteTransaction(transaction);
+            ++jobsReaped[queue];
+        }
+    }
+
+    void FormatterPool::reap(void) {
+        for (uint64_t i = 0; i < queues; ++i)
+            reapQueue(i);
+    }
+
+    void FormatterPool::drain(void) {
+        {
+            unique_lock<mutex> lck(mtx);
+            for (uint64_t i = 0; i < queues; ++i)
+                while (jobsPublished[i] < jobsSubmitted[i])
+                    readerCond.wait(lck);
+        }
+        reap();
+    }
+
+    Transaction* FormatterPool::getJob(uint64_t &job, uint64_t lane) {
+        unique_lock<mutex> lck(mtx);
+        if (shardBuffers != nullptr) {
+            //every lane has own queue and is the only one taking jobs from it
+            while (jobsPublished[lane] == jobsSubmitted[lane]) {
+                if (shutdown)
+                    return nullptr;
+                formattersCond.wait(lck);
+            }
+
+            job = jobsPublished[lane];
+            return jobs[lane * FORMATTER_QUEUE_SIZE + job % FORMATTER_QUEUE_SIZE];
+        }
+
+        while (jobsStarted == jobsSubmitted[0]) {
+            if (shutdown)
+                return nullptr;
+            formattersCond.wait(lck);
+        }
+
+        job = jobsStarted++;
+        return jobs[job % FORMATTER_QUEUE_SIZE];
+    }
+
+    void FormatterPool::waitForTurn(uint64_t job) {
+        unique_lock<mutex> lck(mtx);
+        while (jobsPublished[0] != job)
+            formattersCond.wait(lck);
+    }
+
+    void FormatterPool::published(uint64_t job, uint64_t lane) {
+        unique_lock<mutex> lck(mtx);
+        jobsPublished[shardBuffers != nullptr ? lane : 0] = job + 1;
+
+        formattersCond.notify_all();
+        readerCond.notify_all();
+    }
+}
@@ -0,0 +1,80 @@
+/* Header for FormatterPool class
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <mutex>
+#include <condition_variable>
+#include "types.h"
+
+#ifndef FORMATTERPOOL_H_
+#define FORMATTERPOOL_H_
+
+#define FORMATTER_QUEUE_SIZE        1024
+
+using namespace std;
+
+namespace OpenLogReplicator {
+
+    class OracleReader;
+    class Transaction;
+    class FormatterThread;
+    class CommandBuffer;
+
+    //committed transactions are formatted in parallel and published to the output buffer in commit order,
+    //sharded output: rows of a transaction are divided between the lanes once on submit, every lane has own queue
+    //and formats its own rows in commit order independently of the other lanes
+    class FormatterPool {
+    protected:
+        OracleReader *oracleReader;
+        uint64_t threads;
+        uint64_t queues;                    //sharded output - one queue per lane
+        FormatterThread **formatters;
+        CommandBuffer **shardBuffers;
+        Transaction **shardTransactions;
+        bool *shardRows;
+        Transaction **jobs;                 //queue q starts at q * FORMATTER_QUEUE_SIZE
+        uint64_t *jobsSubmitted;
+        uint64_t *jobsPublished;
+        uint64_t *jobsReaped;
+        uint64_t jobsStarted;               //not sharded output, threads take jobs from one queue
+        volatile bool shutdown;
+        mutex mtx;
+        condition_variable formattersCond;
+        condition_variable readerCond;
+
+        void start(void);
+        void enqueue(uint64_t queue, Transaction *transaction);
+        void reapQueue(uint64_t queue);
+
+    public:
+        uint64_t bufferSize;                //private buffer of every thread, not sharded output
+
+        void submit(Transaction *transaction);
+        void reap(void);
+        void drain(void);
+        void stop(void);
+        Transaction* getJob(uint64_t &job, uint64_t lane);
+        void waitForTurn(uint64_t job);
+        void published(uint64_t job, uint64_t lane);
+
+        FormatterPool(OracleReader *oracleReader, uint64_t threads, uint64_t bufferSize, CommandBuffer **shardBuffers);
+        virtual ~FormatterPool();
+    };
+}
+
+#endif
@@ -0,0 +1,102 @@
+/* Thread formatting committed transactions to private buffer
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <iostream>
+#include "CommandBuffer.h"
+#include "FormatterBuffer.h"
+#include "FormatterPool.h"
+#include "FormatterThread.h"
+#include "OracleReader.h"
+#include "Transaction.h"
+#include "Writer.h"
+
+using namespace std;
+
+namespace OpenLogReplicator {
+
+    //sharded output is formatted directly to the output buffer of the lane
+    FormatterThread::FormatterThread(const string alias, OracleReader *oracleReader, FormatterPool *formatterPool, uint64_t lane,
+            CommandBuffer *shardBuffer) :
+        Thread(alias, shardBuffer != nullptr ? shardBuffer : new FormatterBuffer(formatterPool->bufferSize, this)),
+        oracleReader(oracleReader),
+        formatterPool(formatterPool),
+        formatter(nullptr),
+        lane(lane),
+        job(0),
+        hasTurn(false) {
+
+        if (shardBuffer == nullptr) {
+            formatter = oracleReader->commandBuffer->writer->newFormatter(commandBuffer);
+            commandBuffer->setOracleReader(oracleReader);
+            commandBuffer->writer = formatter;
+            commandBuffer->test = oracleReader->commandBuffer->test;
+            commandBuffer->timestampFormat = oracleReader->commandBuffer->timestampFormat;
+            commandBuffer->stream = oracleReader->commandBuffer->stream;
+        }
+    }
+
+    FormatterThread::~FormatterThread() {
+        if (formatter != nullptr) {
+            delete formatter;
+            formatter = nullptr;
+
+            delete commandBuffer;
+            commandBuffer = nullptr;
+        }
+    }
+
+    void *FormatterThread::run() {
+        while (true) {
+            Transaction *transaction = formatterPool->getJob(job, lane);
+            if (transaction == nullptr)
+                break;
+
+            hasTurn = false;
+            transaction->flush(oracleReader, commandBuffer);
+            if (formatter != nullptr)
+                publish();
+            formatterPool->published(job, lane);
+        }
+
+        return 0;
+    }
+
+    //copy formatted messages to the output buffer, possible only after all previous transactions are published
+    void FormatterThread::publish(void) {
+        if (!hasTurn) {
+            formatterPool->waitForTurn(job);
+            hasTurn = true;
+        }
+
+        CommandBuffer *outputBuffer = oracleReader->commandBuffer;
+        uint64_t pos = 0;
+        while (pos < commandBuffer->posEnd) {
+            uint64_t length = *((uint64_t*)(commandBuffer->intraThreadBuffer + pos));
+            outputBuffer
+                    ->beginTran()
+                    ->append(commandBuffer->intraThreadBuffer + pos + 8, length - 8)
+                    ->commitTran();
+
+            pos += (length + 7) & 0xFFFFFFFFFFFFFFF8;
+        }
+
+        commandBuffer->posEnd = 0;
+        commandBuffer->posEndTmp = 0;
+    }
+}
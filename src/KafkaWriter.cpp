@@ -29,9 +29,12 @@ along with Open Log Replicator; see the file LICENSE.txt  If not see
 #include "types.h"
 #include "KafkaWriter.h"
 #include "OracleReader.h"
+#include "ColumnIterator.h"
 #include "CommandBuffer.h"
 #include "OracleColumn.h"
 #include "OracleObject.h"
+#include "OutputCursor.h"
+#include "RowFilter.h"
 #include "OracleReader.h"
 #include "RedoLogRecord.h"
 
@@ -77,53 +80,30 @@ namespace OpenLogReplicator {
     void *KafkaWriter::run() {
         cout << "- Kafka Writer for: " << brokers << " topic: " << topic << endl;
         uint64_t length = 0;
+        //messages of one shard are sent with the same key to keep them in one partition
+        string key = to_string(commandBuffer->shard);
 
         length = 0;
         while (true) {
-            if (length == 0) {
-                unique_lock<mutex> lck(commandBuffer->mtx);
-                while (commandBuffer->posStart == commandBuffer->posEnd) {
-                    if (this->shutdown)
-                        break;
-                    commandBuffer->readersCond.wait(lck);
-                }
-
-                if (commandBuffer->posStart == commandBuffer->posSize && commandBuffer->posSize > 0) {
-                    commandBuffer->posStart = 0;
-                    commandBuffer->posSize = 0;
-                }
-                if (commandBuffer->posStart == commandBuffer->posEnd)
-                    length = 0;
-                else
-                    length = *((uint64_t*)(commandBuffer->intraThreadBuffer + commandBuffer->posStart));
-            }
+            if (length == 0)
+                length = commandBuffer->readerPeek(cursor, shutdown);
             if ((trace2 & TRACE2_OUTPUT_BUFFER) != 0)
-                cerr << "Kafka writer buffer: " << dec << commandBuffer->posStart << " - " << commandBuffer->posEnd << " (" << length << ")" << endl;
+                cerr << "Kafka writer buffer: " << dec << commandBuffer->cursors[cursor]->pos << " - " << commandBuffer->posEnd << " (" << length << ")" << endl;
 
             if (length > 0) {
                 if (test >= 1) {
                     for (uint64_t i = 0; i < length - 8; ++i)
-                        cout << commandBuffer->intraThreadBuffer[commandBuffer->posStart + 8 + i];
+                        cout << commandBuffer->intraThreadBuffer[commandBuffer->cursors[cursor]->pos + 8 + i];
                     cout << endl;
                 } else {
                     if (producer->produce(
-                            ktopic, Topic::PARTITION_UA, Producer::RK_MSG_COPY, commandBuffer->intraThreadBuffer + commandBuffer->posStart + 8,
-                            length - 8, nullptr, nullptr)) {
+                            ktopic, Topic::PARTITION_UA, Producer::RK_MSG_COPY, commandBuffer->intraThreadBuffer + commandBuffer->cursors[cursor]->pos + 8,
+                            length - 8, commandBuffer->shards > 0 ? &key : nullptr, nullptr)) {
                         cerr << "ERROR: writing to topic " << endl;
                     }
                 }
 
-                {
-                    unique_lock<mutex> lck(commandBuffer->mtx);
-                    commandBuffer->posStart += (length + 7) & 0xFFFFFFFFFFFFFFF8;
-
-                    if (commandBuffer->posStart == commandBuffer->posSize && commandBuffer->posSize > 0) {
-                        commandBuffer->posStart = 0;
-                        commandBuffer->posSize = 0;
-                    }
-
-                    commandBuffer->writerCond.notify_all();
-                }
+                commandBuffer->readerRelease(cursor, length);
                 length = 0;
             } else
                 if (shutdown)
@@ -131,7 +111,7 @@ namespace OpenLogReplicator {
         }
 
         if ((trace2 & TRACE2_OUTPUT_BUFFER) != 0)
-            cerr << "Kafka writer buffer at shutdown: " << dec << commandBuffer->posStart << " - " << commandBuffer->posEnd << " (" << length << ")" << endl;
+            cerr << "Kafka writer buffer at shutdown: " << dec << commandBuffer->cursors[cursor]->pos << " - " << commandBuffer->posEnd << " (" << length << ")" << endl;
         return 0;
     }
 
@@ -174,6 +154,7 @@ namespace OpenLogReplicator {
 
         lastTime = time;
         lastScn = scn;
+        dmlNo = 0;
     }
 
     void KafkaWriter::next() {
@@ -181,6 +162,7 @@ namespace OpenLogReplicator {
             if (test <= 1)
                 commandBuffer->append(',');
         }
+        ++dmlNo;
     }
 
     void KafkaWriter::commitTran() {
@@ -191,9 +173,79 @@ namespace OpenLogReplicator {
         }
     }
 
+    //part of a not yet committed transaction, followed by commit or rollback marker
+    void KafkaWriter::beginBatch(typescn scn, typexid xid, uint64_t batch) {
+        if (stream == STREAM_JSON) {
+            commandBuffer
+                    ->beginTran()
+                    ->append('{')
+                    ->appendScn(scn)
+                    ->append(',')
+                    ->appendXid(xid)
+                    ->append(",\"batch\":")
+                    ->appendDec(batch)
+                    ->append(",\"dml\":[");
+        }
+
+        lastScn = scn;
+        dmlNo = 0;
+    }
+
+    void KafkaWriter::commitBatches(typescn scn, typetime time, typexid xid, uint64_t batches) {
+        if (stream == STREAM_JSON) {
+            commandBuffer
+                    ->beginTran()
+                    ->append('{')
+                    ->appendScn(scn)
+                    ->append(',')
+                    ->appendMs("timestamp", time.toTime() * 1000)
+                    ->append(',')
+                    ->appendXid(xid)
+                    ->append(",\"batches\":")
+                    ->appendDec(batches)
+                    ->append(",\"status\":\"commit\"}")
+                    ->commitTran();
+        }
+    }
+
+    void KafkaWriter::rollbackBatches(typescn scn, typexid xid, uint64_t batches) {
+        if (stream == STREAM_JSON) {
+            commandBuffer
+                    ->beginTran()
+                    ->append('{')
+                    ->appendScn(scn)
+                    ->append(',')
+                    ->appendXid(xid)
+                    ->append(",\"batches\":")
+                    ->appendDec(batches)
+                    ->append(",\"status\":\"rollback\"}")
+                    ->commitTran();
+        }
+    }
+
+    //dml entries first..last of a provisional batch were rolled back to a savepoint
+    void KafkaWriter::retractDml(typescn scn, typexid xid, uint64_t batch, uint64_t first, uint64_t last) {
+        if (stream == STREAM_JSON) {
+            commandBuffer
+                    ->beginTran()
+                    ->append('{')
+                    ->appendScn(scn)
+                    ->append(',')
+                    ->appendXid(xid)
+                    ->append(",\"batch\":")
+                    ->appendDec(batch)
+                    ->append(",\"dml\":[")
+                    ->appendDec(first)
+                    ->append(',')
+                    ->appendDec(last)
+                    ->append("],\"status\":\"retract\"}")
+                    ->commitTran();
+        }
+    }
+
     //0x05010B0B
     void KafkaWriter::parseInsertMultiple(RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2) {
-        uint64_t pos = 0,  fieldPos = redoLogRecord2->fieldPos, fieldPosStart;
+        uint64_t fieldPos = redoLogRecord2->fieldPos, fieldPosStart;
         bool prevValue;
         uint16_t fieldLength;
 
@@ -203,23 +255,24 @@ namespace OpenLogReplicator {
         }
         fieldPosStart = fieldPos;
 
+        bool prevRow = false;
         for (uint64_t r = 0; r < redoLogRecord2->nrow; ++r) {
-            if (r > 0) {
+            //sharded output: record is formatted by every lane owning some of the rows
+            if ((redoLogRecord1->object->filter != nullptr && !redoLogRecord1->object->filter->matchesRow(redoLogRecord2, fieldPosStart)) ||
+                    (commandBuffer->shards > 0 && commandBuffer->getRowShard(redoLogRecord1->object->objn, redoLogRecord2->bdba, redoLogRecord2,
+                    fieldPosStart) != commandBuffer->shard)) {
+                fieldPosStart += oracleReader->read16(redoLogRecord2->data + redoLogRecord2->rowLenghsDelta + r * 2);
+                continue;
+            }
+            if (prevRow) {
                 next();
-            }
+            } else
+                prevRow = true;
 
-            pos = 0;
+            commandBuffer->reserveSpan(redoLogRecord2->object->rowLengthMax +
+                    2 * oracleReader->read16(redoLogRecord2->data + redoLogRecord2->rowLenghsDelta + r * 2));
             prevValue = false;
-            fieldPos = fieldPosStart;
-            uint8_t jcc = redoLogRecord2->data[fieldPos + pos + 2];
-            pos = 3;
-
-            if ((redoLogRecord2->op & OP_ROWDEPENDENCIES) != 0) {
-                if (oracleReader->version < 0x12200)
-                    pos += 6;
-                else
-                    pos += 8;
-            }
+            ColumnIterator column(oracleReader, redoLogRecord2, fieldPosStart);
 
             if (stream == STREAM_JSON) {
                 if (test >= 2)
@@ -230,16 +283,22 @@ namespace OpenLogReplicator {
                         ->append(',')
                         ->appendOperation("insert")
                         ->append(',')
-                        ->appendTable(redoLogRecord2->object->owner, redoLogRecord2->object->objectName)
+                        ->appendTable(redoLogRecord2->object)
                         ->append(',')
                         ->appendRowid(redoLogRecord1->objn, redoLogRecord1->objd, redoLogRecord2->bdba,
                                 oracleReader->read16(redoLogRecord2->data + redoLogRecord2->slotsDelta + r * 2))
                         ->append(",\"after\":{");
             }
 
-            for (uint64_t i = 0; i < redoLogRecord2->object->columns.size(); ++i) {
-                bool isNull = false;
+            if (stream == STREAM_AVRO) {
+                commandBuffer
+                        ->beginTran()
+                        ->appendAvroHead(redoLogRecord2->object, AVRO_OP_CREATE, lastScn, redoLogRecord1->xid, lastTime.toTime() * 1000)
+                        ->appendAvroNullImage()
+                        ->beginAvroImage(redoLogRecord2->object);
+            }
 
+            for (uint64_t i = 0; i < redoLogRecord2->object->columns.size(); ++i) {
                 if (stream == STREAM_DBZ_JSON) {
                     commandBuffer
                             ->beginTran()
@@ -247,39 +306,25 @@ namespace OpenLogReplicator {
                             ->append("\"before\":null,\"after\":{");
                 }
 
-                if (i >= jcc)
-                    isNull = true;
-                else {
-                    fieldLength = redoLogRecord2->data[fieldPos + pos];
-                    ++pos;
-                    if (fieldLength == 0xFF) {
-                        isNull = true;
-                    } else
-                    if (fieldLength == 0xFE) {
-                        fieldLength = oracleReader->read16(redoLogRecord2->data + fieldPos + pos);
-                        pos += 2;
-                    }
-                }
-
-                if (isNull) {
-                    if (nullColumns >= 1) {
+                if (!column.next() || column.isNull) {
+                    if (nullColumns >= 1 && COLUMNPROJECTED(redoLogRecord2->object, i)) {
                         if (prevValue)
                             commandBuffer->append(',');
                         else
                             prevValue = true;
 
-                        commandBuffer->appendNull(redoLogRecord2->object->columns[i]->columnName);
+                        commandBuffer->appendNull(redoLogRecord2->object->columns[i]);
                     }
                 } else {
-                    if (prevValue)
-                        commandBuffer->append(',');
-                    else
-                        prevValue = true;
-
-                    commandBuffer->appendValue(redoLogRecord2->object->columns[i]->columnName,
-                            redoLogRecord2, redoLogRecord2->object->columns[i]->typeNo, fieldPos + pos, fieldLength);
+                    if (COLUMNPROJECTED(redoLogRecord2->object, i)) {
+                        if (prevValue)
+                            commandBuffer->append(',');
+                        else
+                            prevValue = true;
 
-                    pos += fieldLength;
+                        commandBuffer->appendValue(redoLogRecord2->object->columns[i],
+                                redoLogRecord2, column.fieldPos, column.length);
+                    }
                 }
 
                 if (stream == STREAM_DBZ_JSON) {
@@ -295,13 +340,20 @@ namespace OpenLogReplicator {
                 commandBuffer->append("}}");
             }
 
+            if (stream == STREAM_AVRO) {
+                commandBuffer
+                        ->endAvroImage(redoLogRecord2->object)
+                        ->commitTran();
+            }
+
             fieldPosStart += oracleReader->read16(redoLogRecord2->data + redoLogRecord2->rowLenghsDelta + r * 2);
+            commandBuffer->commitSpan();
         }
     }
 
     //0x05010B0C
     void KafkaWriter::parseDeleteMultiple(RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2) {
-        uint64_t pos = 0, fieldPos = redoLogRecord1->fieldPos, fieldPosStart;
+        uint64_t fieldPos = redoLogRecord1->fieldPos, fieldPosStart;
         bool prevValue;
         uint16_t fieldLength;
 
@@ -311,23 +363,23 @@ namespace OpenLogReplicator {
         }
         fieldPosStart = fieldPos;
 
+        bool prevRow = false;
         for (uint64_t r = 0; r < redoLogRecord1->nrow; ++r) {
-            if (r > 0) {
-                next();
+            if ((redoLogRecord1->object->filter != nullptr && !redoLogRecord1->object->filter->matchesRow(redoLogRecord1, fieldPosStart)) ||
+                    (commandBuffer->shards > 0 && commandBuffer->getRowShard(redoLogRecord1->object->objn, redoLogRecord2->bdba, redoLogRecord1,
+                    fieldPosStart) != commandBuffer->shard)) {
+                fieldPosStart += oracleReader->read16(redoLogRecord1->data + redoLogRecord1->rowLenghsDelta + r * 2);
+                continue;
             }
+            if (prevRow) {
+                next();
+            } else
+                prevRow = true;
 
-            pos = 0;
+            commandBuffer->reserveSpan(redoLogRecord1->object->rowLengthMax +
+                    2 * oracleReader->read16(redoLogRecord1->data + redoLogRecord1->rowLenghsDelta + r * 2));
             prevValue = false;
-            fieldPos = fieldPosStart;
-            uint8_t jcc = redoLogRecord1->data[fieldPos + pos + 2];
-            pos = 3;
-
-            if ((redoLogRecord1->op & OP_ROWDEPENDENCIES) != 0) {
-                if (oracleReader->version < 0x12200)
-                    pos += 6;
-                else
-                    pos += 8;
-            }
+            ColumnIterator column(oracleReader, redoLogRecord1, fieldPosStart);
 
             if (stream == STREAM_JSON) {
                 if (test >= 2)
@@ -338,16 +390,21 @@ namespace OpenLogReplicator {
                         ->append(',')
                         ->appendOperation("delete")
                         ->append(',')
-                        ->appendTable(redoLogRecord1->object->owner, redoLogRecord1->object->objectName)
+                        ->appendTable(redoLogRecord1->object)
                         ->append(',')
                         ->appendRowid(redoLogRecord1->objn, redoLogRecord1->objd, redoLogRecord2->bdba,
                                 oracleReader->read16(redoLogRecord1->data + redoLogRecord1->slotsDelta + r * 2))
                         ->append(",\"before\":{");
             }
 
-            for (uint64_t i = 0; i < redoLogRecord1->object->columns.size(); ++i) {
-                bool isNull = false;
+            if (stream == STREAM_AVRO) {
+                commandBuffer
+                        ->beginTran()
+                        ->appendAvroHead(redoLogRecord1->object, AVRO_OP_DELETE, lastScn, redoLogRecord1->xid, lastTime.toTime() * 1000)
+                        ->beginAvroImage(redoLogRecord1->object);
+            }
 
+            for (uint64_t i = 0; i < redoLogRecord1->object->columns.size(); ++i) {
                 if (stream == STREAM_DBZ_JSON) {
                     commandBuffer
                             ->beginTran()
@@ -355,39 +412,25 @@ namespace OpenLogReplicator {
                             ->append("\"before\":{");
                 }
 
-                if (i >= jcc)
-                    isNull = true;
-                else {
-                    fieldLength = redoLogRecord1->data[fieldPos + pos];
-                    ++pos;
-                    if (fieldLength == 0xFF) {
-                        isNull = true;
-                    } else
-                    if (fieldLength == 0xFE) {
-                        fieldLength = oracleReader->read16(redoLogRecord1->data + fieldPos + pos);
-                        pos += 2;
-                    }
-                }
-
-                if (isNull) {
-                    if (nullColumns >= 1) {
+                if (!column.next() || column.isNull) {
+                    if (nullColumns >= 1 && COLUMNPROJECTED(redoLogRecord1->object, i)) {
                         if (prevValue)
                             commandBuffer->append(',');
                         else
                             prevValue = true;
 
-                        commandBuffer->appendNull(redoLogRecord1->object->columns[i]->columnName);
+                        commandBuffer->appendNull(redoLogRecord1->object->columns[i]);
                     }
                 } else {
-                    if (prevValue)
-                        commandBuffer->append(',');
-                    else
-                        prevValue = true;
-
-                    commandBuffer->appendValue(redoLogRecord1->object->columns[i]->columnName,
-                            redoLogRecord1, redoLogRecord1->object->columns[i]->typeNo, fieldPos + pos, fieldLength);
+                    if (COLUMNPROJECTED(redoLogRecord1->object, i)) {
+                        if (prevValue)
+                            commandBuffer->append(',');
+                        else
+                            prevValue = true;
 
-                    pos += fieldLength;
+                        commandBuffer->appendValue(redoLogRecord1->object->columns[i],
+                                redoLogRecord1, column.fieldPos, column.length);
+                    }
                 }
 
                 if (stream == STREAM_DBZ_JSON) {
@@ -402,7 +445,15 @@ namespace OpenLogReplicator {
                 commandBuffer->append("}}");
             }
 
+            if (stream == STREAM_AVRO) {
+                commandBuffer
+                        ->endAvroImage(redoLogRecord1->object)
+                        ->appendAvroNullImage()
+                        ->commitTran();
+            }
+
             fieldPosStart += oracleReader->read16(redoLogRecord1->data + redoLogRecord1->rowLenghsDelta + r * 2);
+            commandBuffer->commitSpan();
         }
     }
 
@@ -410,6 +461,14 @@ namespace OpenLogReplicator {
         typedba bdba;
         typeslot slot;
         RedoLogRecord *redoLogRecord;
+        uint64_t dataLength = 0;
+
+        //whole row is checked for space once
+        for (redoLogRecord = redoLogRecord1; redoLogRecord != nullptr; redoLogRecord = redoLogRecord->next)
+            dataLength += redoLogRecord->length;
+        for (redoLogRecord = redoLogRecord2; redoLogRecord != nullptr; redoLogRecord = redoLogRecord->next)
+            dataLength += redoLogRecord->length;
+        commandBuffer->reserveSpan(redoLogRecord2->object->rowLengthMax + 2 * dataLength);
 
         if (stream == STREAM_JSON) {
             if (test >= 2)
@@ -471,7 +530,7 @@ namespace OpenLogReplicator {
         if (stream == STREAM_JSON) {
             commandBuffer
                     ->append(',')
-                    ->appendTable(redoLogRecord2->object->owner, redoLogRecord2->object->objectName)
+                    ->appendTable(redoLogRecord2->object)
                     ->append(',')
                     ->appendRowid(redoLogRecord1->objn, redoLogRecord1->objd, bdba, slot);
         }
@@ -483,9 +542,16 @@ namespace OpenLogReplicator {
                     ->append("\"before\":");
         }
 
-        uint64_t fieldPos, colNum, colShift, cc, headerSize;
-        uint16_t fieldLength;
-        uint8_t *nulls, bits, *colNums;
+        if (stream == STREAM_AVRO) {
+            uint64_t op = AVRO_OP_UPDATE;
+            if (type == TRANSACTION_INSERT) op = AVRO_OP_CREATE;
+            else if (type == TRANSACTION_DELETE) op = AVRO_OP_DELETE;
+
+            commandBuffer
+                    ->beginTran()
+                    ->appendAvroHead(redoLogRecord2->object, op, lastScn, redoLogRecord1->xid, lastTime.toTime() * 1000);
+        }
+
         bool prevValue = false;
         uint64_t *afterPos = nullptr, *beforePos = nullptr;
         uint16_t *afterLen = nullptr, *beforeLen = nullptr;
@@ -516,155 +582,50 @@ namespace OpenLogReplicator {
                     commandBuffer->append('{');
             }
 
-            redoLogRecord = redoLogRecord1;
-            prevValue = false;
-            colNums = nullptr;
-
-            while (redoLogRecord != nullptr) {
-                if (redoLogRecord->opCode == 0x0501) {
-                    fieldPos = redoLogRecord->fieldPos;
-                    nulls = redoLogRecord->data + redoLogRecord->nullsDelta;
-                    bits = 1;
-                    cc = redoLogRecord->cc;
-                    if (redoLogRecord->colNumsDelta > 0) {
-                        colNums = redoLogRecord->data + redoLogRecord->colNumsDelta;
-                        headerSize = 5;
-                        colShift = redoLogRecord->suppLogBefore - 1 - oracleReader->read16(colNums);
-                    } else {
-                        colNums = nullptr;
-                        headerSize = 4;
-                        colShift = redoLogRecord->suppLogBefore - 1;
-                    }
-
-                    for (uint64_t i = 1; i <= headerSize; ++i) {
-                        fieldLength = oracleReader->read16(redoLogRecord->data + redoLogRecord->fieldLengthsDelta + i * 2);
-                        fieldPos += (fieldLength + 3) & 0xFFFC;
-                    }
-
-                    for (uint64_t i = 0; i < cc; ++i) {
-                        if (i + headerSize + 1 > redoLogRecord->fieldCnt) {
-                            cerr << "ERROR: reached out of columns" << endl;
-                            break;
-                        }
-                        if (colNums != nullptr) {
-                            colNum = oracleReader->read16(colNums) + colShift;
-                            colNums += 2;
-                        } else
-                            colNum = i + colShift;
-
-                        if (colNum > redoLogRecord->object->columns.size()) {
-                            cerr << "ERROR: too big column id: " << dec << colNum << endl;
-                            break;
-                        }
+            if (stream == STREAM_AVRO) {
+                if (type != TRANSACTION_UPDATE || sortColumns == 0)
+                    commandBuffer->beginAvroImage(redoLogRecord1->object);
+            }
 
-                        fieldLength = oracleReader->read16(redoLogRecord->data + redoLogRecord->fieldLengthsDelta + (i + headerSize + 1) * 2);
-                        if (((*nulls & bits) != 0 || fieldLength == 0) && type == TRANSACTION_DELETE) {
-                            //null
-                        } else {
-                            if (type == TRANSACTION_UPDATE && sortColumns > 0) {
-                                if (fieldLength != 0) {
-                                    beforePos[colNum] = fieldPos;
-                                    beforeLen[colNum] = fieldLength;
-                                    beforeRecord[colNum] = redoLogRecord;
-                                }
-                            } else {
-                                if ((*nulls & bits) == 0 && fieldLength > 0) {
-                                    if (prevValue) {
-                                        commandBuffer->append(',');
-                                    } else
-                                        prevValue = true;
-
-                                    commandBuffer->appendValue(redoLogRecord->object->columns[colNum]->columnName,
-                                            redoLogRecord, redoLogRecord->object->columns[colNum]->typeNo, fieldPos, fieldLength);
-                                } else {
-                                    if (nullColumns >= 1) {
-                                        if (prevValue)
-                                            commandBuffer->append(',');
-                                        else
-                                            prevValue = true;
-
-                                        commandBuffer->appendNull(redoLogRecord->object->columns[colNum]->columnName);
-                                    }
-                                }
-                            }
-                        }
+            ColumnIterator column(oracleReader, redoLogRecord1);
+            prevValue = false;
 
-                        bits <<= 1;
-                        if (bits == 0) {
-                            bits = 1;
-                            ++nulls;
-                        }
-                        fieldPos += (fieldLength + 3) & 0xFFFC;
+            while (column.next()) {
+                if (type == TRANSACTION_UPDATE && sortColumns > 0) {
+                    if (column.supplemental) {
+                        colSupp[column.colNum] = 1;
+                        beforePos[column.colNum] = column.fieldPos;
+                        afterPos[column.colNum] = column.fieldPos;
+                        beforeRecord[column.colNum] = column.redoLogRecord;
+                        afterRecord[column.colNum] = column.redoLogRecord;
+                        beforeLen[column.colNum] = column.length;
+                        afterLen[column.colNum] = column.length;
+                    } else if (!column.isNull) {
+                        beforePos[column.colNum] = column.fieldPos;
+                        beforeLen[column.colNum] = column.length;
+                        beforeRecord[column.colNum] = column.redoLogRecord;
                     }
+                } else if (column.isNull) {
+                    if ((type != TRANSACTION_DELETE || column.supplemental) && nullColumns >= 1 &&
+                            COLUMNPROJECTED(redoLogRecord1->object, column.colNum)) {
+                        if (prevValue)
+                            commandBuffer->append(',');
+                        else
+                            prevValue = true;
 
-                    if ((redoLogRecord->op & OP_ROWDEPENDENCIES) != 0) {
-                        fieldLength = oracleReader->read16(redoLogRecord->data + redoLogRecord->fieldLengthsDelta + (redoLogRecord->cc + headerSize + 1) * 2);
-                        fieldPos += (fieldLength + 3) & 0xFFFC;
-                        ++headerSize;
+                        commandBuffer->appendNull(redoLogRecord1->object->columns[column.colNum]);
                     }
+                } else {
+                    if (COLUMNPROJECTED(redoLogRecord1->object, column.colNum)) {
+                        if (prevValue)
+                            commandBuffer->append(',');
+                        else
+                            prevValue = true;
 
-                    //supplemental columns
-                    if (cc + headerSize + 1 <= redoLogRecord->fieldCnt) {
-                        fieldLength = oracleReader->read16(redoLogRecord->data + redoLogRecord->fieldLengthsDelta + (redoLogRecord->cc + headerSize + 1) * 2);
-                        fieldPos += (fieldLength + 3) & 0xFFFC;
-
-                        if (redoLogRecord->suppLogCC > 0 && redoLogRecord->cc + headerSize + 4 <= redoLogRecord->fieldCnt) {
-                            fieldLength = oracleReader->read16(redoLogRecord->data + redoLogRecord->fieldLengthsDelta + (redoLogRecord->cc + headerSize + 2) * 2);
-                            colNums = redoLogRecord->data + fieldPos;
-                            fieldPos += (fieldLength + 3) & 0xFFFC;
-
-                            fieldLength = oracleReader->read16(redoLogRecord->data + redoLogRecord->fieldLengthsDelta + (redoLogRecord->cc + headerSize + 3) * 2);
-                            uint8_t* colSizes = redoLogRecord->data + fieldPos;
-                            fieldPos += (fieldLength + 3) & 0xFFFC;
-
-                            for (uint64_t i = 0; i < redoLogRecord->suppLogCC; ++i) {
-                                fieldLength = oracleReader->read16(redoLogRecord->data + redoLogRecord->fieldLengthsDelta + (redoLogRecord->cc + headerSize + 4 + i) * 2);
-                                colNum = oracleReader->read16(colNums) + colShift - 1;
-                                colNums += 2;
-                                uint16_t colLength = oracleReader->read16(colSizes);
-
-                                if (type == TRANSACTION_UPDATE && sortColumns > 0) {
-                                    colSupp[colNum] = 1;
-                                    beforePos[colNum] = fieldPos;
-                                    afterPos[colNum] = fieldPos;
-                                    beforeRecord[colNum] = redoLogRecord;
-                                    afterRecord[colNum] = redoLogRecord;
-                                    if (colLength != 0xFFFF) {
-                                        beforeLen[colNum] = colLength;
-                                        afterLen[colNum] = colLength;
-                                    } else {
-                                        beforeLen[colNum] = 0;
-                                        afterLen[colNum] = 0;
-                                    }
-                                } else {
-                                    if (colLength == 0xFFFF) {
-                                        if (nullColumns >= 1) {
-                                            if (prevValue)
-                                                commandBuffer->append(',');
-                                            else
-                                                prevValue = true;
-
-                                            commandBuffer->appendNull(redoLogRecord->object->columns[colNum]->columnName);
-                                        }
-                                    } else {
-                                        if (prevValue) {
-                                            commandBuffer->append(',');
-                                        } else
-                                            prevValue = true;
-
-                                        commandBuffer->appendValue(redoLogRecord->object->columns[colNum]->columnName,
-                                                redoLogRecord, redoLogRecord->object->columns[colNum]->typeNo, fieldPos, colLength);
-                                    }
-                                }
-
-                                colSizes += 2;
-                                fieldPos += (fieldLength + 3) & 0xFFFC;
-                            }
-                        }
+                        commandBuffer->appendValue(redoLogRecord1->object->columns[column.colNum],
+                                column.redoLogRecord, column.fieldPos, column.length);
                     }
                 }
-
-                redoLogRecord = redoLogRecord->next;
             }
 
             if (stream == STREAM_JSON) {
@@ -676,11 +637,19 @@ namespace OpenLogReplicator {
                 if (type != TRANSACTION_UPDATE || sortColumns == 0)
                     commandBuffer->append('}');
             }
+
+            if (stream == STREAM_AVRO) {
+                if (type != TRANSACTION_UPDATE || sortColumns == 0)
+                    commandBuffer->endAvroImage(redoLogRecord1->object);
+            }
         } else {
             if (stream == STREAM_DBZ_JSON) {
                 if (type != TRANSACTION_UPDATE || sortColumns == 0)
                     commandBuffer->append("null");
             }
+
+            if (stream == STREAM_AVRO)
+                commandBuffer->appendAvroNullImage();
         }
 
         if (stream == STREAM_DBZ_JSON) {
@@ -700,132 +669,41 @@ namespace OpenLogReplicator {
                     commandBuffer->append('{');
             }
 
-            redoLogRecord = redoLogRecord2;
-            prevValue = false;
-
-            while (redoLogRecord != nullptr) {
-                if (redoLogRecord->opCode == 0x0B02) {
-                    fieldPos = redoLogRecord->fieldPos;
-                    nulls = redoLogRecord->data + redoLogRecord->nullsDelta;
-                    bits = 1;
-                    cc = redoLogRecord->cc;
-                    colNum = redoLogRecord->suppLogAfter - 1;
-
-                    for (uint64_t i = 1; i <= 2; ++i) {
-                        fieldLength = oracleReader->read16(redoLogRecord->data + redoLogRecord->fieldLengthsDelta + i * 2);
-                        fieldPos += (fieldLength + 3) & 0xFFFC;
-                    }
-
-                    for (uint64_t i = 0; i < cc; ++i) {
-                        if (i + 3 > redoLogRecord->fieldCnt) {
-                            cerr << "ERROR: reached out of columns" << endl;
-                            break;
-                        }
-                        if (colNum > redoLogRecord->object->columns.size()) {
-                            cerr << "ERROR: too big column id: " << dec << colNum << endl;
-                            break;
-                        }
-
-                        fieldLength = oracleReader->read16(redoLogRecord->data + redoLogRecord->fieldLengthsDelta + (i + 3) * 2);
-                        if ((*nulls & bits) != 0 || fieldLength == 0) {
-                            if (nullColumns >= 1) {
-                                if (prevValue)
-                                    commandBuffer->append(',');
-                                else
-                                    prevValue = true;
-
-                                commandBuffer->appendNull(redoLogRecord->object->columns[colNum]->columnName);
-                            }
-                        } else {
-                            if (type == TRANSACTION_UPDATE && sortColumns > 0) {
-                                afterPos[colNum] = fieldPos;
-                                afterLen[colNum] = fieldLength;
-                                afterRecord[colNum] = redoLogRecord;
-                            } else {
-                                if (prevValue)
-                                    commandBuffer->append(',');
-                                else
-                                    prevValue = true;
-
-                                commandBuffer->appendValue(redoLogRecord->object->columns[colNum]->columnName,
-                                        redoLogRecord, redoLogRecord->object->columns[colNum]->typeNo, fieldPos, fieldLength);
-                            }
-                        }
+            if (stream == STREAM_AVRO) {
+                if (type != TRANSACTION_UPDATE || sortColumns == 0)
+                    commandBuffer->beginAvroImage(redoLogRecord2->object);
+            }
 
-                        bits <<= 1;
-                        if (bits == 0) {
-                            bits = 1;
-                            ++nulls;
-                        }
-                        fieldPos += (fieldLength + 3) & 0xFFFC;
-                        ++colNum;
-                    }
+            ColumnIterator column(oracleReader, redoLogRecord2);
+            prevValue = false;
 
-                } else if (redoLogRecord->opCode == 0x0B05 || redoLogRecord->opCode == 0x0B06) {
-                    fieldPos = redoLogRecord->fieldPos;
-                    nulls = redoLogRecord->data + redoLogRecord->nullsDelta;
-                    if (redoLogRecord->colNumsDelta > 0) {
-                        colNums = redoLogRecord->data + redoLogRecord->colNumsDelta;
-                        colShift = redoLogRecord->suppLogAfter - 1 - oracleReader->read16(colNums);
-                        headerSize = 3;
-                    } else {
-                        colNums = nullptr;
-                        colShift = redoLogRecord->suppLogAfter - 1;
-                        headerSize = 2;
+            while (column.next()) {
+                if (type == TRANSACTION_UPDATE && sortColumns > 0) {
+                    if (!column.isNull) {
+                        afterPos[column.colNum] = column.fieldPos;
+                        afterLen[column.colNum] = column.length;
+                        afterRecord[column.colNum] = column.redoLogRecord;
                     }
-                    bits = 1;
+                } else if (column.isNull) {
+                    if (nullColumns >= 1 && COLUMNPROJECTED(redoLogRecord2->object, column.colNum)) {
+                        if (prevValue)
+                            commandBuffer->append(',');
+                        else
+                            prevValue = true;
 
-                    for (uint64_t i = 1; i <= headerSize; ++i) {
-                        fieldLength = oracleReader->read16(redoLogRecord->data + redoLogRecord->fieldLengthsDelta + i * 2);
-                        fieldPos += (fieldLength + 3) & 0xFFFC;
+                        commandBuffer->appendNull(redoLogRecord2->object->columns[column.colNum]);
                     }
+                } else {
+                    if (COLUMNPROJECTED(redoLogRecord2->object, column.colNum)) {
+                        if (prevValue)
+                            commandBuffer->append(',');
+                        else
+                            prevValue = true;
 
-                    for (uint64_t i = 0; i < redoLogRecord->cc && i + headerSize + 1 <= redoLogRecord->fieldCnt; ++i) {
-                        fieldLength = oracleReader->read16(redoLogRecord->data + redoLogRecord->fieldLengthsDelta + (i + headerSize + 1) * 2);
-                        if (colNums != nullptr) {
-                            colNum = oracleReader->read16(colNums) + colShift;
-                            colNums += 2;
-                        } else
-                            colNum = i + colShift;
-
-                        if (type == TRANSACTION_UPDATE && sortColumns > 0) {
-                            if (fieldLength != 0) {
-                                afterPos[colNum] = fieldPos;
-                                afterLen[colNum] = fieldLength;
-                                afterRecord[colNum] = redoLogRecord;
-                            }
-                        } else {
-                            if ((*nulls & bits) != 0 || fieldLength == 0) {
-                                if (nullColumns >= 1) {
-                                    if (prevValue)
-                                        commandBuffer->append(',');
-                                    else
-                                        prevValue = true;
-
-                                    commandBuffer->appendNull(redoLogRecord->object->columns[colNum]->columnName);
-                                }
-                            } else {
-                                if (prevValue)
-                                    commandBuffer->append(',');
-                                else
-                                    prevValue = true;
-
-                                commandBuffer->appendValue(redoLogRecord->object->columns[colNum]->columnName,
-                                        redoLogRecord, redoLogRecord->object->columns[colNum]->typeNo, fieldPos, fieldLength);
-                            }
-                        }
-
-                        bits <<= 1;
-                        if (bits == 0) {
-                            bits = 1;
-                            ++nulls;
-                        }
-                        fieldPos += (fieldLength + 3) & 0xFFFC;
+                        commandBuffer->appendValue(redoLogRecord2->object->columns[column.colNum],
+                                column.redoLogRecord, column.fieldPos, column.length);
                     }
-
                 }
-
-                redoLogRecord = redoLogRecord->next;
             }
 
             if (stream == STREAM_JSON) {
@@ -838,6 +716,10 @@ namespace OpenLogReplicator {
                     commandBuffer->append('}');
             }
 
+            if (stream == STREAM_AVRO) {
+                if (type != TRANSACTION_UPDATE || sortColumns == 0)
+                    commandBuffer->endAvroImage(redoLogRecord2->object);
+            }
 
             if (type == TRANSACTION_UPDATE && sortColumns > 0) {
                 if (sortColumns >= 2) {
@@ -863,8 +745,12 @@ namespace OpenLogReplicator {
                     commandBuffer->append("{");
                 }
 
+                if (stream == STREAM_AVRO) {
+                    commandBuffer->beginAvroImage(redoLogRecord1->object);
+                }
+
                 for (uint64_t i = 0; i < redoLogRecord1->object->totalCols; ++i) {
-                    if (beforePos[i] > 0 || afterPos[i] > 0) {
+                    if ((beforePos[i] > 0 || afterPos[i] > 0) && COLUMNPROJECTED(redoLogRecord1->object, i)) {
                         if (beforePos[i] == 0 || beforeLen[i] == 0) {
                             if (nullColumns >= 1 || colSupp[i] > 0 || afterPos[i] > 0) {
                                 if (prevValue)
@@ -872,7 +758,7 @@ namespace OpenLogReplicator {
                                 else
                                     prevValue = true;
 
-                                commandBuffer->appendNull(redoLogRecord1->object->columns[i]->columnName);
+                                commandBuffer->appendNull(redoLogRecord1->object->columns[i]);
                             }
                         } else {
                             if (prevValue)
@@ -880,8 +766,8 @@ namespace OpenLogReplicator {
                             else
                                 prevValue = true;
 
-                            commandBuffer->appendValue(redoLogRecord1->object->columns[i]->columnName,
-                                    beforeRecord[i], redoLogRecord1->object->columns[i]->typeNo, beforePos[i], beforeLen[i]);
+                            commandBuffer->appendValue(redoLogRecord1->object->columns[i],
+                                    beforeRecord[i], beforePos[i], beforeLen[i]);
                         }
                     }
                 }
@@ -894,10 +780,16 @@ namespace OpenLogReplicator {
                     commandBuffer->append("},\"after\":{");
                 }
 
+                if (stream == STREAM_AVRO) {
+                    commandBuffer
+                            ->endAvroImage(redoLogRecord1->object)
+                            ->beginAvroImage(redoLogRecord1->object);
+                }
+
                 prevValue = false;
 
                 for (uint64_t i = 0; i < redoLogRecord1->object->totalCols; ++i) {
-                    if (afterPos[i] > 0 || beforePos[i] > 0) {
+                    if ((afterPos[i] > 0 || beforePos[i] > 0) && COLUMNPROJECTED(redoLogRecord1->object, i)) {
                         if (afterPos[i] == 0 && (redoLogRecord1->object->columns[i]->numPk > 0 || colSupp[i] > 0)) {
                             if (beforePos[i] == 0 || beforeLen[i] == 0) {
                                 if (prevValue)
@@ -905,15 +797,15 @@ namespace OpenLogReplicator {
                                 else
                                     prevValue = true;
 
-                                commandBuffer->appendNull(redoLogRecord1->object->columns[i]->columnName);
+                                commandBuffer->appendNull(redoLogRecord1->object->columns[i]);
                             } else {
                                 if (prevValue)
                                     commandBuffer->append(',');
                                 else
                                     prevValue = true;
 
-                                commandBuffer->appendValue(redoLogRecord1->object->columns[i]->columnName,
-                                        beforeRecord[i], redoLogRecord1->object->columns[i]->typeNo, beforePos[i], beforeLen[i]);
+                                commandBuffer->appendValue(redoLogRecord1->object->columns[i],
+                                        beforeRecord[i], beforePos[i], beforeLen[i]);
                             }
                         } else {
                             if (afterPos[i] == 0 || afterLen[i] == 0) {
@@ -922,15 +814,15 @@ namespace OpenLogReplicator {
                                 else
                                     prevValue = true;
 
-                                commandBuffer->appendNull(redoLogRecord1->object->columns[i]->columnName);
+                                commandBuffer->appendNull(redoLogRecord1->object->columns[i]);
                             } else {
                                 if (prevValue)
                                     commandBuffer->append(',');
                                 else
                                     prevValue = true;
 
-                                commandBuffer->appendValue(redoLogRecord1->object->columns[i]->columnName,
-                                        afterRecord[i], redoLogRecord1->object->columns[i]->typeNo, afterPos[i], afterLen[i]);
+                                commandBuffer->appendValue(redoLogRecord1->object->columns[i],
+                                        afterRecord[i], afterPos[i], afterLen[i]);
                             }
                         }
                     }
@@ -943,6 +835,10 @@ namespace OpenLogReplicator {
                     commandBuffer->append('}');
                 }
 
+                if (stream == STREAM_AVRO) {
+                    commandBuffer->endAvroImage(redoLogRecord1->object);
+                }
+
                 delete[] afterRecord;
                 delete[] beforeRecord;
                 delete[] colSupp;
@@ -966,6 +862,13 @@ namespace OpenLogReplicator {
                     ->appendDbzTail(redoLogRecord2->object, lastTime.toTime() * 1000, lastScn, op, redoLogRecord1->xid)
                     ->commitTran();
         }
+
+        if (stream == STREAM_AVRO) {
+            if (type == TRANSACTION_DELETE)
+                commandBuffer->appendAvroNullImage();
+            commandBuffer->commitTran();
+        }
+        commandBuffer->commitSpan();
     }
 
     //0x18010000
@@ -1036,7 +939,7 @@ namespace OpenLogReplicator {
                         ->append(',')
                         ->appendOperation("truncate")
                         ->append(',')
-                        ->appendTable(redoLogRecord1->object->owner, redoLogRecord1->object->objectName)
+                        ->appendTable(redoLogRecord1->object)
                         ->append('}');
             }
         } else if (type == 12) {
@@ -1049,7 +952,7 @@ namespace OpenLogReplicator {
                         ->append(',')
                         ->appendOperation("drop")
                         ->append(',')
-                        ->appendTable(redoLogRecord1->object->owner, redoLogRecord1->object->objectName)
+                        ->appendTable(redoLogRecord1->object)
                         ->append('}');
             }
         } else if (type == 15) {
@@ -1062,9 +965,17 @@ namespace OpenLogReplicator {
                         ->append(',')
                         ->appendOperation("alter")
                         ->append(',')
-                        ->appendTable(redoLogRecord1->object->owner, redoLogRecord1->object->objectName)
+                        ->appendTable(redoLogRecord1->object)
                         ->append('}');
             }
        }
     }
+
+    //copy of the writer used only for formatting into a private buffer
+    Writer* KafkaWriter::newFormatter(CommandBuffer *commandBuffer) {
+        KafkaWriter *formatter = new KafkaWriter(alias, brokers, topic, oracleReader, trace, trace2, stream, sortColumns, metadata,
+                singleDml, nullColumns, test, timestampFormat);
+        formatter->commandBuffer = commandBuffer;
+        return formatter;
+    }
 }
@@ -58,10 +58,15 @@ namespace OpenLogReplicator {
         virtual void beginTran(typescn scn, typetime time, typexid xid);
         virtual void next();
         virtual void commitTran();
+        virtual void beginBatch(typescn scn, typexid xid, uint64_t batch);
+        virtual void commitBatches(typescn scn, typetime time, typexid xid, uint64_t batches);
+        virtual void rollbackBatches(typescn scn, typexid xid, uint64_t batches);
+        virtual void retractDml(typescn scn, typexid xid, uint64_t batch, uint64_t first, uint64_t last);
         virtual void parseInsertMultiple(RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2);
         virtual void parseDeleteMultiple(RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2);
         virtual void parseDML(RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2, uint64_t type);
         virtual void parseDDL(RedoLogRecord *redoLogRecord1);
+        virtual Writer* newFormatter(CommandBuffer *commandBuffer);
 
         KafkaWriter(const string alias, const string brokers, const string topic, OracleReader *oracleReader, uint64_t trace, uint64_t trace2,
                 uint64_t stream, uint64_t sortColumns, uint64_t metadata, uint64_t singleDml, uint64_t nullColumns, uint64_t test,
@@ -66,11 +66,12 @@ namespace OpenLogReplicator {
             } else if (i == 12) {
                 if (validDDL && redoLogRecord->scn > oracleReader->databaseScn) {
                     redoLogRecord->objn = oracleReader->read32(redoLogRecord->data + fieldPos + 0);
-                    if (type == 12 || type == 15) {
+                    if (type == 12) {
                         OracleObject *obj = oracleReader->checkDict(redoLogRecord->objn, 0);
                         if (obj != nullptr)
                             obj->altered = true;
-                    }
+                    } else if (type == 15)
+                        oracleReader->alterDict(redoLogRecord->objn, redoLogRecord->xid);
                 }
             }
 
@@ -31,8 +31,12 @@ along with Open Log Replicator; see the file LICENSE.txt  If not see
 #include <execinfo.h>
 #include <rapidjson/document.h>
 
+#include "ArrowWriter.h"
 #include "CommandBuffer.h"
+#include "FileDictionaryProvider.h"
+#include "OracleDictionaryProvider.h"
 #include "OracleReader.h"
+#include "OutputCursor.h"
 #include "KafkaWriter.h"
 
 using namespace std;
@@ -55,6 +59,21 @@ const Value& getJSONfield(const Document& document, const char* field) {
     return document[field];
 }
 
+//optional, 0 - bad value
+uint64_t getLagPolicy(const Value& target) {
+    if (!target.HasMember("lag-policy"))
+        return LAG_POLICY_BLOCK;
+
+    const Value& lagPolicyJSON = getJSONfield(target, "lag-policy");
+    if (strcmp("block", lagPolicyJSON.GetString()) == 0)
+        return LAG_POLICY_BLOCK;
+    else if (strcmp("drop", lagPolicyJSON.GetString()) == 0)
+        return LAG_POLICY_DROP;
+
+    cerr << "ERROR: bad JSON, lag-policy should be block or drop!" << endl;
+    return 0;
+}
+
 mutex mainMtx;
 condition_variable mainThread;
 
@@ -135,6 +154,21 @@ int main() {
         const Value& maxConcurrentTransactionsJSON = getJSONfield(document, "max-concurrent-transactions");
         uint64_t maxConcurrentTransactions = maxConcurrentTransactionsJSON.GetUint64();
 
+        //optional
+        uint64_t formatterThreads = 0;
+        if (document.HasMember("formatter-threads")) {
+            const Value& formatterThreadsJSON = getJSONfield(document, "formatter-threads");
+            formatterThreads = formatterThreadsJSON.GetUint64();
+        }
+        //private buffer of every formatter thread, not bigger than the output buffer
+        uint64_t formatterBufferSize = outputBufferSize;
+        if (document.HasMember("formatter-buffer-mb")) {
+            const Value& formatterBufferSizeJSON = getJSONfield(document, "formatter-buffer-mb");
+            formatterBufferSize = formatterBufferSizeJSON.GetUint64() * 1048576;
+        }
+        if (formatterBufferSize == 0 || formatterBufferSize > outputBufferSize)
+            formatterBufferSize = outputBufferSize;
+
         //iterate through sources
         const Value& sources = getJSONfield(document, "sources");
         if (!sources.IsArray())
@@ -146,21 +180,48 @@ int main() {
             if (strcmp("ORACLE", type.GetString()) == 0) {
                 const Value& alias = getJSONfield(source, "alias");
                 const Value& name = getJSONfield(source, "name");
-                const Value& user = getJSONfield(source, "user");
-                const Value& password = getJSONfield(source, "password");
-                const Value& server = getJSONfield(source, "server");
                 const Value& eventtable = getJSONfield(source, "eventtable");
                 const Value& tables = getJSONfield(source, "tables");
                 if (!tables.IsArray())
                     {cerr << "ERROR: bad JSON, objects should be array!" << endl; return 1;}
 
+                //optional
+                uint64_t streamTransactionSize = 0;
+                if (source.HasMember("stream-transaction-mb")) {
+                    const Value& streamTransactionSizeJSON = getJSONfield(source, "stream-transaction-mb");
+                    streamTransactionSize = streamTransactionSizeJSON.GetUint64() * 1048576;
+                }
+                uint64_t streamTransactionRows = 1048576;
+                if (source.HasMember("stream-transaction-rows")) {
+                    const Value& streamTransactionRowsJSON = getJSONfield(source, "stream-transaction-rows");
+                    streamTransactionRows = streamTransactionRowsJSON.GetUint64();
+                }
+                uint64_t lowLatency = 0;
+                if (source.HasMember("low-latency")) {
+                    const Value& lowLatencyJSON = getJSONfield(source, "low-latency");
+                    lowLatency = lowLatencyJSON.GetUint64();
+                }
+
+                //dictionary from snapshot file instead of database connection
+                DictionaryProvider *dictionaryProvider;
+                if (source.HasMember("dictionary-file")) {
+                    const Value& dictionaryFile = getJSONfield(source, "dictionary-file");
+                    dictionaryProvider = new FileDictionaryProvider(dictionaryFile.GetString());
+                } else {
+                    const Value& user = getJSONfield(source, "user");
+                    const Value& password = getJSONfield(source, "password");
+                    const Value& server = getJSONfield(source, "server");
+                    dictionaryProvider = new OracleDictionaryProvider(user.GetString(), password.GetString(), server.GetString());
+                }
+
                 cout << "Adding source: " << name.GetString() << endl;
                 CommandBuffer *commandBuffer = new CommandBuffer(outputBufferSize);
 
                 buffers.push_back(commandBuffer);
-                OracleReader *oracleReader = new OracleReader(commandBuffer, alias.GetString(), name.GetString(), user.GetString(),
-                        password.GetString(), server.GetString(), trace, trace2, dumpRedoLog, dumpRawData, directRead, redoReadSleep,
-                        checkpointInterval, redoBuffers, redoBufferSize, maxConcurrentTransactions);
+                OracleReader *oracleReader = new OracleReader(commandBuffer, alias.GetString(), name.GetString(), dictionaryProvider,
+                        trace, trace2, dumpRedoLog, dumpRawData, directRead, redoReadSleep, checkpointInterval, redoBuffers, redoBufferSize,
+                        maxConcurrentTransactions, streamTransactionSize, streamTransactionRows, formatterThreads, formatterBufferSize,
+                        lowLatency);
                 commandBuffer->setOracleReader(oracleReader);
                 readers.push_back(oracleReader);
 
@@ -171,14 +232,39 @@ int main() {
                     return -1;
                 }
 
-                oracleReader->addTable(eventtable.GetString(), 1);
+                vector<string> includeColumns, excludeColumns;
+                string filter;
+                oracleReader->addTable(eventtable.GetString(), 1, includeColumns, excludeColumns, filter);
                 for (SizeType j = 0; j < tables.Size(); ++j) {
                     const Value& table = getJSONfield(tables[j], "table");
-                    oracleReader->addTable(table.GetString(), 0);
-                }
 
-                //run
-                pthread_create(&oracleReader->pthread, nullptr, &OracleReader::runStatic, (void*)oracleReader);
+                    //optional
+                    includeColumns.clear();
+                    excludeColumns.clear();
+                    filter.clear();
+                    if (tables[j].HasMember("columns")) {
+                        const Value& columnsJSON = getJSONfield(tables[j], "columns");
+                        if (!columnsJSON.IsArray())
+                            {cerr << "ERROR: bad JSON, columns should be an array!" << endl; return 1;}
+                        for (SizeType k = 0; k < columnsJSON.Size(); ++k)
+                            includeColumns.push_back(columnsJSON[k].GetString());
+                    }
+                    if (tables[j].HasMember("exclude-columns")) {
+                        const Value& excludeColumnsJSON = getJSONfield(tables[j], "exclude-columns");
+                        if (!excludeColumnsJSON.IsArray())
+                            {cerr << "ERROR: bad JSON, exclude-columns should be an array!" << endl; return 1;}
+                        for (SizeType k = 0; k < excludeColumnsJSON.Size(); ++k)
+                            excludeColumns.push_back(excludeColumnsJSON[k].GetString());
+                    }
+
+                    if (tables[j].HasMember("filter")) {
+                        const Value& filterJSON = getJSONfield(tables[j], "filter");
+                        filter = filterJSON.GetString();
+                    }
+
+                    if (!oracleReader->addTable(table.GetString(), 0, includeColumns, excludeColumns, filter))
+                        {cerr << "ERROR: bad column projection or filter for table " << table.GetString() << endl; return 1;}
+                }
             }
         }
 
@@ -202,7 +288,9 @@ int main() {
                     stream = STREAM_JSON;
                 else if (strcmp("DBZ-JSON", streamJSON.GetString()) == 0)
                     stream = STREAM_DBZ_JSON;
-                else {cerr << "ERROR: bad JSON, only stream of type JSON is currently supported!" << endl; return 1;}
+                else if (strcmp("AVRO", streamJSON.GetString()) == 0)
+                    stream = STREAM_AVRO;
+                else {cerr << "ERROR: bad JSON, stream should be JSON, DBZ-JSON or AVRO!" << endl; return 1;}
 
                 const Value& topic = getJSONfield(format, "topic");
                 const Value& sortColumnsJSON = getJSONfield(format, "sort-columns");
@@ -218,6 +306,32 @@ int main() {
                 const Value& timestampFormatJSON = getJSONfield(format, "timestamp-format");
                 uint64_t timestampFormat = timestampFormatJSON.GetUint64();
 
+                //optional
+                uint64_t shards = 0;
+                if (format.HasMember("shards")) {
+                    const Value& shardsJSON = getJSONfield(format, "shards");
+                    shards = shardsJSON.GetUint64();
+                    if (shards == 1)
+                        shards = 0;
+                }
+                uint64_t shardBy = SHARD_BY_TABLE;
+                if (format.HasMember("shard-by")) {
+                    const Value& shardByJSON = getJSONfield(format, "shard-by");
+                    if (strcmp("table", shardByJSON.GetString()) == 0)
+                        shardBy = SHARD_BY_TABLE;
+                    else if (strcmp("key", shardByJSON.GetString()) == 0)
+                        shardBy = SHARD_BY_KEY;
+                    else {cerr << "ERROR: bad JSON, shard-by should be table or key!" << endl; return 1;}
+                }
+                string schemaPath = ".";
+                if (format.HasMember("schema-path")) {
+                    const Value& schemaPathJSON = getJSONfield(format, "schema-path");
+                    schemaPath = schemaPathJSON.GetString();
+                }
+                uint64_t lagPolicy = getLagPolicy(target);
+                if (lagPolicy == 0)
+                    return 1;
+
                 OracleReader *oracleReader = nullptr;
 
                 for (auto reader : readers)
@@ -226,12 +340,38 @@ int main() {
                 if (oracleReader == nullptr)
                     {cerr << "ERROR: Alias " << alias.GetString() << " not found!" << endl; return 1;}
 
+                //first target of the source formats the output, next ones only read it
+                bool formatter = (oracleReader->commandBuffer->writer == nullptr);
+                if (!formatter) {
+                    if (oracleReader->commandBuffer->stream != stream)
+                        {cerr << "ERROR: targets of source " << source.GetString() << " should use the same stream!" << endl; return 1;}
+                    if (shards > 0 || oracleReader->commandBuffer->shards > 0)
+                        {cerr << "ERROR: shards are only supported for a single target of source " << source.GetString() << endl; return 1;}
+                }
+
+                if (stream != STREAM_JSON && oracleReader->streamTransactionSize > 0) {
+                    cerr << "WARNING: stream-transaction-mb is only supported for JSON stream, disabled for " << source.GetString() << endl;
+                    oracleReader->streamTransactionSize = 0;
+                }
+
                 cout << "Adding target: " << alias.GetString() << endl;
                 KafkaWriter *kafkaWriter = new KafkaWriter(alias.GetString(), brokers.GetString(), topic.GetString(), oracleReader, trace, trace2,
                         stream, sortColumns, metadata, singleDml, nullColumns, test, timestampFormat);
-                oracleReader->commandBuffer->writer = kafkaWriter;
-                oracleReader->commandBuffer->test = test;
-                oracleReader->commandBuffer->timestampFormat = timestampFormat;
+                if (!formatter && (!kafkaWriter->sameFormat(oracleReader->commandBuffer->writer) ||
+                        (stream == STREAM_AVRO && oracleReader->commandBuffer->avroSchemaPath.compare(schemaPath) != 0))) {
+                    cerr << "ERROR: format of target " << alias.GetString() << " should be the same as of the first target of source " <<
+                            source.GetString() << endl;
+                    delete kafkaWriter;
+                    return 1;
+                }
+                if (formatter) {
+                    oracleReader->commandBuffer->writer = kafkaWriter;
+                    oracleReader->commandBuffer->test = test;
+                    oracleReader->commandBuffer->timestampFormat = timestampFormat;
+                    oracleReader->commandBuffer->stream = stream;
+                    oracleReader->commandBuffer->avroSchemaPath = schemaPath;
+                }
+                kafkaWriter->cursor = oracleReader->commandBuffer->addCursor(lagPolicy);
                 writers.push_back(kafkaWriter);
 
                 //initialize
@@ -244,9 +384,108 @@ int main() {
 
                 //run
                 pthread_create(&kafkaWriter->pthread, nullptr, &KafkaWriter::runStatic, (void*)kafkaWriter);
+
+                //every shard has own buffer and writer, shard 0 uses main buffer
+                if (shards > 0) {
+                    CommandBuffer **shardBuffers = new CommandBuffer*[shards];
+                    if (shardBuffers == nullptr) {
+                        cerr << "ERROR: could not allocate " << dec << (shards * sizeof(CommandBuffer*)) << " bytes memory for (reason: shards)" << endl;
+                        return -1;
+                    }
+                    shardBuffers[0] = oracleReader->commandBuffer;
+
+                    for (uint64_t j = 0; j < shards; ++j) {
+                        if (j > 0) {
+                            shardBuffers[j] = new CommandBuffer(outputBufferSize);
+                            buffers.push_back(shardBuffers[j]);
+                            shardBuffers[j]->setOracleReader(oracleReader);
+                            shardBuffers[j]->test = test;
+                            shardBuffers[j]->timestampFormat = timestampFormat;
+                            shardBuffers[j]->stream = stream;
+
+                            string shardAlias = string(alias.GetString()) + "-" + to_string(j);
+                            KafkaWriter *shardWriter = new KafkaWriter(shardAlias.c_str(), brokers.GetString(), topic.GetString(), oracleReader,
+                                    trace, trace2, stream, sortColumns, metadata, singleDml, nullColumns, test, timestampFormat);
+                            shardWriter->commandBuffer = shardBuffers[j];
+                            shardWriter->cursor = shardBuffers[j]->addCursor(lagPolicy);
+                            shardBuffers[j]->writer = shardWriter;
+                            writers.push_back(shardWriter);
+
+                            if (!shardWriter->initialize()) {
+                                cerr << "ERROR: Kafka starting writer for " << brokers.GetString() << " topic " << topic.GetString() << endl;
+                                return -1;
+                            }
+                            pthread_create(&shardWriter->pthread, nullptr, &KafkaWriter::runStatic, (void*)shardWriter);
+                        }
+                        shardBuffers[j]->shard = j;
+                        shardBuffers[j]->shards = shards;
+                        shardBuffers[j]->shardBy = shardBy;
+                    }
+
+                    oracleReader->setShards(shards, shardBuffers);
+                }
+
+            } else if (strcmp("ARROW", type.GetString()) == 0) {
+                const Value& alias = getJSONfield(target, "alias");
+                const Value& source = getJSONfield(target, "source");
+
+                //optional
+                string path = ".";
+                if (target.HasMember("path")) {
+                    const Value& pathJSON = getJSONfield(target, "path");
+                    path = pathJSON.GetString();
+                }
+                uint64_t batchRows = 65536;
+                if (target.HasMember("batch-rows")) {
+                    const Value& batchRowsJSON = getJSONfield(target, "batch-rows");
+                    batchRows = batchRowsJSON.GetUint64();
+                    if (batchRows == 0)
+                        {cerr << "ERROR: bad JSON, batch-rows should be greater than 0!" << endl; return 1;}
+                }
+                uint64_t batchMs = 1000;
+                if (target.HasMember("batch-ms")) {
+                    const Value& batchMsJSON = getJSONfield(target, "batch-ms");
+                    batchMs = batchMsJSON.GetUint64();
+                }
+                uint64_t lagPolicy = getLagPolicy(target);
+                if (lagPolicy == 0)
+                    return 1;
+
+                OracleReader *oracleReader = nullptr;
+
+                for (auto reader : readers)
+                    if (reader->alias.compare(source.GetString()) == 0)
+                        oracleReader = (OracleReader*)reader;
+                if (oracleReader == nullptr)
+                    {cerr << "ERROR: Alias " << alias.GetString() << " not found!" << endl; return 1;}
+
+                bool formatter = (oracleReader->commandBuffer->writer == nullptr);
+                if (!formatter && (oracleReader->commandBuffer->stream != STREAM_ARROW || oracleReader->commandBuffer->shards > 0))
+                    {cerr << "ERROR: targets of source " << source.GetString() << " should use the same stream!" << endl; return 1;}
+
+                if (oracleReader->streamTransactionSize > 0) {
+                    cerr << "WARNING: stream-transaction-mb is only supported for JSON stream, disabled for " << source.GetString() << endl;
+                    oracleReader->streamTransactionSize = 0;
+                }
+
+                cout << "Adding target: " << alias.GetString() << endl;
+                ArrowWriter *arrowWriter = new ArrowWriter(alias.GetString(), path, batchRows, batchMs, oracleReader, trace, trace2);
+                if (formatter) {
+                    oracleReader->commandBuffer->writer = arrowWriter;
+                    oracleReader->commandBuffer->stream = STREAM_ARROW;
+                }
+                arrowWriter->cursor = oracleReader->commandBuffer->addCursor(lagPolicy);
+                writers.push_back(arrowWriter);
+
+                //run
+                pthread_create(&arrowWriter->pthread, nullptr, &ArrowWriter::runStatic, (void*)arrowWriter);
             }
         }
 
+        //run readers after all writers are configured
+        for (auto reader : readers)
+            pthread_create(&reader->pthread, nullptr, &OracleReader::runStatic, (void*)reader);
+
         //sleep until killed
         {
             unique_lock<mutex> lck(mainMtx);
@@ -38,6 +38,7 @@ namespace OpenLogReplicator {
         int64_t scale;
         uint64_t numPk;
         bool nullable;
+        string nameFragment;        //"NAME":
 
         OracleColumn(uint64_t colNo, uint64_t segSolNo, string columnName, uint64_t typeNo, uint64_t length, int64_t precision,
                 int64_t scale, uint64_t numPk, bool nullable);
@@ -0,0 +1,421 @@
+/* Dictionary read from Oracle database using OCCI connection
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <sys/stat.h>
+#include <string>
+#include <iostream>
+#include <unistd.h>
+#include "types.h"
+#include "OracleColumn.h"
+#include "OracleDictionaryProvider.h"
+#include "OracleObject.h"
+#include "OracleReader.h"
+#include "OracleReaderRedo.h"
+#include "OracleStatement.h"
+#include "RedoLogException.h"
+
+using namespace std;
+using namespace oracle::occi;
+
+namespace OpenLogReplicator {
+
+    OracleDictionaryProvider::OracleDictionaryProvider(const string user, const string passwd, const string connectString) :
+        DictionaryProvider(true),
+        env(nullptr),
+        conn(nullptr),
+        user(user),
+        passwd(passwd),
+        connectString(connectString) {
+
+        env = Environment::createEnvironment (Environment::DEFAULT);
+    }
+
+    OracleDictionaryProvider::~OracleDictionaryProvider() {
+        if (conn != nullptr) {
+            env->terminateConnection(conn);
+            conn = nullptr;
+        }
+        if (env != nullptr) {
+            Environment::terminateEnvironment(env);
+            env = nullptr;
+        }
+    }
+
+    void OracleDictionaryProvider::checkConnection(bool reconnect) {
+        while (!oracleReader->shutdown) {
+            if (conn == nullptr) {
+                cout << "- connecting to Oracle database " << oracleReader->database << endl;
+                try {
+                    conn = env->createConnection(user, passwd, connectString);
+                } catch(SQLException &ex) {
+                    cerr << "ERROR: " << dec << ex.getErrorCode() << ": " << ex.getMessage();
+                }
+            }
+
+            if (conn != nullptr || !reconnect)
+                break;
+
+            cerr << "ERROR: cannot connect to database, retry in 5 sec." << endl;
+            sleep(5);
+        }
+    }
+
+    uint64_t OracleDictionaryProvider::initialize(void) {
+        checkConnection(false);
+        if (conn == nullptr)
+            return 0;
+
+        typescn currentDatabaseScn;
+        typeresetlogs currentResetlogs;
+
+        try {
+            OracleStatement stmt(&conn, env);
+            //check archivelog mode, supplemental log min, endian
+            stmt.createStatement("SELECT D.LOG_MODE, D.SUPPLEMENTAL_LOG_DATA_MIN, TP.ENDIAN_FORMAT, D.CURRENT_SCN, DI.RESETLOGS_ID, VER.BANNER, SYS_CONTEXT('USERENV','DB_NAME') AS DB_NAME FROM SYS.V_$DATABASE D JOIN SYS.V_$TRANSPORTABLE_PLATFORM TP ON TP.PLATFORM_NAME = D.PLATFORM_NAME JOIN SYS.V_$VERSION VER ON VER.BANNER LIKE '%Oracle Database%' JOIN SYS.V_$DATABASE_INCARNATION DI ON DI.STATUS = 'CURRENT'");
+            stmt.executeQuery();
+
+            if (stmt.rset->next()) {
+                string LOG_MODE = stmt.rset->getString(1);
+                if (LOG_MODE.compare("ARCHIVELOG") != 0) {
+                    cerr << "ERROR: database not in ARCHIVELOG mode. RUN: " << endl;
+                    cerr << " SHUTDOWN IMMEDIATE;" << endl;
+                    cerr << " STARTUP MOUNT;" << endl;
+                    cerr << " ALTER DATABASE ARCHIVELOG;" << endl;
+                    cerr << " ALTER DATABASE OPEN;" << endl;
+                    return 0;
+                }
+
+                string SUPPLEMENTAL_LOG_MIN = stmt.rset->getString(2);
+                if (SUPPLEMENTAL_LOG_MIN.compare("YES") != 0) {
+                    cerr << "Error: SUPPLEMENTAL_LOG_DATA_MIN missing: RUN:" << endl;
+                    cerr << " ALTER DATABASE ADD SUPPLEMENTAL LOG DATA;" << endl;
+                    cerr << " ALTER SYSTEM ARCHIVE LOG CURRENT;" << endl;
+                    return 0;
+                }
+
+                string ENDIANNESS = stmt.rset->getString(3);
+                if (ENDIANNESS.compare("Big") == 0)
+                    oracleReader->setBigEndian();
+
+                currentDatabaseScn = stmt.rset->getNumber(4);
+                currentResetlogs = stmt.rset->getNumber(5);
+                if (oracleReader->resetlogs != 0 && currentResetlogs != oracleReader->resetlogs) {
+                    cerr << "Error: Incorrect database incarnation. Previous resetlogs:" << dec << oracleReader->resetlogs << ", current: " << currentResetlogs << endl;
+                    return 0;
+                } else {
+                    oracleReader->resetlogs = currentResetlogs;
+                }
+
+                //12+
+                string VERSION = stmt.rset->getString(6);
+                cout << "- version: " << dec << VERSION << endl;
+
+                oracleReader->conId = 0;
+                if (VERSION.find("Oracle Database 11g") == string::npos) {
+                    OracleStatement stmt(&conn, env);
+                    stmt.createStatement("select sys_context('USERENV','CON_ID') CON_ID from DUAL");
+                    stmt.executeQuery();
+
+                    if (stmt.rset->next()) {
+                        oracleReader->conId = stmt.rset->getNumber(1);
+                        cout << "- conId: " << dec << oracleReader->conId << endl;
+                    }
+                }
+
+                oracleReader->databaseContext = stmt.rset->getString(7);
+
+            } else {
+                cerr << "ERROR: reading SYS.V_$DATABASE" << endl;
+                return 0;
+            }
+        } catch(SQLException &ex) {
+            cerr << "ERROR: " << dec << ex.getErrorCode() << ": " << ex.getMessage();
+            return 0;
+        }
+
+        if (oracleReader->databaseSequence == 0 || oracleReader->databaseScn == 0) {
+            try {
+                OracleStatement stmt(&conn, env);
+                stmt.createStatement("select SEQUENCE# from SYS.V_$LOG where status = 'CURRENT'");
+                stmt.executeQuery();
+
+                if (stmt.rset->next()) {
+                    oracleReader->databaseSequence = stmt.rset->getNumber(1);
+                    oracleReader->databaseScn = currentDatabaseScn;
+                }
+            } catch(SQLException &ex) {
+                cerr << "ERROR: " << dec << ex.getErrorCode() << ": " << ex.getMessage();
+            }
+        }
+
+        return 1;
+    }
+
+    OracleObject *OracleDictionaryProvider::readObject(typeobj objn, typeobj objd, uint64_t depdendencies, uint64_t cluCols, uint64_t options,
+            string owner, string objectName, uint64_t ddlTime, typescn scn) {
+        uint64_t totalPk = 0, totalCols = 0;
+        string asOf;
+        if (scn != ZERO_SCN)
+            asOf = " AS OF SCN " + to_string(scn);
+        OracleObject *object = new OracleObject(objn, objd, depdendencies, cluCols, options, owner, objectName);
+        object->ddlTime = ddlTime;
+
+        OracleStatement stmt(&conn, env);
+        stmt.createStatement("SELECT C.COL#, C.SEGCOL#, C.NAME, C.TYPE#, C.LENGTH, C.PRECISION#, C.SCALE, C.NULL$, (SELECT COUNT(*) FROM SYS.CCOL$" + asOf + " L JOIN SYS.CDEF$" + asOf +
+                " D on D.con# = L.con# AND D.type# = 2 WHERE L.intcol# = C.intcol# and L.obj# = C.obj#) AS NUMPK FROM SYS.COL$" + asOf + " C WHERE C.OBJ# = :i ORDER BY C.SEGCOL#");
+        stmt.stmt->setInt(1, objn);
+        stmt.executeQuery();
+
+        while (stmt.rset->next()) {
+            uint64_t colNo = stmt.rset->getNumber(1);
+            uint64_t segColNo = stmt.rset->getNumber(2);
+            string columnName = stmt.rset->getString(3);
+            uint64_t typeNo = stmt.rset->getNumber(4);
+            uint64_t length = stmt.rset->getNumber(5);
+            int64_t precision = -1;
+            if (!stmt.rset->isNull(6))
+                precision = stmt.rset->getNumber(6);
+            int64_t scale = -1;
+            if (!stmt.rset->isNull(7))
+                scale = stmt.rset->getNumber(7);
+
+            int64_t nullable = stmt.rset->getNumber(8);
+            uint64_t numPk = stmt.rset->getNumber(9);
+            OracleColumn *column = new OracleColumn(colNo, segColNo, columnName, typeNo, length, precision, scale, numPk, (nullable == 0));
+            totalPk += numPk;
+            ++totalCols;
+
+            object->addColumn(column);
+        }
+
+        object->totalCols = totalCols;
+        object->totalPk = totalPk;
+        return object;
+    }
+
+    void OracleDictionaryProvider::readTables(OracleTableMask &tableMask) {
+        checkConnection(false);
+
+        try {
+            OracleStatement stmt(&conn, env);
+            stmt.createStatement(
+                    "SELECT tab.DATAOBJ# as objd, tab.OBJ# as objn, tab.CLUCOLS as clucols, usr.USERNAME AS owner, obj.NAME AS objectName, decode(bitand(tab.FLAGS, 8388608), 8388608, 1, 0) as dependencies, "
+                    "(obj.MTIME - TO_DATE('1970-01-01', 'YYYY-MM-DD')) * 86400 as ddltime "
+                    "FROM SYS.TAB$ tab, SYS.OBJ$ obj, ALL_USERS usr "
+                    "WHERE tab.OBJ# = obj.OBJ# "
+                    "AND obj.OWNER# = usr.USER_ID "
+                    "AND usr.USERNAME || '.' || obj.NAME LIKE :i");
+            stmt.stmt->setString(1, tableMask.mask);
+
+            stmt.executeQuery();
+            while (stmt.rset->next()) {
+                //skip partitioned/IOT tables
+                string owner = stmt.rset->getString(4);
+                string objectName = stmt.rset->getString(5);
+                typeobj objn = stmt.rset->getNumber(2);
+                if (stmt.rset->isNull(1)) {
+                    cout << endl << "  * skipped: " << owner << "." << objectName << " (OBJN: " << dec << objn << ") - partitioned or IOT";
+                } else {
+                    typeobj objd = stmt.rset->getNumber(1);
+                    uint64_t cluCols = 0;
+                    if (!stmt.rset->isNull(3))
+                        stmt.rset->getNumber(3);
+                    uint64_t depdendencies = stmt.rset->getNumber(6);
+                    uint64_t ddlTime = stmt.rset->getNumber(7);
+                    OracleObject *object = readObject(objn, objd, depdendencies, cluCols, tableMask.options, owner, objectName, ddlTime, ZERO_SCN);
+                    tableMask.objects.push_back(objn);
+
+                    cout << endl << "  * found: " << owner << "." << objectName << " (OBJD: " << dec << objd << ", OBJN: " << dec << objn << ", DEP: " << dec << depdendencies << ")";
+                    oracleReader->addToDict(object);
+                }
+            }
+        } catch(SQLException &ex) {
+            cerr << "ERROR: getting table metadata: " << dec << ex.getErrorCode() << ": " << ex.getMessage();
+        }
+    }
+
+    //definition as of the commit of DDL, not the current one which may have been changed again
+    OracleObject *OracleDictionaryProvider::reloadObject(typeobj objn, uint64_t options, typescn scn) {
+        checkConnection(true);
+
+        try {
+            string asOf = " AS OF SCN " + to_string(scn);
+            OracleStatement stmt(&conn, env);
+            stmt.createStatement(
+                    "SELECT tab.DATAOBJ# as objd, tab.OBJ# as objn, tab.CLUCOLS as clucols, usr.USERNAME AS owner, obj.NAME AS objectName, decode(bitand(tab.FLAGS, 8388608), 8388608, 1, 0) as dependencies, "
+                    "(obj.MTIME - TO_DATE('1970-01-01', 'YYYY-MM-DD')) * 86400 as ddltime "
+                    "FROM SYS.TAB$" + asOf + " tab, SYS.OBJ$" + asOf + " obj, ALL_USERS usr "
+                    "WHERE tab.OBJ# = obj.OBJ# "
+                    "AND obj.OWNER# = usr.USER_ID "
+                    "AND tab.OBJ# = :i");
+            stmt.stmt->setInt(1, objn);
+
+            stmt.executeQuery();
+            if (stmt.rset->next() && !stmt.rset->isNull(1)) {
+                typeobj objd = stmt.rset->getNumber(1);
+                uint64_t cluCols = 0;
+                string owner = stmt.rset->getString(4);
+                string objectName = stmt.rset->getString(5);
+                uint64_t depdendencies = stmt.rset->getNumber(6);
+                uint64_t ddlTime = stmt.rset->getNumber(7);
+                return readObject(objn, objd, depdendencies, cluCols, options, owner, objectName, ddlTime, scn);
+            }
+        } catch(SQLException &ex) {
+            cerr << "ERROR: reloading table metadata: " << dec << ex.getErrorCode() << ": " << ex.getMessage();
+        }
+
+        return nullptr;
+    }
+
+    //objects loaded from cache are compared by DDL time
+    bool OracleDictionaryProvider::validateTables(OracleTableMask &tableMask) {
+        bool changed = false;
+        checkConnection(true);
+
+        try {
+            unordered_map<typeobj, bool> listed, present;
+            for (auto objn : tableMask.objects)
+                listed[objn] = true;
+
+            OracleStatement stmt(&conn, env);
+            stmt.createStatement(
+                    "SELECT tab.DATAOBJ# as objd, tab.OBJ# as objn, tab.CLUCOLS as clucols, usr.USERNAME AS owner, obj.NAME AS objectName, decode(bitand(tab.FLAGS, 8388608), 8388608, 1, 0) as dependencies, "
+                    "(obj.MTIME - TO_DATE('1970-01-01', 'YYYY-MM-DD')) * 86400 as ddltime "
+                    "FROM SYS.TAB$ tab, SYS.OBJ$ obj, ALL_USERS usr "
+                    "WHERE tab.OBJ# = obj.OBJ# "
+                    "AND obj.OWNER# = usr.USER_ID "
+                    "AND usr.USERNAME || '.' || obj.NAME LIKE :i");
+            stmt.stmt->setString(1, tableMask.mask);
+
+            stmt.executeQuery();
+            while (stmt.rset->next()) {
+                if (stmt.rset->isNull(1))
+                    continue;
+                typeobj objn = stmt.rset->getNumber(2);
+                uint64_t ddlTime = stmt.rset->getNumber(7);
+                present[objn] = true;
+                if (!listed[objn]) {
+                    tableMask.objects.push_back(objn);
+                    changed = true;
+                }
+
+                OracleObject *object = oracleReader->checkDict(objn, 0);
+                if (object != nullptr && object->ddlTime == ddlTime)
+                    continue;
+
+                string owner = stmt.rset->getString(4);
+                string objectName = stmt.rset->getString(5);
+                typeobj objd = stmt.rset->getNumber(1);
+                uint64_t cluCols = 0;
+                uint64_t depdendencies = stmt.rset->getNumber(6);
+                cout << "- reading changed table schema for: " << owner << "." << objectName << " (OBJN: " << dec << objn << ")" << endl;
+
+                if (object != nullptr)
+                    oracleReader->removeFromDict(objn);
+                oracleReader->addToDict(readObject(objn, objd, depdendencies, cluCols, tableMask.options, owner, objectName, ddlTime, ZERO_SCN));
+                changed = true;
+            }
+
+            for (uint64_t i = 0; i < tableMask.objects.size(); ) {
+                if (present[tableMask.objects[i]]) {
+                    ++i;
+                } else {
+                    tableMask.objects.erase(tableMask.objects.begin() + i);
+                    changed = true;
+                }
+            }
+        } catch(SQLException &ex) {
+            cerr << "ERROR: validating schema cache: " << dec << ex.getErrorCode() << ": " << ex.getMessage();
+        }
+
+        return changed;
+    }
+
+    void OracleDictionaryProvider::archLogGetList(void) {
+        checkConnection(true);
+
+        try {
+            OracleStatement stmt(&conn, env);
+            stmt.createStatement("SELECT NAME, SEQUENCE#, FIRST_CHANGE#, FIRST_TIME, NEXT_CHANGE#, NEXT_TIME FROM SYS.V_$ARCHIVED_LOG WHERE SEQUENCE# >= :i AND RESETLOGS_ID = :i AND NAME IS NOT NULL ORDER BY SEQUENCE#, DEST_ID");
+            stmt.stmt->setInt(1, oracleReader->databaseSequence);
+            stmt.stmt->setInt(2, oracleReader->resetlogs);
+            stmt.executeQuery();
+
+            string path;
+            typeseq sequence;
+            typescn firstScn, nextScn;
+
+            while (stmt.rset->next()) {
+                path = stmt.rset->getString(1);
+                sequence = stmt.rset->getNumber(2);
+                firstScn = stmt.rset->getNumber(3);
+                nextScn = stmt.rset->getNumber(5);
+
+                OracleReaderRedo* redo = new OracleReaderRedo(oracleReader, 0, path.c_str());
+                redo->firstScn = firstScn;
+                redo->nextScn = nextScn;
+                redo->sequence = sequence;
+                oracleReader->archiveRedoQueue.push(redo);
+            }
+        } catch(SQLException &ex) {
+            cerr << "ERROR: getting arch log list: " << dec << ex.getErrorCode() << ": " << ex.getMessage();
+        }
+    }
+
+    void OracleDictionaryProvider::onlineLogGetList(void) {
+        checkConnection(true);
+
+        int64_t groupLast = -1, group = -1, groupPrev = -1;
+        struct stat fileStat;
+        string path;
+
+        try {
+            OracleStatement stmt(&conn, env);
+            stmt.createStatement("SELECT LF.GROUP#, LF.MEMBER FROM SYS.V_$LOGFILE LF ORDER BY LF.GROUP# ASC, LF.IS_RECOVERY_DEST_FILE DESC, LF.MEMBER ASC");
+            stmt.executeQuery();
+
+            while (stmt.rset->next()) {
+                groupPrev = group;
+                group = stmt.rset->getNumber(1);
+                path = stmt.rset->getString(2);
+
+                if (groupPrev != groupLast && group != groupPrev) {
+                    throw RedoLogException("can't read any member from group", nullptr, 0);
+                }
+
+                if (group != groupLast && stat(path.c_str(), &fileStat) == 0) {
+                    cerr << "Found log GROUP: " << group << " PATH: " << path << endl;
+                    OracleReaderRedo* redo = new OracleReaderRedo(oracleReader, group, path.c_str());
+                    oracleReader->onlineRedoSet.insert(redo);
+                    groupLast = group;
+                }
+            }
+        } catch(SQLException &ex) {
+            throw RedoLogException("errog getting online log list", nullptr, 0);
+        }
+
+        if (group != groupLast) {
+            throw RedoLogException("can't read any member from group", nullptr, 0);
+        }
+    }
+
+    bool OracleDictionaryProvider::isOffline(void) {
+        return false;
+    }
+}
@@ -0,0 +1,61 @@
+/* Header for OracleDictionaryProvider class
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <string>
+#include <occi.h>
+#include "types.h"
+#include "DictionaryProvider.h"
+
+#ifndef ORACLEDICTIONARYPROVIDER_H_
+#define ORACLEDICTIONARYPROVIDER_H_
+
+using namespace std;
+using namespace oracle::occi;
+
+namespace OpenLogReplicator {
+
+    class OracleObject;
+
+    class OracleDictionaryProvider : public DictionaryProvider {
+    protected:
+        Environment *env;
+        Connection *conn;
+        string user;
+        string passwd;
+        string connectString;
+
+        void checkConnection(bool reconnect);
+        OracleObject *readObject(typeobj objn, typeobj objd, uint64_t depdendencies, uint64_t cluCols, uint64_t options,
+                string owner, string objectName, uint64_t ddlTime, typescn scn);
+
+    public:
+        virtual uint64_t initialize(void);
+        virtual void readTables(OracleTableMask &tableMask);
+        virtual bool validateTables(OracleTableMask &tableMask);
+        virtual OracleObject *reloadObject(typeobj objn, uint64_t options, typescn scn);
+        virtual void archLogGetList(void);
+        virtual void onlineLogGetList(void);
+        virtual bool isOffline(void);
+
+        OracleDictionaryProvider(const string user, const string passwd, const string connectString);
+        virtual ~OracleDictionaryProvider();
+    };
+}
+
+#endif
@@ -0,0 +1,202 @@
+/* Conversion of Oracle NUMBER values
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include "OracleNumber.h"
+
+namespace OpenLogReplicator {
+
+    const char OracleNumber::digitPairs[201] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+    //digits - number of base 100 digits, exponent - power of 100 of the first digit
+    bool OracleNumber::decode(const uint8_t *data, uint64_t length, bool &negative, int64_t &exponent, uint64_t &digits) {
+        if (length < 2 || length > 22)
+            return false;
+
+        //0x80 alone is 0, followed by digits it is the smallest exponent
+        if (data[0] >= 0x80) {
+            negative = false;
+            exponent = ((int64_t)data[0]) - 0xC1;
+            digits = length - 1;
+            for (uint64_t i = 1; i < length; ++i)
+                if (data[i] < 1 || data[i] > 100)
+                    return false;
+        } else {
+            negative = true;
+            exponent = 0x3E - ((int64_t)data[0]);
+            digits = length - 1;
+            if (data[length - 1] == 0x66)
+                --digits;
+            if (digits == 0)
+                return false;
+            for (uint64_t i = 1; i <= digits; ++i)
+                if (data[i] < 2 || data[i] > 101)
+                    return false;
+        }
+
+        //first digit of a normalized value is never 0
+        if (data[1] == (negative ? 101 : 1))
+            return false;
+
+        return digits <= 20;
+    }
+
+    //exact number of characters written by toText, 0 - not a valid NUMBER
+    uint64_t OracleNumber::textLength(const uint8_t *data, uint64_t length) {
+        bool negative;
+        int64_t exponent;
+        uint64_t digits, textLength;
+
+        if (length == 1 && data[0] == 0x80)
+            return 1;
+        if (!decode(data, length, negative, exponent, digits))
+            return 0;
+
+        uint64_t first = negative ? 101 - data[1] : data[1] - 1,
+                 last = negative ? 101 - data[digits] : data[digits] - 1;
+        textLength = negative ? 1 : 0;
+
+        if (exponent >= 0) {
+            textLength += (first < 10 ? 1 : 2) + exponent * 2;
+            if (digits > (uint64_t)exponent + 1)
+                textLength += 1 + (digits - exponent - 1) * 2 - (last % 10 == 0 ? 1 : 0);
+        } else
+            textLength += 2 + (-exponent - 1) * 2 + digits * 2 - (last % 10 == 0 ? 1 : 0);
+
+        return textLength;
+    }
+
+    //writes the value as text without terminating zero, returns number of characters, 0 - not a valid NUMBER
+    uint64_t OracleNumber::toText(const uint8_t *data, uint64_t length, char *text) {
+        bool negative;
+        int64_t exponent;
+        uint64_t digits, val, i;
+        char *pos = text;
+
+        if (length == 1 && data[0] == 0x80) {
+            *text = '0';
+            return 1;
+        }
+        if (!decode(data, length, negative, exponent, digits))
+            return 0;
+
+        if (negative)
+            *pos++ = '-';
+
+        //integer part
+        if (exponent >= 0) {
+            val = negative ? 101 - data[1] : data[1] - 1;
+            if (val < 10)
+                *pos++ = '0' + val;
+            else {
+                *pos++ = digitPairs[val * 2];
+                *pos++ = digitPairs[val * 2 + 1];
+            }
+
+            for (i = 2; i <= (uint64_t)exponent + 1; ++i) {
+                if (i <= digits) {
+                    val = negative ? 101 - data[i] : data[i] - 1;
+                    *pos++ = digitPairs[val * 2];
+                    *pos++ = digitPairs[val * 2 + 1];
+                } else {
+                    *pos++ = '0';
+                    *pos++ = '0';
+                }
+            }
+        } else {
+            *pos++ = '0';
+            i = 1;
+        }
+
+        //fraction part
+        if (i <= digits) {
+            *pos++ = '.';
+            for (int64_t j = exponent + 1; j < 0; ++j) {
+                *pos++ = '0';
+                *pos++ = '0';
+            }
+
+            for (; i <= digits; ++i) {
+                val = negative ? 101 - data[i] : data[i] - 1;
+                *pos++ = digitPairs[val * 2];
+                *pos++ = digitPairs[val * 2 + 1];
+            }
+
+            //last digit - omitting 0 at the end
+            if (val % 10 == 0)
+                --pos;
+        }
+
+        return pos - text;
+    }
+
+    //value = unscaled * 10^-scale with trailing zeros of the fraction removed, false - not a valid NUMBER or out of range
+    bool OracleNumber::toDecimal128(const uint8_t *data, uint64_t length, typedec128 &value, uint64_t &scale) {
+        static const typedec128 limit = ((typedec128)1) << 120;
+        bool negative;
+        int64_t exponent;
+        uint64_t digits;
+
+        value = 0;
+        scale = 0;
+        if (length == 1 && data[0] == 0x80)
+            return true;
+        if (!decode(data, length, negative, exponent, digits))
+            return false;
+
+        for (uint64_t i = 1; i <= digits; ++i) {
+            if (value >= limit)
+                return false;
+            value = value * 100 + (negative ? 101 - data[i] : data[i] - 1);
+        }
+
+        //power of 100 of the last digit
+        int64_t lastExponent = exponent - (int64_t)digits + 1;
+        if (lastExponent >= 0) {
+            for (int64_t i = 0; i < lastExponent; ++i) {
+                if (value >= limit)
+                    return false;
+                value *= 100;
+            }
+        } else {
+            scale = -lastExponent * 2;
+            if (value % 10 == 0) {
+                value /= 10;
+                --scale;
+            }
+        }
+
+        if (negative)
+            value = -value;
+        return true;
+    }
+
+    //false - not a valid NUMBER, has a fraction or does not fit
+    bool OracleNumber::toInt64(const uint8_t *data, uint64_t length, int64_t &value) {
+        typedec128 dec;
+        uint64_t scale;
+
+        if (!toDecimal128(data, length, dec, scale) || scale > 0)
+            return false;
+        if (dec > (typedec128)INT64_MAX || dec < (typedec128)INT64_MIN)
+            return false;
+
+        value = (int64_t)dec;
+        return true;
+    }
+}
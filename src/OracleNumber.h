@@ -0,0 +1,47 @@
+/* Header for OracleNumber class
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include "types.h"
+
+#ifndef ORACLENUMBER_H_
+#define ORACLENUMBER_H_
+
+//longest text of a NUMBER: sign, "0.", 128 padding zeros of the smallest exponent and 40 digits
+#define NUMBER_TEXT_MAX 171
+
+__extension__ typedef __int128 typedec128;
+
+namespace OpenLogReplicator {
+
+    //Oracle NUMBER: exponent byte and up to 20 base 100 digits, negative values are complemented and end with 0x66
+    class OracleNumber {
+    protected:
+        static bool decode(const uint8_t *data, uint64_t length, bool &negative, int64_t &exponent, uint64_t &digits);
+
+    public:
+        static const char digitPairs[201];      //"00" to "99"
+
+        static uint64_t textLength(const uint8_t *data, uint64_t length);
+        static uint64_t toText(const uint8_t *data, uint64_t length, char *text);
+        static bool toDecimal128(const uint8_t *data, uint64_t length, typedec128 &value, uint64_t &scale);
+        static bool toInt64(const uint8_t *data, uint64_t length, int64_t &value);
+    };
+}
+
+#endif
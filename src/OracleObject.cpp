@@ -19,9 +19,12 @@ along with Open Log Replicator; see the file LICENSE.txt  If not see
 
 #include <string>
 #include <iostream>
+#include <string.h>
 #include "types.h"
+#include "MemoryException.h"
 #include "OracleColumn.h"
 #include "OracleObject.h"
+#include "RowFilter.h"
 
 using namespace std;
 
@@ -35,9 +38,15 @@ namespace OpenLogReplicator {
         totalPk(0),
         options(options),
         totalCols(0),
+        ddlTime(0),
         owner(owner),
         objectName(objectName),
-        altered(false) {
+        rowLengthMax(0),
+        avroFingerprint(0),
+        arrowSchemaId(0),
+        altered(false),
+        columnMask(nullptr),
+        filter(nullptr) {
     }
 
     OracleObject::~OracleObject() {
@@ -45,12 +54,68 @@ namespace OpenLogReplicator {
             delete column;
         }
         columns.clear();
+
+        if (columnMask != nullptr) {
+            delete[] columnMask;
+            columnMask = nullptr;
+        }
+
+        if (filter != nullptr) {
+            delete filter;
+            filter = nullptr;
+        }
     }
 
     void OracleObject::addColumn(OracleColumn *column) {
         columns.push_back(column);
     }
 
+    //false when a listed column does not exist, most likely a typo in the configuration
+    bool OracleObject::setProjection(const vector<string> &includeColumns, const vector<string> &excludeColumns) {
+        this->includeColumns = includeColumns;
+        this->excludeColumns = excludeColumns;
+        if (columnMask != nullptr) {
+            delete[] columnMask;
+            columnMask = nullptr;
+        }
+        if (includeColumns.size() == 0 && excludeColumns.size() == 0)
+            return true;
+
+        bool ok = true;
+        for (uint64_t j = 0; j < includeColumns.size() + excludeColumns.size(); ++j) {
+            const string &name = (j < includeColumns.size()) ? includeColumns[j] : excludeColumns[j - includeColumns.size()];
+            bool found = false;
+            for (auto column : columns)
+                if (column->columnName.compare(name) == 0)
+                    found = true;
+            if (!found) {
+                cerr << "ERROR: column projection for " << owner << "." << objectName << " - unknown column " << name << endl;
+                ok = false;
+            }
+        }
+
+        uint64_t maskSize = (columns.size() + 63) / 64;
+        columnMask = new uint64_t[maskSize];
+        if (columnMask == nullptr) {
+            cerr << "ERROR: could not allocate memory for column mask (" << dec << maskSize << " words)" << endl;
+            throw MemoryException("out of memory");
+        }
+        memset(columnMask, 0, maskSize * sizeof(uint64_t));
+
+        for (uint64_t i = 0; i < columns.size(); ++i) {
+            bool projected = (includeColumns.size() == 0);
+            for (auto &name : includeColumns)
+                if (columns[i]->columnName.compare(name) == 0)
+                    projected = true;
+            for (auto &name : excludeColumns)
+                if (columns[i]->columnName.compare(name) == 0)
+                    projected = false;
+            if (projected)
+                columnMask[i >> 6] |= ((uint64_t)1) << (i & 63);
+        }
+        return ok;
+    }
+
     ostream& operator<<(ostream& os, const OracleObject& object) {
         os << "(\"" << object.owner << "\".\"" << object.objectName << "\", " << dec << object.objn << ", " <<
                 object.objd << ", " << object.cluCols << ", " << object.totalCols << ")" << endl;
@@ -24,11 +24,14 @@ along with Open Log Replicator; see the file LICENSE.txt  If not see
 #ifndef ORACLEOBJECT_H_
 #define ORACLEOBJECT_H_
 
+#define COLUMNPROJECTED(object,col) ((object)->columnMask == nullptr || ((object)->columnMask[(col) >> 6] & (((uint64_t)1) << ((col) & 63))) != 0)
+
 using namespace std;
 
 namespace OpenLogReplicator {
 
     class OracleColumn;
+    class RowFilter;
 
     class OracleObject {
     public:
@@ -39,12 +42,25 @@ namespace OpenLogReplicator {
         uint64_t totalPk;
         uint64_t options;
         uint64_t totalCols;
+        uint64_t ddlTime;           //last DDL of the table, seconds since epoch
         string owner;
         string objectName;
         vector<OracleColumn*> columns;
+        string tableFragment;       //"table":"OWNER.NAME"
+        string dbzHeadFragment;     //schema part of Debezium message
+        uint64_t rowLengthMax;      //worst case output of a row without the value bytes
+        string avroSchema;          //schema of Avro messages of the table
+        uint64_t avroFingerprint;   //CRC-64-AVRO of the canonical form of avroSchema
+        string arrowSchema;         //field types and IPC schema message of Arrow batches of the table
+        uint64_t arrowSchemaId;
         bool altered;
+        vector<string> includeColumns;  //empty - all columns
+        vector<string> excludeColumns;
+        uint64_t *columnMask;           //bitmap of output columns, nullptr - all columns
+        RowFilter *filter;              //nullptr - all rows
 
         void addColumn(OracleColumn *column);
+        bool setProjection(const vector<string> &includeColumns, const vector<string> &excludeColumns);
 
         OracleObject(typeobj objn, typeobj objd, uint64_t depdendencies, uint64_t cluCols, uint64_t options, string owner, string objectName);
         virtual ~OracleObject();
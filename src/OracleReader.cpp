@@ -18,6 +18,7 @@ along with Open Log Replicator; see the file LICENSE.txt  If not see
 <http://www.gnu.org/licenses/>.  */
 
 #include <sys/stat.h>
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include <fstream>
@@ -32,38 +33,48 @@ along with Open Log Replicator; see the file LICENSE.txt  If not see
 #include "OracleObject.h"
 #include "OracleReader.h"
 #include "CommandBuffer.h"
+#include "DictionaryProvider.h"
+#include "FormatterPool.h"
+#include "MemoryException.h"
 #include "OracleReaderRedo.h"
 #include "RedoLogException.h"
-#include "OracleStatement.h"
+#include "RowFilter.h"
 #include "Transaction.h"
 #include "TransactionChunk.h"
 
 using namespace std;
 using namespace rapidjson;
-using namespace oracle::occi;
 
 const Value& getJSONfield(const Document& document, const char* field);
+void stopMain();
 
 namespace OpenLogReplicator {
 
-    OracleReader::OracleReader(CommandBuffer *commandBuffer, const string alias, const string database, const string user, const string passwd,
-            const string connectString, uint64_t trace, uint64_t trace2, uint64_t dumpRedoLog, uint64_t dumpRawData, uint64_t directRead,
-            uint64_t redoReadSleep, uint64_t checkpointInterval, uint64_t redoBuffers, uint64_t redoBufferSize, uint64_t maxConcurrentTransactions) :
+    OracleReader::OracleReader(CommandBuffer *commandBuffer, const string alias, const string database, DictionaryProvider *dictionaryProvider,
+            uint64_t trace, uint64_t trace2, uint64_t dumpRedoLog, uint64_t dumpRawData, uint64_t directRead, uint64_t redoReadSleep,
+            uint64_t checkpointInterval, uint64_t redoBuffers, uint64_t redoBufferSize, uint64_t maxConcurrentTransactions,
+            uint64_t streamTransactionSize, uint64_t streamTransactionRows, uint64_t formatterThreads, uint64_t formatterBufferSize,
+            uint64_t lowLatency) :
         Thread(alias, commandBuffer),
         currentRedo(nullptr),
-        databaseSequence(0),
         databaseSequenceArchMax(0),
-        env(nullptr),
-        conn(nullptr),
-        user(user),
-        passwd(passwd),
-        connectString(connectString),
+        schemaChanged(false),
+        dictObjn(nullptr),
+        dictObjects(nullptr),
+        dictSize(0),
+        dictFilter(nullptr),
+        dictFilterBits(0),
+        dictChanged(true),
+        dictionaryProvider(dictionaryProvider),
+        databaseSequence(0),
         database(database),
         databaseContext(""),
         databaseScn(0),
+        xidTransactionMap(maxConcurrentTransactions),
         lastOpTransactionMap(maxConcurrentTransactions),
         transactionHeap(maxConcurrentTransactions),
         transactionBuffer(new TransactionBuffer(redoBuffers, redoBufferSize)),
+        formatterPool(nullptr),
         redoBuffer(new uint8_t[DISK_BUFFER_SIZE * 2]),
         headerBuffer(new uint8_t[REDO_PAGE_SIZE_MAX * 2]),
         recordBuffer(new uint8_t[REDO_RECORD_MAX_SIZE]),
@@ -79,6 +90,9 @@ namespace OpenLogReplicator {
         resetlogs(0),
         previousCheckpoint(clock()),
         checkpointInterval(checkpointInterval),
+        streamTransactionSize(streamTransactionSize),
+        streamTransactionRows(streamTransactionRows),
+        lowLatency(lowLatency),
         bigEndian(false),
         read16(read16Little),
         read32(read32Little),
@@ -92,8 +106,11 @@ namespace OpenLogReplicator {
         write64(write64Little),
         writeSCN(writeSCNLittle) {
 
+        if (formatterThreads > 0)
+            formatterPool = new FormatterPool(this, formatterThreads, formatterBufferSize, nullptr);
+
+        dictionaryProvider->oracleReader = this;
         readCheckpoint();
-        env = Environment::createEnvironment (Environment::DEFAULT);
     }
 
     OracleReader::~OracleReader() {
@@ -103,13 +120,22 @@ namespace OpenLogReplicator {
             delete redoTmp;
         }
 
-        if (conn != nullptr) {
-            env->terminateConnection(conn);
-            conn = nullptr;
+        if (dictionaryProvider != nullptr) {
+            delete dictionaryProvider;
+            dictionaryProvider = nullptr;
+        }
+
+        if (formatterPool != nullptr) {
+            delete formatterPool;
+            formatterPool = nullptr;
         }
-        if (env != nullptr) {
-            Environment::terminateEnvironment(env);
-            env = nullptr;
+
+        for (uint64_t i = 0; i < xidTransactionMap.capacity; ++i) {
+            Transaction *transaction = xidTransactionMap.at(i);
+            if (transaction != nullptr) {
+                transactionBuffer->deleteTransactionChunks(transaction->firstTc, transaction->lastTc);
+                transactionBuffer->deleteTransaction(transaction);
+            }
         }
 
         delete transactionBuffer;
@@ -120,11 +146,28 @@ namespace OpenLogReplicator {
         }
         objectMap.clear();
 
-        for (auto it : xidTransactionMap) {
-            Transaction *transaction = it.second;
-            delete transaction;
+        if (dictObjn != nullptr) {
+            delete[] dictObjn;
+            dictObjn = nullptr;
+        }
+        if (dictObjects != nullptr) {
+            delete[] dictObjects;
+            dictObjects = nullptr;
         }
-        xidTransactionMap.clear();
+        if (dictFilter != nullptr) {
+            delete[] dictFilter;
+            dictFilter = nullptr;
+        }
+
+        for (auto it : retiredObjects)
+            delete it.second;
+        retiredObjects.clear();
+
+        for (auto it : schemaObjects) {
+            OracleObject *object = it.second;
+            delete object;
+        }
+        schemaObjects.clear();
 
         if (redoBuffer != nullptr) {
             delete[] redoBuffer;
@@ -142,29 +185,13 @@ namespace OpenLogReplicator {
         }
     }
 
-    void OracleReader::checkConnection(bool reconnect) {
-        while (!this->shutdown) {
-            if (conn == nullptr) {
-                cout << "- connecting to Oracle database " << database << endl;
-                try {
-                    conn = env->createConnection(user, passwd, connectString);
-                } catch(SQLException &ex) {
-                    cerr << "ERROR: " << dec << ex.getErrorCode() << ": " << ex.getMessage();
-                }
-            }
-
-            if (conn != nullptr || !reconnect)
-                break;
-
-            cerr << "ERROR: cannot connect to database, retry in 5 sec." << endl;
-            sleep(5);
-        }
-    }
-
     void *OracleReader::run(void) {
-        checkConnection(true);
+        validateSchema();
+        //output format is known only after targets are configured
+        for (auto it : objectMap)
+            commandBuffer->buildFragments(it.second);
         cout << "- Oracle Reader for: " << database << endl;
-        onlineLogGetList();
+        dictionaryProvider->onlineLogGetList();
         uint64_t ret = REDO_OK;
         OracleReaderRedo *redo = nullptr;
         bool logsProcessed;
@@ -203,7 +230,7 @@ namespace OpenLogReplicator {
                                 redo = redoTmp;
                         }
 
-                        if (redo == nullptr && !isHigher) {
+                        if (redo == nullptr && !isHigher && !onlineRedoSet.empty()) {
                             usleep(redoReadSleep);
                         } else
                             break;
@@ -245,7 +272,7 @@ namespace OpenLogReplicator {
                 break;
             if ((trace2 & TRACE2_REDO) != 0)
                 cerr << "REDO: checking archive redo logs" << endl;
-            archLogGetList();
+            dictionaryProvider->archLogGetList();
 
             while (!archiveRedoQueue.empty()) {
                 OracleReaderRedo *redoPrev = redo;
@@ -285,8 +312,15 @@ namespace OpenLogReplicator {
 
             if (this->shutdown)
                 break;
-            if (!logsProcessed)
+            if (!logsProcessed) {
+                //without database there are no new redo logs
+                if (dictionaryProvider->isOffline()) {
+                    cout << "- all redo logs processed for: " << database << endl;
+                    stopMain();
+                    break;
+                }
                 usleep(redoReadSleep);
+            }
         }
 
         writeCheckpoint(true);
@@ -295,88 +329,161 @@ namespace OpenLogReplicator {
         return 0;
     }
 
-    void OracleReader::archLogGetList() {
-        checkConnection(true);
-
-        try {
-            OracleStatement stmt(&conn, env);
-            stmt.createStatement("SELECT NAME, SEQUENCE#, FIRST_CHANGE#, FIRST_TIME, NEXT_CHANGE#, NEXT_TIME FROM SYS.V_$ARCHIVED_LOG WHERE SEQUENCE# >= :i AND RESETLOGS_ID = :i AND NAME IS NOT NULL ORDER BY SEQUENCE#, DEST_ID");
-            stmt.stmt->setInt(1, databaseSequence);
-            stmt.stmt->setInt(2, resetlogs);
-            stmt.executeQuery();
+    void OracleReader::refreshOnlineLogs() {
+        for (auto redoTmp: onlineRedoSet) {
+            redoTmp->reload();
+        }
+    }
 
-            string path;
-            typeseq sequence;
-            typescn firstScn, nextScn;
+    void OracleReader::buildDict() {
+        if (dictObjn != nullptr)
+            delete[] dictObjn;
+        if (dictObjects != nullptr)
+            delete[] dictObjects;
+        if (dictFilter != nullptr)
+            delete[] dictFilter;
+
+        dictSize = objectMap.size();
+        dictFilterBits = DICT_FILTER_BITS_MIN;
+        while (dictFilterBits < DICT_FILTER_BITS_MAX && ((uint64_t)1 << dictFilterBits) < dictSize * 32)
+            ++dictFilterBits;
+
+        dictObjn = new typeobj[dictSize + 1];
+        dictObjects = new OracleObject*[dictSize + 1];
+        dictFilter = new uint64_t[((uint64_t)1 << dictFilterBits) / 64];
+        if (dictObjn == nullptr || dictObjects == nullptr || dictFilter == nullptr) {
+            cerr << "ERROR: could not allocate memory for dictionary (" << dec << dictSize << " objects)" << endl;
+            throw MemoryException("out of memory");
+        }
+        memset(dictFilter, 0, ((uint64_t)1 << dictFilterBits) / 8);
 
-            while (stmt.rset->next()) {
-                path = stmt.rset->getString(1);
-                sequence = stmt.rset->getNumber(2);
-                firstScn = stmt.rset->getNumber(3);
-                nextScn = stmt.rset->getNumber(5);
+        uint64_t i = 0;
+        for (auto it : objectMap)
+            dictObjn[i++] = it.first;
+        sort(dictObjn, dictObjn + dictSize);
 
-                OracleReaderRedo* redo = new OracleReaderRedo(this, 0, path.c_str());
-                redo->firstScn = firstScn;
-                redo->nextScn = nextScn;
-                redo->sequence = sequence;
-                archiveRedoQueue.push(redo);
-            }
-        } catch(SQLException &ex) {
-            cerr << "ERROR: getting arch log list: " << dec << ex.getErrorCode() << ": " << ex.getMessage();
+        for (i = 0; i < dictSize; ++i) {
+            dictObjects[i] = objectMap[dictObjn[i]];
+            uint64_t bit = DICTHASHINGFUNCTION(dictObjn[i], dictFilterBits);
+            dictFilter[bit >> 6] |= (uint64_t)1 << (bit & 63);
         }
+
+        dictChanged = false;
     }
 
-    void OracleReader::onlineLogGetList() {
-        checkConnection(true);
+    OracleObject *OracleReader::checkDict(typeobj objn, typeobj objd) {
+        if (dictChanged)
+            buildDict();
+
+        //most of objects in redo are not tracked
+        uint64_t bit = DICTHASHINGFUNCTION(objn, dictFilterBits);
+        if ((dictFilter[bit >> 6] & ((uint64_t)1 << (bit & 63))) == 0)
+            return nullptr;
+
+        uint64_t left = 0, right = dictSize;
+        while (left < right) {
+            uint64_t middle = (left + right) >> 1;
+            if (dictObjn[middle] < objn)
+                left = middle + 1;
+            else
+                right = middle;
+        }
+
+        if (left < dictSize && dictObjn[left] == objn)
+            return dictObjects[left];
+        return nullptr;
+    }
 
-        int64_t groupLast = -1, group = -1, groupPrev = -1;
-        struct stat fileStat;
-        string path;
+    void OracleReader::addToDict(OracleObject *object) {
+        if (objectMap.find(object->objn) == objectMap.end()) {
+            commandBuffer->buildFragments(object);
+            objectMap[object->objn] = object;
+            dictChanged = true;
+        }
+    }
 
-        try {
-            OracleStatement stmt(&conn, env);
-            stmt.createStatement("SELECT LF.GROUP#, LF.MEMBER FROM SYS.V_$LOGFILE LF ORDER BY LF.GROUP# ASC, LF.IS_RECOVERY_DEST_FILE DESC, LF.MEMBER ASC");
-            stmt.executeQuery();
+    void OracleReader::removeFromDict(typeobj objn) {
+        auto it = objectMap.find(objn);
+        if (it != objectMap.end()) {
+            delete it->second;
+            objectMap.erase(it);
+            dictChanged = true;
+        }
+    }
 
-            while (stmt.rset->next()) {
-                groupPrev = group;
-                group = stmt.rset->getNumber(1);
-                path = stmt.rset->getString(2);
+    //dictionary changes of DDL are visible only after its commit, table is reloaded then
+    void OracleReader::alterDict(typeobj objn, typexid xid) {
+        alteredObjects[objn] = xid;
+    }
 
-                if (groupPrev != groupLast && group != groupPrev) {
-                    throw RedoLogException("can't read any member from group", nullptr, 0);
-                }
+    void OracleReader::commitDict(typexid xid, typescn scn, bool rollback) {
+        if (alteredObjects.size() == 0)
+            return;
 
-                if (group != groupLast && stat(path.c_str(), &fileStat) == 0) {
-                    cerr << "Found log GROUP: " << group << " PATH: " << path << endl;
-                    OracleReaderRedo* redo = new OracleReaderRedo(this, group, path.c_str());
-                    onlineRedoSet.insert(redo);
-                    groupLast = group;
-                }
-            }
-        } catch(SQLException &ex) {
-            throw RedoLogException("errog getting online log list", nullptr, 0);
+        for (auto it = alteredObjects.begin(); it != alteredObjects.end(); ) {
+            if (it->second == xid) {
+                if (!rollback)
+                    reloadDict(it->first, scn);
+                it = alteredObjects.erase(it);
+            } else
+                ++it;
         }
+    }
 
-        if (group != groupLast) {
-            throw RedoLogException("can't read any member from group", nullptr, 0);
+    //table definition is read as of the commit of DDL and swapped, old definition is still used by earlier changes
+    void OracleReader::reloadDict(typeobj objn, typescn scn) {
+        OracleObject *object = checkDict(objn, 0);
+        if (object == nullptr)
+            return;
+
+        OracleObject *newObject = dictionaryProvider->reloadObject(objn, object->options, scn);
+        if (newObject == nullptr) {
+            cerr << "WARNING: could not reload table schema for: " << object->owner << "." << object->objectName << " (OBJN: " << dec << objn <<
+                    "), further changes are ignored" << endl;
+            object->altered = true;
+            return;
         }
-    }
 
-    void OracleReader::refreshOnlineLogs() {
-        for (auto redoTmp: onlineRedoSet) {
-            redoTmp->reload();
+        cout << "- reloaded table schema for: " << newObject->owner << "." << newObject->objectName << " (OBJN: " << dec << objn <<
+                ", SCN: " << PRINTSCN64(scn) << ")" << endl;
+        if (!newObject->setProjection(object->includeColumns, object->excludeColumns))
+            cerr << "WARNING: column projection for " << newObject->owner << "." << newObject->objectName << " does not match changed table schema" << endl;
+        if (object->filter != nullptr) {
+            RowFilter *filter = new RowFilter(this, object->filter->expression);
+            if (filter->compile(newObject))
+                newObject->filter = filter;
+            else {
+                cerr << "WARNING: filter for " << newObject->owner << "." << newObject->objectName << " does not match changed table schema, all rows are replicated" << endl;
+                delete filter;
+            }
         }
+        commandBuffer->buildFragments(newObject);
+        retiredObjects.insert(pair<typescn, OracleObject*>(scn, object));
+        objectMap[objn] = newObject;
+        dictChanged = true;
+        schemaChanged = true;
     }
 
-    OracleObject *OracleReader::checkDict(typeobj objn, typeobj objd) {
-        OracleObject *object = objectMap[objn];
-        return object;
-    }
+    //old definition is freed when checkpoint passed the DDL commit and no transaction started before it is buffered or formatted
+    void OracleReader::freeRetiredObjects(void) {
+        if (retiredObjects.size() == 0 || retiredObjects.begin()->first > databaseScn)
+            return;
 
-    void OracleReader::addToDict(OracleObject *object) {
-        if (objectMap[object->objn] == nullptr) {
-            objectMap[object->objn] = object;
+        typescn minScn = ZERO_SCN;
+        for (uint64_t i = 0; i < transactionHeap.size(); ++i) {
+            Transaction *transaction = transactionHeap.at(i);
+            if (transaction->firstScn < minScn)
+                minScn = transaction->firstScn;
+        }
+
+        bool drained = false;
+        for (auto it = retiredObjects.begin(); it != retiredObjects.end() && it->first <= databaseScn && it->first < minScn; ) {
+            if (!drained && formatterPool != nullptr) {
+                formatterPool->drain();
+                drained = true;
+            }
+            delete it->second;
+            it = retiredObjects.erase(it);
         }
     }
 
@@ -589,187 +696,299 @@ namespace OpenLogReplicator {
     }
 
 
+    void OracleReader::setBigEndian() {
+        bigEndian = true;
+        read16 = read16Big;
+        read32 = read32Big;
+        read56 = read56Big;
+        read64 = read64Big;
+        readSCN = readSCNBig;
+        readSCNr = readSCNrBig;
+        write16 = write16Big;
+        write32 = write32Big;
+        write56 = write56Big;
+        write64 = write64Big;
+        writeSCN = writeSCNBig;
+    }
+
     uint64_t OracleReader::initialize() {
-        checkConnection(false);
-        if (conn == nullptr)
+        if (!dictionaryProvider->initialize())
             return 0;
 
-        typescn currentDatabaseScn;
-        typeresetlogs currentResetlogs;
-
-        try {
-            OracleStatement stmt(&conn, env);
-            //check archivelog mode, supplemental log min, endian
-            stmt.createStatement("SELECT D.LOG_MODE, D.SUPPLEMENTAL_LOG_DATA_MIN, TP.ENDIAN_FORMAT, D.CURRENT_SCN, DI.RESETLOGS_ID, VER.BANNER, SYS_CONTEXT('USERENV','DB_NAME') AS DB_NAME FROM SYS.V_$DATABASE D JOIN SYS.V_$TRANSPORTABLE_PLATFORM TP ON TP.PLATFORM_NAME = D.PLATFORM_NAME JOIN SYS.V_$VERSION VER ON VER.BANNER LIKE '%Oracle Database%' JOIN SYS.V_$DATABASE_INCARNATION DI ON DI.STATUS = 'CURRENT'");
-            stmt.executeQuery();
-
-            if (stmt.rset->next()) {
-                string LOG_MODE = stmt.rset->getString(1);
-                if (LOG_MODE.compare("ARCHIVELOG") != 0) {
-                    cerr << "ERROR: database not in ARCHIVELOG mode. RUN: " << endl;
-                    cerr << " SHUTDOWN IMMEDIATE;" << endl;
-                    cerr << " STARTUP MOUNT;" << endl;
-                    cerr << " ALTER DATABASE ARCHIVELOG;" << endl;
-                    cerr << " ALTER DATABASE OPEN;" << endl;
-                    return 0;
-                }
+        cout << "- sequence: " << dec << databaseSequence << endl;
+        cout << "- scn: " << dec << databaseScn << endl;
+        cout << "- resetlogs: " << dec << resetlogs << endl;
 
-                string SUPPLEMENTAL_LOG_MIN = stmt.rset->getString(2);
-                if (SUPPLEMENTAL_LOG_MIN.compare("YES") != 0) {
-                    cerr << "Error: SUPPLEMENTAL_LOG_DATA_MIN missing: RUN:" << endl;
-                    cerr << " ALTER DATABASE ADD SUPPLEMENTAL LOG DATA;" << endl;
-                    cerr << " ALTER SYSTEM ARCHIVE LOG CURRENT;" << endl;
-                    return 0;
-                }
+        if (databaseSequence == 0 || databaseScn == 0)
+            return 0;
 
-                string ENDIANNESS = stmt.rset->getString(3);
-                if (ENDIANNESS.compare("Big") == 0) {
-                    bigEndian = true;
-                    read16 = read16Big;
-                    read32 = read32Big;
-                    read56 = read56Big;
-                    read64 = read64Big;
-                    readSCN = readSCNBig;
-                    readSCNr = readSCNrBig;
-                    write16 = write16Big;
-                    write32 = write32Big;
-                    write56 = write56Big;
-                    write64 = write64Big;
-                    writeSCN = writeSCNBig;
-                }
+        if (dictionaryProvider->schemaCache)
+            readSchema();
+        return 1;
+    }
 
-                currentDatabaseScn = stmt.rset->getNumber(4);
-                currentResetlogs = stmt.rset->getNumber(5);
-                if (resetlogs != 0 && currentResetlogs != resetlogs) {
-                    cerr << "Error: Incorrect database incarnation. Previous resetlogs:" << dec << resetlogs << ", current: " << currentResetlogs << endl;
-                    return 0;
-                } else {
-                    resetlogs = currentResetlogs;
+    bool OracleReader::applyProjection(OracleTableMask &tableMask) {
+        if (tableMask.includeColumns.size() == 0 && tableMask.excludeColumns.size() == 0 && tableMask.filter.length() == 0)
+            return true;
+
+        bool ok = true;
+        for (auto objn : tableMask.objects) {
+            OracleObject *object = checkDict(objn, 0);
+            if (object == nullptr)
+                continue;
+
+            if (!object->setProjection(tableMask.includeColumns, tableMask.excludeColumns))
+                ok = false;
+            if (tableMask.filter.length() > 0) {
+                RowFilter *filter = new RowFilter(this, tableMask.filter);
+                if (!filter->compile(object)) {
+                    delete filter;
+                    ok = false;
+                    continue;
                 }
+                if (object->filter != nullptr)
+                    delete object->filter;
+                object->filter = filter;
+            }
+        }
+        return ok;
+    }
 
-                //12+
-                string VERSION = stmt.rset->getString(6);
-                cout << "- version: " << dec << VERSION << endl;
-
-                conId = 0;
-                if (VERSION.find("Oracle Database 11g") == string::npos) {
-                    OracleStatement stmt(&conn, env);
-                    stmt.createStatement("select sys_context('USERENV','CON_ID') CON_ID from DUAL");
-                    stmt.executeQuery();
+    bool OracleReader::addTable(string mask, uint64_t options, const vector<string> &includeColumns, const vector<string> &excludeColumns, const string &filter) {
+        //schema cache from previous run
+        auto it = schemaMasks.find(mask);
+        if (it != schemaMasks.end() && it->second.options == options) {
+            OracleTableMask &tableMask = it->second;
+            for (auto objn : tableMask.objects) {
+                OracleObject *object = schemaObjects[objn];
+                schemaObjects.erase(objn);
+                if (object != nullptr)
+                    addToDict(object);
+            }
+            cout << "- reading table schema for: " << mask << " (cached, total: " << dec << tableMask.objects.size() << ")" << endl;
+            tableMask.includeColumns = includeColumns;
+            tableMask.excludeColumns = excludeColumns;
+            tableMask.filter = filter;
+            if (!applyProjection(tableMask))
+                return false;
+            tableMasks.push_back(tableMask);
+            schemaMasks.erase(it);
+            return true;
+        }
 
-                    if (stmt.rset->next()) {
-                        conId = stmt.rset->getNumber(1);
-                        cout << "- conId: " << dec << conId << endl;
-                    }
-                }
+        cout << "- reading table schema for: " << mask;
+        OracleTableMask tableMask;
+        tableMask.mask = mask;
+        tableMask.options = options;
+        tableMask.cached = false;
+        tableMask.includeColumns = includeColumns;
+        tableMask.excludeColumns = excludeColumns;
+        tableMask.filter = filter;
+
+        dictionaryProvider->readTables(tableMask);
+        cout << " (total: " << dec << tableMask.objects.size() << ")" << endl;
+        if (!applyProjection(tableMask))
+            return false;
+        tableMasks.push_back(tableMask);
+        schemaChanged = true;
+        return true;
+    }
 
-                databaseContext = stmt.rset->getString(7);
+    //schema of tables is kept in binary file between runs, only tables with changed DDL time are read again
+    void OracleReader::readSchema() {
+        ifstream infile;
+        infile.open((database + ".schema").c_str(), ios::in | ios::binary);
+        if (!infile.is_open())
+            return;
 
-            } else {
-                cerr << "ERROR: reading SYS.V_$DATABASE" << endl;
-                return 0;
-            }
-        } catch(SQLException &ex) {
-            cerr << "ERROR: " << dec << ex.getErrorCode() << ": " << ex.getMessage();
-            return 0;
+        uint64_t magic = 0, schemaVersion = 0, schemaResetlogs = 0, masks = 0;
+        string schemaDatabase;
+        if (!readSchemaInt(infile, magic) || magic != SCHEMA_MAGIC ||
+                !readSchemaInt(infile, schemaVersion) || schemaVersion != SCHEMA_VERSION ||
+                !readSchemaString(infile, schemaDatabase) || database.compare(schemaDatabase) != 0 ||
+                !readSchemaInt(infile, schemaResetlogs) || schemaResetlogs != resetlogs ||
+                !readSchemaInt(infile, masks)) {
+            cerr << "WARNING: schema cache " << database << ".schema is not valid for this database, ignoring" << endl;
+            infile.close();
+            return;
         }
 
-        if (databaseSequence == 0 || databaseScn == 0) {
-            try {
-                OracleStatement stmt(&conn, env);
-                stmt.createStatement("select SEQUENCE# from SYS.V_$LOG where status = 'CURRENT'");
-                stmt.executeQuery();
+        bool ok = true;
+        for (uint64_t i = 0; i < masks && ok; ++i) {
+            OracleTableMask tableMask;
+            uint64_t objects = 0;
+            tableMask.cached = true;
+            ok = readSchemaString(infile, tableMask.mask) && readSchemaInt(infile, tableMask.options) && readSchemaInt(infile, objects);
+
+            for (uint64_t j = 0; j < objects && ok; ++j) {
+                uint64_t objn = 0, objd = 0, depdendencies = 0, cluCols = 0, totalPk = 0, ddlTime = 0, columns = 0;
+                string owner, objectName;
+                ok = readSchemaInt(infile, objn) && readSchemaInt(infile, objd) && readSchemaInt(infile, depdendencies) &&
+                        readSchemaInt(infile, cluCols) && readSchemaInt(infile, totalPk) && readSchemaInt(infile, ddlTime) &&
+                        readSchemaString(infile, owner) && readSchemaString(infile, objectName) && readSchemaInt(infile, columns);
+                if (!ok)
+                    break;
 
-                if (stmt.rset->next()) {
-                    databaseSequence = stmt.rset->getNumber(1);
-                    databaseScn = currentDatabaseScn;
+                tableMask.objects.push_back(objn);
+                //table matched by more masks is stored once
+                if (columns == 0 && schemaObjects[objn] != nullptr)
+                    continue;
+
+                OracleObject *object = new OracleObject(objn, objd, depdendencies, cluCols, tableMask.options, owner, objectName);
+                object->totalPk = totalPk;
+                object->ddlTime = ddlTime;
+                for (uint64_t k = 0; k < columns && ok; ++k) {
+                    uint64_t colNo = 0, segColNo = 0, typeNo = 0, length = 0, precision = 0, scale = 0, numPk = 0, nullable = 0;
+                    string columnName;
+                    ok = readSchemaInt(infile, colNo) && readSchemaInt(infile, segColNo) && readSchemaString(infile, columnName) &&
+                            readSchemaInt(infile, typeNo) && readSchemaInt(infile, length) && readSchemaInt(infile, precision) &&
+                            readSchemaInt(infile, scale) && readSchemaInt(infile, numPk) && readSchemaInt(infile, nullable);
+                    if (ok)
+                        object->addColumn(new OracleColumn(colNo, segColNo, columnName, typeNo, length, (int64_t)precision, (int64_t)scale,
+                                numPk, nullable != 0));
                 }
-            } catch(SQLException &ex) {
-                cerr << "ERROR: " << dec << ex.getErrorCode() << ": " << ex.getMessage();
+                object->totalCols = object->columns.size();
+
+                if (schemaObjects[objn] != nullptr)
+                    delete schemaObjects[objn];
+                schemaObjects[objn] = object;
             }
+            schemaMasks[tableMask.mask] = tableMask;
         }
+        infile.close();
 
-        cout << "- sequence: " << dec << databaseSequence << endl;
-        cout << "- scn: " << dec << databaseScn << endl;
-        cout << "- resetlogs: " << dec << resetlogs << endl;
+        if (!ok) {
+            cerr << "WARNING: schema cache " << database << ".schema is damaged, ignoring" << endl;
+            for (auto it : schemaObjects)
+                delete it.second;
+            schemaObjects.clear();
+            schemaMasks.clear();
+        }
+    }
 
-        if (databaseSequence == 0 || databaseScn == 0)
-            return 0;
-        else
-            return 1;
+    //objects loaded from cache are compared by DDL time, read before any redo is processed
+    void OracleReader::validateSchema() {
+        for (auto it : schemaObjects)
+            delete it.second;
+        schemaObjects.clear();
+        if (schemaMasks.size() > 0) {
+            schemaMasks.clear();
+            schemaChanged = true;
+        }
+
+        for (auto &tableMask : tableMasks) {
+            if (tableMask.cached && dictionaryProvider->validateTables(tableMask)) {
+                if (!applyProjection(tableMask))
+                    cerr << "WARNING: column projection or filter for " << tableMask.mask << " does not match changed table schema" << endl;
+                schemaChanged = true;
+            }
+        }
+
+        if (schemaChanged && dictionaryProvider->schemaCache)
+            writeSchema();
     }
 
-    void OracleReader::addTable(string mask, uint64_t options) {
-        checkConnection(false);
-        cout << "- reading table schema for: " << mask;
-        uint64_t tabCnt = 0;
-
-        try {
-            OracleStatement stmt(&conn, env);
-            OracleStatement stmt2(&conn, env);
-            stmt.createStatement(
-                    "SELECT tab.DATAOBJ# as objd, tab.OBJ# as objn, tab.CLUCOLS as clucols, usr.USERNAME AS owner, obj.NAME AS objectName, decode(bitand(tab.FLAGS, 8388608), 8388608, 1, 0) as dependencies "
-                    "FROM SYS.TAB$ tab, SYS.OBJ$ obj, ALL_USERS usr "
-                    "WHERE tab.OBJ# = obj.OBJ# "
-                    "AND obj.OWNER# = usr.USER_ID "
-                    "AND usr.USERNAME || '.' || obj.NAME LIKE :i");
-            stmt.stmt->setString(1, mask);
-
-            stmt.executeQuery();
-            while (stmt.rset->next()) {
-                //skip partitioned/IOT tables
-                string owner = stmt.rset->getString(4);
-                string objectName = stmt.rset->getString(5);
-                typeobj objn = stmt.rset->getNumber(2);
-                if (stmt.rset->isNull(1)) {
-                    cout << endl << "  * skipped: " << owner << "." << objectName << " (OBJN: " << dec << objn << ") - partitioned or IOT";
-                } else {
-                    typeobj objd = stmt.rset->getNumber(1);
-                    uint64_t cluCols = 0;
-                    if (!stmt.rset->isNull(3))
-                        stmt.rset->getNumber(3);
-                    uint64_t depdendencies = stmt.rset->getNumber(6);
-                    uint64_t totalPk = 0, totalCols = 0;
-                    OracleObject *object = new OracleObject(objn, objd, depdendencies, cluCols, options, owner, objectName);
-                    ++tabCnt;
-
-                    cout << endl << "  * found: " << owner << "." << objectName << " (OBJD: " << dec << objd << ", OBJN: " << dec << objn << ", DEP: " << dec << depdendencies << ")";
-
-                    stmt2.createStatement("SELECT C.COL#, C.SEGCOL#, C.NAME, C.TYPE#, C.LENGTH, C.PRECISION#, C.SCALE, C.NULL$, (SELECT COUNT(*) FROM SYS.CCOL$ L JOIN SYS.CDEF$ D on D.con# = L.con# AND D.type# = 2 WHERE L.intcol# = C.intcol# and L.obj# = C.obj#) AS NUMPK FROM SYS.COL$ C WHERE C.OBJ# = :i ORDER BY C.SEGCOL#");
-                    stmt2.stmt->setInt(1, objn);
-                    stmt2.executeQuery();
-
-                    while (stmt2.rset->next()) {
-                        uint64_t colNo = stmt2.rset->getNumber(1);
-                        uint64_t segColNo = stmt2.rset->getNumber(2);
-                        string columnName = stmt2.rset->getString(3);
-                        uint64_t typeNo = stmt2.rset->getNumber(4);
-                        uint64_t length = stmt2.rset->getNumber(5);
-                        int64_t precision = -1;
-                        if (!stmt2.rset->isNull(6))
-                            precision = stmt2.rset->getNumber(6);
-                        int64_t scale = -1;
-                        if (!stmt2.rset->isNull(7))
-                            scale = stmt2.rset->getNumber(7);
-
-                        int64_t nullable = stmt2.rset->getNumber(8);
-                        uint64_t numPk = stmt2.rset->getNumber(9);
-                        OracleColumn *column = new OracleColumn(colNo, segColNo, columnName, typeNo, length, precision, scale, numPk, (nullable == 0));
-                        totalPk += numPk;
-                        ++totalCols;
-
-                        object->addColumn(column);
-                    }
+    void OracleReader::writeSchema() {
+        ofstream outfile;
+        outfile.open((database + ".schema.tmp").c_str(), ios::out | ios::trunc | ios::binary);
 
-                    object->totalCols = totalCols;
-                    object->totalPk = totalPk;
-                    addToDict(object);
+        if (!outfile.is_open()) {
+            cerr << "ERROR: writing schema cache for " << database << endl;
+            return;
+        }
+
+        writeSchemaInt(outfile, SCHEMA_MAGIC);
+        writeSchemaInt(outfile, SCHEMA_VERSION);
+        writeSchemaString(outfile, database);
+        writeSchemaInt(outfile, resetlogs);
+        writeSchemaInt(outfile, tableMasks.size());
+
+        unordered_map<typeobj, bool> written;
+        for (auto &tableMask : tableMasks) {
+            writeSchemaString(outfile, tableMask.mask);
+            writeSchemaInt(outfile, tableMask.options);
+            writeSchemaInt(outfile, tableMask.objects.size());
+
+            for (auto objn : tableMask.objects) {
+                auto it = objectMap.find(objn);
+                OracleObject *object = (it != objectMap.end()) ? it->second : nullptr;
+                if (object == nullptr) {
+                    //should not happen, write empty definition
+                    writeSchemaInt(outfile, objn);
+                    for (uint64_t i = 0; i < 6; ++i)
+                        writeSchemaInt(outfile, 0);
+                    writeSchemaString(outfile, "");
+                    writeSchemaString(outfile, "");
+                    writeSchemaInt(outfile, 0);
+                    continue;
+                }
+
+                writeSchemaInt(outfile, object->objn);
+                writeSchemaInt(outfile, object->objd);
+                writeSchemaInt(outfile, object->depdendencies);
+                writeSchemaInt(outfile, object->cluCols);
+                writeSchemaInt(outfile, object->totalPk);
+                writeSchemaInt(outfile, object->ddlTime);
+                writeSchemaString(outfile, object->owner);
+                writeSchemaString(outfile, object->objectName);
+
+                if (written[objn]) {
+                    writeSchemaInt(outfile, 0);
+                    continue;
+                }
+                written[objn] = true;
+
+                writeSchemaInt(outfile, object->columns.size());
+                for (auto column : object->columns) {
+                    writeSchemaInt(outfile, column->colNo);
+                    writeSchemaInt(outfile, column->segColNo);
+                    writeSchemaString(outfile, column->columnName);
+                    writeSchemaInt(outfile, column->typeNo);
+                    writeSchemaInt(outfile, column->length);
+                    writeSchemaInt(outfile, (uint64_t)column->precision);
+                    writeSchemaInt(outfile, (uint64_t)column->scale);
+                    writeSchemaInt(outfile, column->numPk);
+                    writeSchemaInt(outfile, column->nullable ? 1 : 0);
                 }
             }
-        } catch(SQLException &ex) {
-            cerr << "ERROR: getting table metadata: " << dec << ex.getErrorCode() << ": " << ex.getMessage();
         }
-        cout << " (total: " << dec << tabCnt << ")" << endl;
+
+        bool ok = outfile.good();
+        outfile.close();
+        if (!ok || rename((database + ".schema.tmp").c_str(), (database + ".schema").c_str()) != 0) {
+            cerr << "ERROR: writing schema cache for " << database << endl;
+            return;
+        }
+        schemaChanged = false;
+    }
+
+    bool OracleReader::readSchemaInt(ifstream &infile, uint64_t &val) {
+        uint8_t buf[8];
+        if (!infile.read((char*)buf, 8))
+            return false;
+        val = read64Little(buf);
+        return true;
+    }
+
+    bool OracleReader::readSchemaString(ifstream &infile, string &str) {
+        uint64_t length;
+        if (!readSchemaInt(infile, length) || length > REDO_RECORD_MAX_SIZE)
+            return false;
+        str.resize(length);
+        if (length > 0 && !infile.read(&str[0], length))
+            return false;
+        return true;
+    }
+
+    void OracleReader::writeSchemaInt(ofstream &outfile, uint64_t val) {
+        uint8_t buf[8];
+        write64Little(buf, val);
+        outfile.write((char*)buf, 8);
+    }
+
+    void OracleReader::writeSchemaString(ofstream &outfile, const string &str) {
+        writeSchemaInt(outfile, str.length());
+        outfile.write(str.c_str(), str.length());
     }
 
     void OracleReader::readCheckpoint() {
@@ -800,16 +1019,41 @@ namespace OpenLogReplicator {
         infile.close();
     }
 
+    //every shard buffer has own writer, all are filled by own formatter thread
+    void OracleReader::setShards(uint64_t shards, CommandBuffer **shardBuffers) {
+        if (formatterPool != nullptr) {
+            cerr << "WARNING: formatter-threads parameter is ignored for sharded output" << endl;
+            delete formatterPool;
+        }
+        if (streamTransactionSize > 0) {
+            cerr << "WARNING: stream-transaction-mb parameter is ignored for sharded output" << endl;
+            streamTransactionSize = 0;
+        }
+
+        formatterPool = new FormatterPool(this, shards, 0, shardBuffers);
+    }
+
     void OracleReader::writeCheckpoint(bool atShutdown) {
         clock_t now = clock();
         typeseq minSequence = 0xFFFFFFFF;
         Transaction *transaction;
 
-        for (uint64_t i = 1; i <= transactionHeap.heapSize; ++i) {
-            transaction = transactionHeap.heap[i];
+        //committed transactions which are still being formatted are not in the heap anymore
+        if (formatterPool != nullptr)
+            formatterPool->drain();
+
+        for (uint64_t i = 0; i < transactionHeap.size(); ++i) {
+            transaction = transactionHeap.at(i);
             if (minSequence > transaction->firstSequence)
                 minSequence = transaction->firstSequence;
         }
+        if (xidTransactionMap.markers > 0) {
+            for (uint64_t i = 0; i < xidTransactionMap.capacity; ++i) {
+                TransactionXidEntry *entry = xidTransactionMap.entryAt(i);
+                if (entry->used && entry->transaction == nullptr && minSequence > entry->beginSequence)
+                    minSequence = entry->beginSequence;
+            }
+        }
         if (minSequence == 0xFFFFFFFF)
             minSequence = databaseSequence;
 
@@ -870,11 +1114,12 @@ namespace OpenLogReplicator {
 
     void OracleReader::dumpTransactions() {
         if (trace >= TRACE_INFO) {
-            cerr << "INFO: free buffers: " << dec << transactionBuffer->freeBuffers << "/" << transactionBuffer->redoBuffers << endl;
-            if (transactionHeap.heapSize > 0)
-                cerr << "INFO: Transactions open: " << dec << transactionHeap.heapSize << endl;
-            for (uint64_t i = 1; i <= transactionHeap.heapSize; ++i)
-                cerr << "INFO: transaction[" << i << "]: " << *transactionHeap.heap[i] << endl;
+            cerr << "INFO: free buffers: " << dec << transactionBuffer->freeBuffers << "/" << transactionBuffer->redoBuffers <<
+                    ", used: " << dec << transactionBuffer->usedSize << " bytes" << endl;
+            if (transactionHeap.size() > 0)
+                cerr << "INFO: Transactions open: " << dec << transactionHeap.openSize << ", committed: " << dec << transactionHeap.heapSize << endl;
+            for (uint64_t i = 0; i < transactionHeap.size(); ++i)
+                cerr << "INFO: transaction[" << i << "]: " << *transactionHeap.at(i) << endl;
         }
     }
 
@@ -17,18 +17,20 @@ You should have received a copy of the GNU General Public License
 along with Open Log Replicator; see the file LICENSE.txt  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <map>
 #include <set>
+#include <vector>
 #include <queue>
 #include <unordered_map>
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <stdint.h>
-#include <occi.h>
 
 #include "CommandBuffer.h"
 #include "types.h"
 #include "TransactionMap.h"
+#include "TransactionXidMap.h"
 #include "TransactionHeap.h"
 #include "TransactionBuffer.h"
 #include "Thread.h"
@@ -36,12 +38,17 @@ along with Open Log Replicator; see the file LICENSE.txt  If not see
 #ifndef ORACLEREADER_H_
 #define ORACLEREADER_H_
 
+#define DICT_FILTER_BITS_MIN        12
+#define DICT_FILTER_BITS_MAX        24
+#define DICTHASHINGFUNCTION(objn,bits) ((((uint64_t)(objn))*0x9E3779B97F4A7C15ULL)>>(64-(bits)))
+
 using namespace std;
-using namespace oracle::occi;
 
 namespace OpenLogReplicator {
 
     class CommandBuffer;
+    class DictionaryProvider;
+    class FormatterPool;
     class OracleObject;
     class OracleReaderRedo;
     class Transaction;
@@ -54,35 +61,63 @@ namespace OpenLogReplicator {
         bool operator()(OracleReaderRedo* const& p1, OracleReaderRedo* const& p2);
     };
 
+    //tables matched by one mask from the configuration
+    struct OracleTableMask {
+        string mask;
+        uint64_t options;
+        bool cached;
+        vector<typeobj> objects;
+        vector<string> includeColumns;
+        vector<string> excludeColumns;
+        string filter;
+    };
+
     class OracleReader : public Thread {
     protected:
         OracleReaderRedo* currentRedo;
-        typeseq databaseSequence;
         typeseq databaseSequenceArchMax;
-        Environment *env;
-        Connection *conn;
-        string user;
-        string passwd;
-        string connectString;
-
-        priority_queue<OracleReaderRedo*, vector<OracleReaderRedo*>, OracleReaderRedoCompare> archiveRedoQueue;
-        set<OracleReaderRedo*> onlineRedoSet;
         set<OracleReaderRedo*> archiveRedoSet;
 
-        void checkConnection(bool reconnect);
-        void archLogGetList();
-        void onlineLogGetList();
+        vector<OracleTableMask> tableMasks;
+        unordered_map<string, OracleTableMask> schemaMasks;
+        unordered_map<typeobj, OracleObject*> schemaObjects;
+        bool schemaChanged;
+
+        //tracked objects sorted by objn and hash bitmap to skip untracked ones, rebuilt when dictionary changes
+        typeobj *dictObjn;
+        OracleObject **dictObjects;
+        uint64_t dictSize;
+        uint64_t *dictFilter;
+        uint64_t dictFilterBits;
+        bool dictChanged;
+        multimap<typescn, OracleObject*> retiredObjects;   //replaced by DDL committed at SCN, referenced by earlier changes
+        unordered_map<typeobj, typexid> alteredObjects;    //changed by uncommitted DDL, reloaded at its commit
+
+        void buildDict();
+        bool applyProjection(OracleTableMask &tableMask);
+        void readSchema();
+        void validateSchema();
+        void writeSchema();
+        bool readSchemaInt(ifstream &infile, uint64_t &val);
+        bool readSchemaString(ifstream &infile, string &str);
+        void writeSchemaInt(ofstream &outfile, uint64_t val);
+        void writeSchemaString(ofstream &outfile, const string &str);
         void refreshOnlineLogs();
 
     public:
+        DictionaryProvider *dictionaryProvider;
+        typeseq databaseSequence;
+        priority_queue<OracleReaderRedo*, vector<OracleReaderRedo*>, OracleReaderRedoCompare> archiveRedoQueue;
+        set<OracleReaderRedo*> onlineRedoSet;
         string database;
         string databaseContext;
         typescn databaseScn;
         unordered_map<typeobj, OracleObject*> objectMap;
-        unordered_map<typexid, Transaction*> xidTransactionMap;
+        TransactionXidMap xidTransactionMap;
         TransactionMap lastOpTransactionMap;
         TransactionHeap transactionHeap;
         TransactionBuffer *transactionBuffer;
+        FormatterPool *formatterPool;
         uint8_t *redoBuffer;
         uint8_t *headerBuffer;
         uint8_t *recordBuffer;
@@ -99,6 +134,9 @@ namespace OpenLogReplicator {
         typeresetlogs resetlogs;
         clock_t previousCheckpoint;
         uint64_t checkpointInterval;
+        uint64_t streamTransactionSize;
+        uint64_t streamTransactionRows;
+        uint64_t lowLatency;
         bool bigEndian;
 
         uint16_t (*read16)(const uint8_t* buf);
@@ -139,19 +177,28 @@ namespace OpenLogReplicator {
 
         OracleObject *checkDict(typeobj objn, typeobj objd);
         void addToDict(OracleObject *object);
+        void removeFromDict(typeobj objn);
+        void alterDict(typeobj objn, typexid xid);
+        void commitDict(typexid xid, typescn scn, bool rollback);
+        void reloadDict(typeobj objn, typescn scn);
+        void freeRetiredObjects(void);
+        void setBigEndian();
         void transactionNew(typexid xid);
         void transactionAppend(typexid xid);
         virtual void *run();
-        void addTable(string mask, uint64_t options);
+        bool addTable(string mask, uint64_t options, const vector<string> &includeColumns, const vector<string> &excludeColumns, const string &filter);
         void readCheckpoint();
+        void setShards(uint64_t shards, CommandBuffer **shardBuffers);
         void writeCheckpoint(bool atShutdown);
         void checkForCheckpoint();
         uint64_t initialize();
         void dumpTransactions();
 
-        OracleReader(CommandBuffer *commandBuffer, const string alias, const string database, const string user, const string passwd,
-                const string connectString, uint64_t trace, uint64_t trace2, uint64_t dumpRedoLog, uint64_t dumpData, uint64_t directRead,
-                uint64_t redoReadSleep, uint64_t checkpointInterval, uint64_t redoBuffers, uint64_t redoBufferSize, uint64_t maxConcurrentTransactions);
+        OracleReader(CommandBuffer *commandBuffer, const string alias, const string database, DictionaryProvider *dictionaryProvider,
+                uint64_t trace, uint64_t trace2, uint64_t dumpRedoLog, uint64_t dumpData, uint64_t directRead, uint64_t redoReadSleep,
+                uint64_t checkpointInterval, uint64_t redoBuffers, uint64_t redoBufferSize, uint64_t maxConcurrentTransactions,
+                uint64_t streamTransactionSize, uint64_t streamTransactionRows, uint64_t formatterThreads, uint64_t formatterBufferSize,
+                uint64_t lowLatency);
         virtual ~OracleReader();
     };
 }
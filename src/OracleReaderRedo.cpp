@@ -31,6 +31,7 @@ along with Open Log Replicator; see the file LICENSE.txt  If not see
 #include <fcntl.h>
 #include <unistd.h>
 #include <signal.h>
+#include "FormatterPool.h"
 #include "OracleReader.h"
 #include "OracleReaderRedo.h"
 #include "OracleObject.h"
@@ -73,6 +74,7 @@ namespace OpenLogReplicator {
             fileDes(0),
             lastCheckpointScn(0),
             extScn(0),
+            extScnBlock(0),
             curScn(ZERO_SCN),
             curScnPrev(0),
             curSubScn(0),
@@ -84,6 +86,7 @@ namespace OpenLogReplicator {
             redoBufferPos(0),
             redoBufferFileStart(0),
             redoBufferFileEnd(0),
+            recordTransactionsCnt(0),
             path(path),
             firstScn(ZERO_SCN),
             nextScn(ZERO_SCN),
@@ -546,6 +549,7 @@ namespace OpenLogReplicator {
             recordTimestmap = oracleReader->read32(oracleReader->recordBuffer + 64);
             if (numChk + 1 == numChkMax) {
                 extScn = oracleReader->readSCN(oracleReader->recordBuffer + 40);
+                extScnBlock = recordBeginBlock + oracleReader->read32(oracleReader->recordBuffer + 28);
             }
             if (oracleReader->trace >= TRACE_FULL) {
                 if (oracleReader->version < 0x12200)
@@ -815,6 +819,57 @@ namespace OpenLogReplicator {
             if (redoLogRecord[i].opCode == 0x0504) {
             }
         }
+
+        closeRecordTransactions();
+    }
+
+    Transaction* OracleReaderRedo::findTransaction(typexid xid) {
+        for (uint64_t i = 0; i < recordTransactionsCnt; ++i)
+            if (recordTransactions[i]->xid == xid)
+                return recordTransactions[i];
+
+        return oracleReader->xidTransactionMap.get(xid);
+    }
+
+    //transactions modified by current redo record are taken out of last operation map until the record is processed
+    Transaction* OracleReaderRedo::getRecordTransaction(typexid xid) {
+        for (uint64_t i = 0; i < recordTransactionsCnt; ++i)
+            if (recordTransactions[i]->xid == xid)
+                return recordTransactions[i];
+
+        Transaction *transaction;
+        TransactionXidEntry *entry = oracleReader->xidTransactionMap.find(xid);
+        if (entry == nullptr || entry->transaction == nullptr) {
+            transaction = oracleReader->transactionBuffer->newTransaction(oracleReader, xid);
+            //first tracked change of transaction which begin was already seen
+            if (entry != nullptr) {
+                transaction->touch(entry->beginScn, entry->beginSequence);
+                transaction->isBegin = true;
+            }
+            oracleReader->xidTransactionMap.set(xid, transaction);
+            oracleReader->transactionHeap.add(transaction);
+        } else {
+            transaction = entry->transaction;
+            if (transaction->opCodes > 0)
+                oracleReader->lastOpTransactionMap.erase(transaction);
+        }
+
+        recordTransactions[recordTransactionsCnt++] = transaction;
+        return transaction;
+    }
+
+    void OracleReaderRedo::closeRecordTransactions() {
+        for (uint64_t i = 0; i < recordTransactionsCnt; ++i) {
+            Transaction *transaction = recordTransactions[i];
+            if ((oracleReader->trace2 & TRACE2_ROLLBACK) != 0) {
+                cerr << "redo, now last: UBA: " << PRINTUBA(transaction->lastUba) <<
+                        " DBA: 0x" << hex << transaction->lastDba <<
+                        " SLT: " << dec << (uint64_t)transaction->lastSlt <<
+                        " RCI: " << dec << (uint64_t)transaction->lastRci << endl;
+            }
+            oracleReader->lastOpTransactionMap.set(transaction);
+        }
+        recordTransactionsCnt = 0;
     }
 
     void OracleReaderRedo::appendToTransaction(RedoLogRecord *redoLogRecord) {
@@ -845,57 +900,44 @@ namespace OpenLogReplicator {
             if (redoLogRecord->object == nullptr || redoLogRecord->object->options != 0 || (redoLogRecord->object->altered && redoLogRecord->opCode != 0x01801))
                 return;
 
-            Transaction *transaction = oracleReader->xidTransactionMap[redoLogRecord->xid];
-            if (transaction == nullptr) {
-                if (oracleReader->trace >= TRACE_DETAIL)
-                    cerr << "ERROR: transaction missing" << endl;
-
-                transaction = new Transaction(oracleReader, redoLogRecord->xid, oracleReader->transactionBuffer);
-                transaction->add(oracleReader, redoLogRecord->objn, redoLogRecord->objd, redoLogRecord->uba, redoLogRecord->dba, redoLogRecord->slt,
-                        redoLogRecord->rci, redoLogRecord, &zero, oracleReader->transactionBuffer, sequence);
-                oracleReader->xidTransactionMap[redoLogRecord->xid] = transaction;
-                oracleReader->transactionHeap.add(transaction);
-            } else {
-                if (transaction->opCodes > 0)
-                    oracleReader->lastOpTransactionMap.erase(transaction);
-                transaction->add(oracleReader, redoLogRecord->objn, redoLogRecord->objd, redoLogRecord->uba, redoLogRecord->dba, redoLogRecord->slt,
-                        redoLogRecord->rci, redoLogRecord, &zero, oracleReader->transactionBuffer, sequence);
-                oracleReader->transactionHeap.update(transaction->pos);
-            }
+            if (oracleReader->trace >= TRACE_DETAIL && findTransaction(redoLogRecord->xid) == nullptr)
+                cerr << "ERROR: transaction missing" << endl;
 
-            if ((oracleReader->trace2 & TRACE2_ROLLBACK) != 0) {
-                cerr << "redo, now last: UBA: " << PRINTUBA(transaction->lastUba) <<
-                        " DBA: 0x" << hex << transaction->lastDba <<
-                        " SLT: " << dec << (uint64_t)transaction->lastSlt <<
-                        " RCI: " << dec << (uint64_t)transaction->lastRci << endl;
-            }
-            oracleReader->lastOpTransactionMap.set(transaction);
-            oracleReader->transactionHeap.update(transaction->pos);
+            Transaction *transaction = getRecordTransaction(redoLogRecord->xid);
+            transaction->add(oracleReader, redoLogRecord->objn, redoLogRecord->objd, redoLogRecord->uba, redoLogRecord->dba, redoLogRecord->slt,
+                    redoLogRecord->rci, redoLogRecord, &zero, oracleReader->transactionBuffer, sequence);
 
             return;
         } else
         if (redoLogRecord->opCode != 0x0502 && redoLogRecord->opCode != 0x0504)
             return;
 
-        Transaction *transaction = oracleReader->xidTransactionMap[redoLogRecord->xid];
+        if (redoLogRecord->opCode == 0x0504)
+            oracleReader->commitDict(redoLogRecord->xid, curScn, (redoLogRecord->flg & FLG_ROLLBACK_OP0504) != 0);
+
+        //transactions without tracked changes are just marked in the map
+        Transaction *transaction = findTransaction(redoLogRecord->xid);
         if (transaction == nullptr) {
-            transaction = new Transaction(oracleReader, redoLogRecord->xid, oracleReader->transactionBuffer);
-            transaction->touch(curScn, sequence);
-            oracleReader->xidTransactionMap[redoLogRecord->xid] = transaction;
-            oracleReader->transactionHeap.add(transaction);
-        } else
-            transaction->touch(curScn, sequence);
+            if (redoLogRecord->opCode == 0x0502)
+                oracleReader->xidTransactionMap.setBegin(redoLogRecord->xid, curScn, sequence);
+            else if (oracleReader->xidTransactionMap.find(redoLogRecord->xid) != nullptr)
+                oracleReader->xidTransactionMap.erase(redoLogRecord->xid);
+            return;
+        }
+        transaction->touch(curScn, sequence);
 
         if (redoLogRecord->opCode == 0x0502) {
             transaction->isBegin = true;
         }
 
         if (redoLogRecord->opCode == 0x0504) {
-            transaction->isCommit = true;
             transaction->commitTime = recordTimestmap;
             if ((redoLogRecord->flg & FLG_ROLLBACK_OP0504) != 0)
                 transaction->isRollback = true;
-            oracleReader->transactionHeap.update(transaction->pos);
+            if (!transaction->isCommit) {
+                transaction->isCommit = true;
+                oracleReader->transactionHeap.commit(transaction);
+            }
         }
     }
 
@@ -961,31 +1003,15 @@ namespace OpenLogReplicator {
         //delete multiple rows
         case 0x05010B0C:
             {
-                Transaction *transaction = oracleReader->xidTransactionMap[redoLogRecord1->xid];
-                if (transaction == nullptr) {
-                    transaction = new Transaction(oracleReader, redoLogRecord1->xid, oracleReader->transactionBuffer);
-                    transaction->add(oracleReader, objn, objd, redoLogRecord1->uba, redoLogRecord1->dba, redoLogRecord1->slt, redoLogRecord1->rci,
-                            redoLogRecord1, redoLogRecord2, oracleReader->transactionBuffer, sequence);
-                    oracleReader->xidTransactionMap[redoLogRecord1->xid] = transaction;
-                    oracleReader->transactionHeap.add(transaction);
-                } else {
-                    if (transaction->opCodes > 0)
-                        oracleReader->lastOpTransactionMap.erase(transaction);
-
-                    transaction->add(oracleReader, objn, objd, redoLogRecord1->uba, redoLogRecord1->dba, redoLogRecord1->slt, redoLogRecord1->rci,
-                            redoLogRecord1, redoLogRecord2, oracleReader->transactionBuffer, sequence);
-                    oracleReader->transactionHeap.update(transaction->pos);
-                }
+                Transaction *transaction = getRecordTransaction(redoLogRecord1->xid);
+                TransactionChunk *lastTc = transaction->lastTc;
+                transaction->add(oracleReader, objn, objd, redoLogRecord1->uba, redoLogRecord1->dba, redoLogRecord1->slt, redoLogRecord1->rci,
+                        redoLogRecord1, redoLogRecord2, oracleReader->transactionBuffer, sequence);
                 transaction->isShutdown = isShutdown;
 
-                if ((oracleReader->trace2 & TRACE2_ROLLBACK) != 0) {
-                    cerr << "redo, now last: UBA: " << PRINTUBA(transaction->lastUba) <<
-                            " DBA: 0x" << hex << transaction->lastDba <<
-                            " SLT: " << dec << (uint64_t)transaction->lastSlt <<
-                            " RCI: " << dec << (uint64_t)transaction->lastRci << endl;
-                }
-                oracleReader->lastOpTransactionMap.set(transaction);
-                oracleReader->transactionHeap.update(transaction->pos);
+                //new chunk started, output big transaction before commit
+                if (oracleReader->streamTransactionSize > 0 && transaction->lastTc != lastTc && transaction->isBegin && !transaction->isShutdown)
+                    transaction->stream(oracleReader, oracleReader->transactionBuffer);
             }
             break;
 
@@ -1015,6 +1041,7 @@ namespace OpenLogReplicator {
                             " RCI: " << dec << (uint64_t)redoLogRecord2->rci <<
                             " OPFLAGS: " << hex << redoLogRecord2->opFlags << endl;
                 }
+                closeRecordTransactions();
                 Transaction *transaction = oracleReader->lastOpTransactionMap.getMatch(redoLogRecord1->uba,
                         redoLogRecord2->dba, redoLogRecord2->slt, redoLogRecord2->rci, redoLogRecord2->opFlags);
 
@@ -1026,7 +1053,6 @@ namespace OpenLogReplicator {
 
                     oracleReader->lastOpTransactionMap.erase(transaction);
                     transaction->rollbackLastOp(oracleReader, curScn, oracleReader->transactionBuffer);
-                    oracleReader->transactionHeap.update(transaction->pos);
 
                     if ((oracleReader->trace2 & TRACE2_ROLLBACK) != 0) {
                         cerr << "rollback, now last: UBA: " << PRINTUBA(transaction->lastUba) <<
@@ -1043,13 +1069,12 @@ namespace OpenLogReplicator {
                     //check all previous transactions
                     bool foundPrevious = false;
 
-                    for (uint64_t i = 1; i <= oracleReader->transactionHeap.heapSize; ++i) {
-                        transaction = oracleReader->transactionHeap.heap[i];
+                    for (uint64_t i = 0; i < oracleReader->transactionHeap.size(); ++i) {
+                        transaction = oracleReader->transactionHeap.at(i);
 
                         if (transaction->opCodes > 0 &&
                                 transaction->rollbackPartOp(oracleReader, curScn, oracleReader->transactionBuffer, redoLogRecord1->uba,
                                 redoLogRecord2->dba, redoLogRecord2->slt, redoLogRecord2->rci, redoLogRecord2->opFlags)) {
-                            oracleReader->transactionHeap.update(transaction->pos);
                             foundPrevious = true;
                             break;
                         }
@@ -1086,17 +1111,23 @@ namespace OpenLogReplicator {
             oracleReader->dumpTransactions();
         }
 
+        if (oracleReader->formatterPool != nullptr)
+            oracleReader->formatterPool->reap();
+
         while (transaction != nullptr) {
             if (oracleReader->trace >= TRACE_FULL)
                 cerr << "FULL: " << *transaction << endl;
 
             if (transaction->lastScn <= checkpointScn && transaction->isCommit) {
+                bool isFormatted = false;
                 if (transaction->lastScn > oracleReader->databaseScn) {
                     if (transaction->isBegin)  {
                         if (transaction->isShutdown)
                             isShutdown = true;
+                        else if (oracleReader->formatterPool != nullptr)
+                            isFormatted = true;
                         else
-                            transaction->flush(oracleReader);
+                            transaction->flush(oracleReader, oracleReader->commandBuffer);
                     } else {
                         if (oracleReader->trace >= TRACE_WARN) {
                             cerr << "WARNING: skipping transaction with no begin: " << *transaction << endl;
@@ -1114,10 +1145,15 @@ namespace OpenLogReplicator {
                     oracleReader->lastOpTransactionMap.erase(transaction);
 
                 oracleReader->xidTransactionMap.erase(transaction->xid);
-                if (oracleReader->trace >= TRACE_FULL)
-                    cerr << "FULL: dropping" << endl;
-                oracleReader->transactionBuffer->deleteTransactionChunks(transaction->firstTc, transaction->lastTc);
-                delete transaction;
+                //formatted in parallel and freed after output
+                if (isFormatted) {
+                    oracleReader->formatterPool->submit(transaction);
+                } else {
+                    if (oracleReader->trace >= TRACE_FULL)
+                        cerr << "FULL: dropping" << endl;
+                    oracleReader->transactionBuffer->deleteTransactionChunks(transaction->firstTc, transaction->lastTc);
+                    oracleReader->transactionBuffer->deleteTransaction(transaction);
+                }
 
                 transaction = oracleReader->transactionHeap.top();
             } else
@@ -1125,9 +1161,10 @@ namespace OpenLogReplicator {
         }
 
         if ((oracleReader->trace2 & TRACE2_DUMP) != 0) {
-            for (auto const& xid : oracleReader->xidTransactionMap) {
-                Transaction *transaction = oracleReader->xidTransactionMap[xid.first];
-                cerr << "DUMP: " << *transaction << endl;
+            for (uint64_t i = 0; i < oracleReader->xidTransactionMap.capacity; ++i) {
+                Transaction *transaction = oracleReader->xidTransactionMap.at(i);
+                if (transaction != nullptr)
+                    cerr << "DUMP: " << *transaction << endl;
             }
         }
 
@@ -1141,6 +1178,7 @@ namespace OpenLogReplicator {
             oracleReader->databaseScn = checkpointScn;
         }
         lastCheckpointScn = checkpointScn;
+        oracleReader->freeRetiredObjects();
 
         if (isShutdown)
             stopMain();
@@ -1201,6 +1239,7 @@ namespace OpenLogReplicator {
         sequence = 0;
         blockNumber = 0;
         lastCheckpointScn = 0;
+        extScnBlock = 0;
         curScn = ZERO_SCN;
         recordTimestmap = 0;
         recordBeginPos = 0;
@@ -1316,6 +1355,11 @@ namespace OpenLogReplicator {
                     if (oracleReader->shutdown)
                         break;
 
+                    //LWN with the checkpoint is read to the end, its SCN is safe without waiting for the next record,
+                    //SCN of records is not, they are not ordered
+                    if (oracleReader->lowLatency > 0 && extScn > lastCheckpointScn && blockNumber >= extScnBlock)
+                        flushTransactions(extScn);
+
                     usleep(oracleReader->redoReadSleep);
                 }
             }
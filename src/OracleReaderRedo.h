@@ -37,6 +37,7 @@ namespace OpenLogReplicator {
 
     class OracleReader;
     class OpCode;
+    class Transaction;
 
     class OracleReaderRedo {
     private:
@@ -51,6 +52,7 @@ namespace OpenLogReplicator {
         int64_t fileDes;
         typescn lastCheckpointScn;
         typescn extScn;
+        typeblk extScnBlock;        //first block after the LWN of extScn
         typescn curScn;
         typescn curScnPrev;
         typesubscn curSubScn;
@@ -62,6 +64,8 @@ namespace OpenLogReplicator {
         uint64_t redoBufferPos;
         uint64_t redoBufferFileStart;
         uint64_t redoBufferFileEnd;
+        Transaction *recordTransactions[VECTOR_MAX_LENGTH];
+        uint64_t recordTransactionsCnt;
 
         void initFile();
         uint64_t readFile();
@@ -70,6 +74,9 @@ namespace OpenLogReplicator {
         uint64_t processBuffer();
         void analyzeRecord();
         void flushTransactions(typescn checkpointScn);
+        Transaction* findTransaction(typexid xid);
+        Transaction* getRecordTransaction(typexid xid);
+        void closeRecordTransactions();
         void appendToTransaction(RedoLogRecord *redoLogRecord);
         void appendToTransaction(RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2);
         typesum calcChSum(uint8_t *buffer, uint64_t size);
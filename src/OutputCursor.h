@@ -0,0 +1,51 @@
+/* Header for OutputCursor class
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <atomic>
+#include <stdint.h>
+#include "types.h"
+
+#ifndef OUTPUTCURSOR_H_
+#define OUTPUTCURSOR_H_
+
+#define LAG_POLICY_BLOCK 1
+#define LAG_POLICY_DROP 2
+
+#define CURSOR_IDLE 0
+#define CURSOR_BUSY 1
+#define CURSOR_DROPPED 2
+
+using namespace std;
+
+namespace OpenLogReplicator {
+
+    //read position of one consumer of the output buffer
+    class OutputCursor {
+    public:
+        atomic<uint64_t> pos;           //written only by the consumer, or under the buffer mutex when it rejoins
+        atomic<uint64_t> state;         //drop policy: consumer holds a message or was dropped by the writer
+        uint64_t lagPolicy;             //block - writer waits for the consumer, drop - consumer skips to the newest message
+        uint64_t drops;
+
+        OutputCursor(uint64_t lagPolicy);
+        virtual ~OutputCursor();
+    };
+}
+
+#endif
@@ -0,0 +1,389 @@
+/* Row filter evaluated on raw redo column data
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <iostream>
+#include <string.h>
+
+#include "types.h"
+#include "ColumnIterator.h"
+#include "OracleColumn.h"
+#include "OracleObject.h"
+#include "OracleReader.h"
+#include "RedoLogRecord.h"
+#include "RowFilter.h"
+#include "Writer.h"
+
+namespace OpenLogReplicator {
+
+    RowFilter::RowFilter(OracleReader *oracleReader, const string expression) :
+            oracleReader(oracleReader),
+            expression(expression) {
+    }
+
+    RowFilter::~RowFilter() {
+        conditions.clear();
+    }
+
+    void RowFilter::skipSpaces(uint64_t &pos) {
+        while (pos < expression.length() && (expression[pos] == ' ' || expression[pos] == '\t' || expression[pos] == '\n' || expression[pos] == '\r'))
+            ++pos;
+    }
+
+    bool RowFilter::parseKeyword(uint64_t &pos, const char *keyword) {
+        skipSpaces(pos);
+        uint64_t length = strlen(keyword);
+        if (pos + length > expression.length())
+            return false;
+
+        for (uint64_t i = 0; i < length; ++i)
+            if (toupper(expression[pos + i]) != keyword[i])
+                return false;
+
+        //keyword must not be a prefix of an identifier
+        if (isalpha(keyword[0]) && pos + length < expression.length() &&
+                (isalnum(expression[pos + length]) || expression[pos + length] == '_' || expression[pos + length] == '$' || expression[pos + length] == '#'))
+            return false;
+
+        pos += length;
+        return true;
+    }
+
+    //unquoted identifiers are upper case like in Oracle
+    bool RowFilter::parseIdentifier(uint64_t &pos, string &identifier) {
+        skipSpaces(pos);
+        identifier.clear();
+
+        if (pos < expression.length() && expression[pos] == '"') {
+            ++pos;
+            while (pos < expression.length() && expression[pos] != '"')
+                identifier.append(1, expression[pos++]);
+            if (pos >= expression.length())
+                return false;
+            ++pos;
+            return identifier.length() > 0;
+        }
+
+        while (pos < expression.length() && (isalnum(expression[pos]) || expression[pos] == '_' || expression[pos] == '$' || expression[pos] == '#'))
+            identifier.append(1, toupper(expression[pos++]));
+        return identifier.length() > 0;
+    }
+
+    bool RowFilter::parseLiteral(uint64_t &pos, string &literal, bool &isString) {
+        skipSpaces(pos);
+        literal.clear();
+        if (pos >= expression.length())
+            return false;
+
+        if (expression[pos] == '\'') {
+            isString = true;
+            ++pos;
+            while (pos < expression.length()) {
+                if (expression[pos] == '\'') {
+                    if (pos + 1 < expression.length() && expression[pos + 1] == '\'') {
+                        literal.append(1, '\'');
+                        pos += 2;
+                        continue;
+                    }
+                    ++pos;
+                    return true;
+                }
+                literal.append(1, expression[pos++]);
+            }
+            return false;
+        }
+
+        isString = false;
+        if (expression[pos] == '-' || expression[pos] == '+')
+            literal.append(1, expression[pos++]);
+        while (pos < expression.length() && (isdigit(expression[pos]) || expression[pos] == '.'))
+            literal.append(1, expression[pos++]);
+        return literal.length() > 0;
+    }
+
+    //decimal literal to Oracle NUMBER format: exponent byte and base 100 digits
+    bool RowFilter::encodeNumber(const string &literal, string &encoded) {
+        string integer, fraction;
+        bool negative = false, dot = false;
+        uint64_t i = 0;
+
+        encoded.clear();
+        if (i < literal.length() && (literal[i] == '-' || literal[i] == '+')) {
+            negative = (literal[i] == '-');
+            ++i;
+        }
+        for (; i < literal.length(); ++i) {
+            if (literal[i] == '.') {
+                if (dot)
+                    return false;
+                dot = true;
+            } else if (isdigit(literal[i])) {
+                if (dot)
+                    fraction.append(1, literal[i]);
+                else
+                    integer.append(1, literal[i]);
+            } else
+                return false;
+        }
+        if (integer.length() == 0 && fraction.length() == 0)
+            return false;
+
+        while (integer.length() > 0 && integer[0] == '0')
+            integer.erase(0, 1);
+        while (fraction.length() > 0 && fraction[fraction.length() - 1] == '0')
+            fraction.erase(fraction.length() - 1, 1);
+
+        //just zero
+        if (integer.length() == 0 && fraction.length() == 0) {
+            encoded.append(1, (char)0x80);
+            return true;
+        }
+
+        if ((integer.length() & 1) != 0)
+            integer.insert(0, 1, '0');
+        if ((fraction.length() & 1) != 0)
+            fraction.append(1, '0');
+
+        int64_t exponent = (int64_t)(integer.length() / 2) - 1;
+        string digits = integer + fraction;
+        if (integer.length() == 0) {
+            while (digits.length() >= 2 && digits[0] == '0' && digits[1] == '0') {
+                digits.erase(0, 2);
+                --exponent;
+            }
+        }
+        while (digits.length() >= 2 && digits[digits.length() - 2] == '0' && digits[digits.length() - 1] == '0')
+            digits.erase(digits.length() - 2, 2);
+
+        uint64_t pairs = digits.length() / 2;
+        if (pairs > 20 || exponent > 62 || exponent < -65)
+            return false;
+
+        if (!negative) {
+            encoded.append(1, (char)(0xC1 + exponent));
+            for (uint64_t j = 0; j < pairs; ++j)
+                encoded.append(1, (char)((digits[j * 2] - '0') * 10 + (digits[j * 2 + 1] - '0') + 1));
+        } else {
+            encoded.append(1, (char)(0x3E - exponent));
+            for (uint64_t j = 0; j < pairs; ++j)
+                encoded.append(1, (char)(101 - ((digits[j * 2] - '0') * 10 + (digits[j * 2 + 1] - '0'))));
+            if (pairs < 20)
+                encoded.append(1, (char)102);
+        }
+        return true;
+    }
+
+    bool RowFilter::compile(OracleObject *object) {
+        uint64_t pos = 0;
+        conditions.clear();
+
+        while (true) {
+            RowFilterCondition condition;
+            string columnName;
+            if (!parseIdentifier(pos, columnName)) {
+                cerr << "ERROR: filter for " << object->owner << "." << object->objectName << " - column name expected at position " << dec << pos << endl;
+                return false;
+            }
+
+            OracleColumn *column = nullptr;
+            for (uint64_t i = 0; i < object->columns.size(); ++i) {
+                if (object->columns[i]->columnName.compare(columnName) == 0) {
+                    column = object->columns[i];
+                    condition.column = i;
+                    break;
+                }
+            }
+            if (column == nullptr) {
+                cerr << "ERROR: filter for " << object->owner << "." << object->objectName << " - unknown column " << columnName << endl;
+                return false;
+            }
+            if (column->typeNo != 1 && column->typeNo != 96 && column->typeNo != 2) {
+                cerr << "ERROR: filter for " << object->owner << "." << object->objectName << " - column " << columnName <<
+                        " of type " << dec << column->typeNo << " is not supported" << endl;
+                return false;
+            }
+
+            bool list = false;
+            condition.negate = false;
+            if (parseKeyword(pos, "!=") || parseKeyword(pos, "<>"))
+                condition.negate = true;
+            else if (parseKeyword(pos, "="))
+                condition.negate = false;
+            else if (parseKeyword(pos, "NOT")) {
+                if (!parseKeyword(pos, "IN")) {
+                    cerr << "ERROR: filter for " << object->owner << "." << object->objectName << " - IN expected at position " << dec << pos << endl;
+                    return false;
+                }
+                condition.negate = true;
+                list = true;
+            } else if (parseKeyword(pos, "IN"))
+                list = true;
+            else {
+                cerr << "ERROR: filter for " << object->owner << "." << object->objectName << " - operator expected at position " << dec << pos << endl;
+                return false;
+            }
+
+            if (list && !parseKeyword(pos, "(")) {
+                cerr << "ERROR: filter for " << object->owner << "." << object->objectName << " - ( expected at position " << dec << pos << endl;
+                return false;
+            }
+
+            do {
+                string literal, value;
+                bool isString;
+                if (!parseLiteral(pos, literal, isString)) {
+                    cerr << "ERROR: filter for " << object->owner << "." << object->objectName << " - value expected at position " << dec << pos << endl;
+                    return false;
+                }
+
+                if (column->typeNo == 2) {
+                    if (isString || !encodeNumber(literal, value)) {
+                        cerr << "ERROR: filter for " << object->owner << "." << object->objectName << " - bad number " << literal << " for column " << columnName << endl;
+                        return false;
+                    }
+                } else {
+                    if (!isString) {
+                        cerr << "ERROR: filter for " << object->owner << "." << object->objectName << " - string expected for column " << columnName << endl;
+                        return false;
+                    }
+                    value = literal;
+                    //char is blank padded
+                    if (column->typeNo == 96 && value.length() < column->length)
+                        value.append(column->length - value.length(), ' ');
+                }
+                condition.values.push_back(value);
+            } while (list && parseKeyword(pos, ","));
+
+            if (list && !parseKeyword(pos, ")")) {
+                cerr << "ERROR: filter for " << object->owner << "." << object->objectName << " - ) expected at position " << dec << pos << endl;
+                return false;
+            }
+            conditions.push_back(condition);
+
+            skipSpaces(pos);
+            if (pos == expression.length())
+                break;
+            if (!parseKeyword(pos, "AND")) {
+                cerr << "ERROR: filter for " << object->owner << "." << object->objectName << " - AND expected at position " << dec << pos << endl;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    //null never matches, like in SQL
+    bool RowFilter::isMatching(RowFilterCondition &condition, const uint8_t *data, uint64_t length) {
+        if (data == nullptr)
+            return false;
+
+        for (auto &value : condition.values) {
+            if (value.length() == length && memcmp(value.c_str(), data, length) == 0)
+                return !condition.negate;
+        }
+        return condition.negate;
+    }
+
+    //column value from redo record chain, same layout as parsed by the writer, false when column is not present
+    bool RowFilter::findColumn(OracleReader *oracleReader, RedoLogRecord *redoLogRecord, uint64_t column, const uint8_t *&data, uint64_t &length) {
+        ColumnIterator iterator(oracleReader, redoLogRecord);
+
+        while (iterator.next()) {
+            if (iterator.colNum == column) {
+                data = iterator.data;
+                length = iterator.length;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    //values of one row image, columns not present in the first record are taken from the second one
+    bool RowFilter::matchesImage(RedoLogRecord *redoLogRecordImage, RedoLogRecord *redoLogRecordRest) {
+        for (auto &condition : conditions) {
+            const uint8_t *data = nullptr;
+            uint64_t length = 0;
+
+            bool found = findColumn(oracleReader, redoLogRecordImage, condition.column, data, length) ||
+                    findColumn(oracleReader, redoLogRecordRest, condition.column, data, length);
+
+            //value not present in redo - row is not dropped
+            if (found && !isMatching(condition, data, length))
+                return false;
+        }
+        return true;
+    }
+
+    //insert - new values, delete - old values, update - new or old values, so that a row moving into
+    //or out of the filtered rows is not lost
+    bool RowFilter::matchesDML(RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2, uint64_t type) {
+        if (type == TRANSACTION_INSERT)
+            return matchesImage(redoLogRecord2, nullptr);
+        else if (type == TRANSACTION_DELETE)
+            return matchesImage(redoLogRecord1, nullptr);
+        else
+            return matchesImage(redoLogRecord2, redoLogRecord1) || matchesImage(redoLogRecord1, redoLogRecord2);
+    }
+
+    //column of one row of multi-row insert or delete, false when the row has less columns
+    bool RowFilter::findRowColumn(OracleReader *oracleReader, RedoLogRecord *redoLogRecord, uint64_t fieldPos, uint64_t column,
+            const uint8_t *&data, uint64_t &length) {
+        ColumnIterator iterator(oracleReader, redoLogRecord, fieldPos);
+        data = nullptr;
+        length = 0;
+
+        while (iterator.next()) {
+            if (iterator.colNum == column) {
+                data = iterator.data;
+                length = iterator.length;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    //one row of multi-row insert or delete
+    bool RowFilter::matchesRow(RedoLogRecord *redoLogRecord, uint64_t fieldPos) {
+        for (auto &condition : conditions) {
+            const uint8_t *data;
+            uint64_t length;
+
+            findRowColumn(oracleReader, redoLogRecord, fieldPos, condition.column, data, length);
+            if (!isMatching(condition, data, length))
+                return false;
+        }
+        return true;
+    }
+
+    bool RowFilter::matchesAnyRow(RedoLogRecord *redoLogRecord, uint64_t headerFields) {
+        uint64_t fieldPos = redoLogRecord->fieldPos;
+        for (uint64_t i = 1; i <= headerFields; ++i) {
+            uint16_t fieldLength = oracleReader->read16(redoLogRecord->data + redoLogRecord->fieldLengthsDelta + i * 2);
+            fieldPos += (fieldLength + 3) & 0xFFFC;
+        }
+
+        for (uint64_t r = 0; r < redoLogRecord->nrow; ++r) {
+            if (matchesRow(redoLogRecord, fieldPos))
+                return true;
+            fieldPos += oracleReader->read16(redoLogRecord->data + redoLogRecord->rowLenghsDelta + r * 2);
+        }
+        return false;
+    }
+}
@@ -0,0 +1,72 @@
+/* Header for RowFilter class
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <string>
+#include <vector>
+#include "types.h"
+
+#ifndef ROWFILTER_H_
+#define ROWFILTER_H_
+
+using namespace std;
+
+namespace OpenLogReplicator {
+
+    class OracleReader;
+    class OracleObject;
+    class RedoLogRecord;
+
+    struct RowFilterCondition {
+        uint64_t column;
+        bool negate;
+        vector<string> values;      //literals encoded like column data in redo
+    };
+
+    //row filter like: REGION = 'EU' AND STATUS IN ('A', 'B') AND ID != 5
+    //literals are encoded once, rows are compared on raw redo bytes, row is dropped only when some condition is false
+    class RowFilter {
+    protected:
+        OracleReader *oracleReader;
+        vector<RowFilterCondition> conditions;
+
+        bool parseIdentifier(uint64_t &pos, string &identifier);
+        bool parseLiteral(uint64_t &pos, string &literal, bool &isString);
+        bool parseKeyword(uint64_t &pos, const char *keyword);
+        void skipSpaces(uint64_t &pos);
+        bool isMatching(RowFilterCondition &condition, const uint8_t *data, uint64_t length);
+        bool matchesImage(RedoLogRecord *redoLogRecordImage, RedoLogRecord *redoLogRecordRest);
+
+    public:
+        string expression;
+
+        static bool encodeNumber(const string &literal, string &encoded);
+        static bool findColumn(OracleReader *oracleReader, RedoLogRecord *redoLogRecord, uint64_t column, const uint8_t *&data, uint64_t &length);
+        static bool findRowColumn(OracleReader *oracleReader, RedoLogRecord *redoLogRecord, uint64_t fieldPos, uint64_t column,
+                const uint8_t *&data, uint64_t &length);
+        bool compile(OracleObject *object);
+        bool matchesDML(RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2, uint64_t type);
+        bool matchesRow(RedoLogRecord *redoLogRecord, uint64_t fieldPos);
+        bool matchesAnyRow(RedoLogRecord *redoLogRecord, uint64_t headerFields);
+
+        RowFilter(OracleReader *oracleReader, const string expression);
+        virtual ~RowFilter();
+    };
+}
+
+#endif
@@ -21,13 +21,17 @@ along with Open Log Replicator; see the file LICENSE.txt  If not see
 #include <iomanip>
 #include <string>
 #include <string.h>
+#include <vector>
 #include "types.h"
 #include "CommandBuffer.h"
+#include "FormatterPool.h"
+#include "OracleObject.h"
 #include "OracleReader.h"
 #include "Transaction.h"
 #include "TransactionBuffer.h"
 #include "TransactionChunk.h"
 #include "RedoLogRecord.h"
+#include "RowFilter.h"
 #include "Writer.h"
 #include "OpCode.h"
 #include "OpCode0501.h"
@@ -46,18 +50,6 @@ using namespace std;
 
 namespace OpenLogReplicator {
 
-    bool Transaction::operator< (Transaction &p) {
-        if (isCommit && !p.isCommit)
-            return true;
-        if (!isCommit && p.isCommit)
-            return false;
-
-        bool ret = lastScn < p.lastScn;
-        if (ret != false)
-            return ret;
-        return lastScn == p.lastScn && xid < p.xid;
-    }
-
     void Transaction::touch(typescn scn, typeseq sequence) {
         if (firstSequence == 0 || firstSequence > sequence)
             firstSequence = sequence;
@@ -141,7 +133,7 @@ namespace OpenLogReplicator {
                     " SLT: " << dec << (uint64_t)slt <<
                     " RCI: " << dec << (uint64_t)rci << endl;
 
-        if (transactionBuffer->addTransactionChunk(oracleReader, lastTc, objn, objd, uba, dba, slt, rci, redoLogRecord1, redoLogRecord2)) {
+        if (transactionBuffer->addTransactionChunk(oracleReader, firstTc, lastTc, objn, objd, uba, dba, slt, rci, redoLogRecord1, redoLogRecord2)) {
             lastUba = redoLogRecord1->uba;
             lastDba = redoLogRecord1->dba;
             lastSlt = redoLogRecord1->slt;
@@ -162,13 +154,26 @@ namespace OpenLogReplicator {
                     " opcodes: " << dec << opCodes << endl;
         }
 
-        if (transactionBuffer->deleteTransactionPart(oracleReader, firstTc, lastTc, uba, dba, slt, rci, opFlags)) {
+        if (lastTc->elements > 0 && transactionBuffer->deleteTransactionPart(oracleReader, firstTc, lastTc, uba, dba, slt, rci, opFlags)) {
             --opCodes;
             if (lastScn == ZERO_SCN || lastScn < scn)
                 lastScn = scn;
             return true;
-        } else
-            return false;
+        }
+
+        //operation was already output in a provisional batch
+        for (uint64_t i = streamedOps.size(); i > 0; --i) {
+            StreamedOp &streamedOp = streamedOps[i - 1];
+            if (streamedOp.slt == slt && streamedOp.rci == rci && streamedOp.uba == uba &&
+                    ((opFlags & OPFLAG_BEGIN_TRANS) != 0 || streamedOp.dba == dba)) {
+                retractOp(i - 1);
+                --opCodes;
+                if (lastScn == ZERO_SCN || lastScn < scn)
+                    lastScn = scn;
+                return true;
+            }
+        }
+        return false;
     }
 
     void Transaction::rollbackLastOp(OracleReader *oracleReader, typescn scn, TransactionBuffer *transactionBuffer) {
@@ -177,7 +182,15 @@ namespace OpenLogReplicator {
                     " DBA: 0x" << hex << lastDba <<
                     " SLT: " << dec << (uint64_t)lastSlt <<
                     " RCI: " << dec << (uint64_t)lastRci << endl;
-        transactionBuffer->rollbackTransactionChunk(oracleReader, lastTc, lastUba, lastDba, lastSlt, lastRci);
+        //all buffered operations were rolled back, the last one was already output
+        if (lastTc->elements == 0 && streamedOps.size() > 0) {
+            retractOp(streamedOps.size() - 1);
+            setLastOp();
+        } else {
+            transactionBuffer->rollbackTransactionChunk(oracleReader, lastTc, lastUba, lastDba, lastSlt, lastRci);
+            if (lastTc->elements == 0 && streamedOps.size() > 0)
+                setLastOp();
+        }
         if ((oracleReader->trace2 & TRACE2_UBA) != 0)
             cerr << "rollback after last UBA: " << PRINTUBA(lastUba) <<
                     " DBA: 0x" << hex << lastDba <<
@@ -189,200 +202,478 @@ namespace OpenLogReplicator {
             lastScn = scn;
     }
 
-    void Transaction::flush(OracleReader *oracleReader) {
-        TransactionChunk *tc = firstTc;
-        bool hasPrev = false, opFlush = false;
+    //rows are rolled back in reverse order, adjacent dml ranges of one batch are merged
+    void Transaction::retractOp(uint64_t op) {
+        StreamedOp streamedOp = streamedOps[op];
+        streamedOps.erase(streamedOps.begin() + op);
+        if (streamedOp.first > streamedOp.last)
+            return;
+
+        if (retractedOps.size() > 0) {
+            StreamedOp &retractedOp = retractedOps.back();
+            if (retractedOp.batch == streamedOp.batch && streamedOp.first <= retractedOp.last + 1 && streamedOp.last + 1 >= retractedOp.first) {
+                if (retractedOp.first > streamedOp.first)
+                    retractedOp.first = streamedOp.first;
+                if (retractedOp.last < streamedOp.last)
+                    retractedOp.last = streamedOp.last;
+                return;
+            }
+        }
+        retractedOps.push_back(streamedOp);
+    }
 
-        //transaction that has some DML's
+    void Transaction::setLastOp(void) {
+        if (streamedOps.size() == 0) {
+            lastUba = 0;
+            lastDba = 0;
+            lastSlt = 0;
+            lastRci = 0;
+            return;
+        }
 
-        if (opCodes > 0 && !isRollback) {
-            if ((oracleReader->trace2 & TRACE2_TRANSACTION) != 0) {
-                cerr << endl << "TRANSACTION: " << *this << endl;
-            }
+        StreamedOp &streamedOp = streamedOps.back();
+        lastUba = streamedOp.uba;
+        lastDba = streamedOp.dba;
+        lastSlt = streamedOp.slt;
+        lastRci = streamedOp.rci;
+    }
 
-            if (oracleReader->commandBuffer->posEnd >= oracleReader->commandBuffer->outputBufferSize - (oracleReader->commandBuffer->outputBufferSize/4))
-                oracleReader->commandBuffer->rewind();
-
-            oracleReader->commandBuffer->writer->beginTran(lastScn, commitTime, xid);
-            uint64_t pos, type = 0;
-            RedoLogRecord *first1 = nullptr, *first2 = nullptr, *last1 = nullptr, *last2 = nullptr;
-            typescn prevScn = 0;
-
-            while (tc != nullptr) {
-                pos = 0;
-                for (uint64_t i = 0; i < tc->elements; ++i) {
-                    typeop2 op = *((typeop2*)(tc->buffer + pos));
-
-                    RedoLogRecord *redoLogRecord1 = ((RedoLogRecord *)(tc->buffer + pos + ROW_HEADER_REDO1)),
-                                  *redoLogRecord2 = ((RedoLogRecord *)(tc->buffer + pos + ROW_HEADER_REDO2));
-                    redoLogRecord1->data = tc->buffer + pos + ROW_HEADER_DATA;
-                    redoLogRecord2->data = tc->buffer + pos + ROW_HEADER_DATA + redoLogRecord1->length;
-                    typescn scn = *((typescn *)(tc->buffer + pos + ROW_HEADER_SCN + redoLogRecord1->length + redoLogRecord2->length));
-
-                    if (oracleReader->trace >= TRACE_WARN) {
-                        if ((oracleReader->trace2 & TRACE2_TRANSACTION) != 0) {
-                            typeobj objn = *((typeobj*)(tc->buffer + pos + ROW_HEADER_OBJN + redoLogRecord1->length + redoLogRecord2->length));
-                            typeobj objd = *((typeobj*)(tc->buffer + pos + ROW_HEADER_OBJD + redoLogRecord1->length + redoLogRecord2->length));
-                            cerr << "TRANSACTION Row: " << setfill(' ') << setw(4) << dec << redoLogRecord1->length <<
-                                        ":" << setfill(' ') << setw(4) << dec << redoLogRecord2->length <<
-                                    " fb: " << setfill('0') << setw(2) << hex << (uint64_t)redoLogRecord1->fb <<
-                                        ":" << setfill('0') << setw(2) << hex << (uint64_t)redoLogRecord2->fb << " " <<
-                                    " op: " << setfill('0') << setw(8) << hex << op <<
-                                    " objn: " << dec << objn <<
-                                    " objd: " << dec << objd <<
-                                    " flg1: 0x" << setfill('0') << setw(4) << hex << redoLogRecord1->flg <<
-                                    " flg2: 0x" << setfill('0') << setw(4) << hex << redoLogRecord2->flg <<
-                                    " uba1: " << PRINTUBA(redoLogRecord1->uba) <<
-                                    " uba2: " << PRINTUBA(redoLogRecord2->uba) <<
-                                    " bdba1: 0x" << setfill('0') << setw(8) << hex << redoLogRecord1->bdba << "." << hex << (uint64_t)redoLogRecord1->slot <<
-                                    " nrid1: 0x" << setfill('0') << setw(8) << hex << redoLogRecord1->nridBdba << "." << hex << redoLogRecord1->nridSlot <<
-                                    " bdba2: 0x" << setfill('0') << setw(8) << hex << redoLogRecord2->bdba << "." << hex << (uint64_t)redoLogRecord2->slot <<
-                                    " nrid2: 0x" << setfill('0') << setw(8) << hex << redoLogRecord2->nridBdba << "." << hex << redoLogRecord2->nridSlot <<
-                                    " supp: (0x" << setfill('0') << setw(2) << hex << (uint64_t)redoLogRecord1->suppLogFb <<
-                                        ", " << setfill(' ') << setw(3) << dec << redoLogRecord1->suppLogCC <<
-                                        ", " << setfill(' ') << setw(3) << dec << redoLogRecord1->suppLogBefore <<
-                                        ", " << setfill(' ') << setw(3) << dec << redoLogRecord1->suppLogAfter <<
-                                        ", 0x" << setfill('0') << setw(8) << hex << redoLogRecord1->suppLogBdba << "." << hex << redoLogRecord1->suppLogSlot << ") " <<
-                                    " scn: " << PRINTSCN64(scn) << endl;
-                        }
-                        if (prevScn != 0 && prevScn > scn) {
-                            if (oracleReader->trace >= TRACE_WARN)
-                                cerr << "WARNING: SCN swap" << endl;
-                        }
+    void Transaction::openBatch(CommandBuffer *commandBuffer, bool provisional) {
+        if (provisional || batches > 0)
+            commandBuffer->writer->beginBatch(lastScn, xid, ++batches);
+        else
+            commandBuffer->writer->beginTran(lastScn, commitTime, xid);
+    }
+
+    //outputs complete rows from chunks before endTc, returns position of the first row which was not output
+    bool Transaction::flushChunks(OracleReader *oracleReader, CommandBuffer *commandBuffer, TransactionChunk *endTc, bool provisional,
+            TransactionChunk* &restTc, uint64_t &restPos, uint64_t &restElements) {
+        TransactionChunk *tc = firstTc;
+        bool hasPrev = false, opFlush = false;
+        uint64_t pos, type = 0;
+        RedoLogRecord *first1 = nullptr, *first2 = nullptr, *last1 = nullptr, *last2 = nullptr;
+        typescn prevScn = 0;
+        vector<StreamedOp> rowOps;
+
+        restTc = firstTc;
+        restPos = 0;
+        restElements = 0;
+
+        while (tc != endTc) {
+            pos = 0;
+            for (uint64_t i = 0; i < tc->elements; ++i) {
+                typeop2 op = *((typeop2*)(tc->buffer + pos));
+
+                RedoLogRecord *redoLogRecord1 = ((RedoLogRecord *)(tc->buffer + pos + ROW_HEADER_REDO1)),
+                              *redoLogRecord2 = ((RedoLogRecord *)(tc->buffer + pos + ROW_HEADER_REDO2));
+                redoLogRecord1->data = tc->buffer + pos + ROW_HEADER_DATA;
+                redoLogRecord2->data = tc->buffer + pos + ROW_HEADER_DATA + redoLogRecord1->length;
+                //rows are linked again on every pass: unfinished rows of streamed transactions
+                redoLogRecord1->next = nullptr;
+                redoLogRecord1->prev = nullptr;
+                redoLogRecord2->next = nullptr;
+                redoLogRecord2->prev = nullptr;
+                typescn scn = *((typescn *)(tc->buffer + pos + ROW_HEADER_SCN + redoLogRecord1->length + redoLogRecord2->length));
+
+                if (oracleReader->trace >= TRACE_WARN) {
+                    if ((oracleReader->trace2 & TRACE2_TRANSACTION) != 0) {
+                        typeobj objn = *((typeobj*)(tc->buffer + pos + ROW_HEADER_OBJN + redoLogRecord1->length + redoLogRecord2->length));
+                        typeobj objd = *((typeobj*)(tc->buffer + pos + ROW_HEADER_OBJD + redoLogRecord1->length + redoLogRecord2->length));
+                        cerr << "TRANSACTION Row: " << setfill(' ') << setw(4) << dec << redoLogRecord1->length <<
+                                    ":" << setfill(' ') << setw(4) << dec << redoLogRecord2->length <<
+                                " fb: " << setfill('0') << setw(2) << hex << (uint64_t)redoLogRecord1->fb <<
+                                    ":" << setfill('0') << setw(2) << hex << (uint64_t)redoLogRecord2->fb << " " <<
+                                " op: " << setfill('0') << setw(8) << hex << op <<
+                                " objn: " << dec << objn <<
+                                " objd: " << dec << objd <<
+                                " flg1: 0x" << setfill('0') << setw(4) << hex << redoLogRecord1->flg <<
+                                " flg2: 0x" << setfill('0') << setw(4) << hex << redoLogRecord2->flg <<
+                                " uba1: " << PRINTUBA(redoLogRecord1->uba) <<
+                                " uba2: " << PRINTUBA(redoLogRecord2->uba) <<
+                                " bdba1: 0x" << setfill('0') << setw(8) << hex << redoLogRecord1->bdba << "." << hex << (uint64_t)redoLogRecord1->slot <<
+                                " nrid1: 0x" << setfill('0') << setw(8) << hex << redoLogRecord1->nridBdba << "." << hex << redoLogRecord1->nridSlot <<
+                                " bdba2: 0x" << setfill('0') << setw(8) << hex << redoLogRecord2->bdba << "." << hex << (uint64_t)redoLogRecord2->slot <<
+                                " nrid2: 0x" << setfill('0') << setw(8) << hex << redoLogRecord2->nridBdba << "." << hex << redoLogRecord2->nridSlot <<
+                                " supp: (0x" << setfill('0') << setw(2) << hex << (uint64_t)redoLogRecord1->suppLogFb <<
+                                    ", " << setfill(' ') << setw(3) << dec << redoLogRecord1->suppLogCC <<
+                                    ", " << setfill(' ') << setw(3) << dec << redoLogRecord1->suppLogBefore <<
+                                    ", " << setfill(' ') << setw(3) << dec << redoLogRecord1->suppLogAfter <<
+                                    ", 0x" << setfill('0') << setw(8) << hex << redoLogRecord1->suppLogBdba << "." << hex << redoLogRecord1->suppLogSlot << ") " <<
+                                " scn: " << PRINTSCN64(scn) << endl;
                     }
-                    pos += redoLogRecord1->length + redoLogRecord2->length + ROW_HEADER_TOTAL;
-
-                    opFlush = false;
-                    switch (op) {
-                    //insert row piece
-                    case 0x05010B02:
-                    //delete row piece
-                    case 0x05010B03:
-                    //update row piece
-                    case 0x05010B05:
-                    //overwrite row piece
-                    case 0x05010B06:
-                    //change row forwading address
-                    case 0x05010B08:
-
-                        redoLogRecord2->suppLogAfter = redoLogRecord1->suppLogAfter;
-                        if (type == 0) {
-                            if ((redoLogRecord1->suppLogFb & FB_F) != 0 && op == 0x05010B02 &&
-                                    ((redoLogRecord1->suppLogBdba == redoLogRecord2->bdba && redoLogRecord1->suppLogSlot == redoLogRecord2->slot) || redoLogRecord1->suppLogBdba == 0))
-                                type = TRANSACTION_INSERT;
-                            else if ((redoLogRecord1->suppLogFb & FB_F) != 0 && op == 0x05010B03)
-                                type = TRANSACTION_DELETE;
-                            else
-                                type = TRANSACTION_UPDATE;
-                        }
+                    if (prevScn != 0 && prevScn > scn) {
+                        if (oracleReader->trace >= TRACE_WARN)
+                            cerr << "WARNING: SCN swap" << endl;
+                    }
+                }
 
-                        if (first1 == nullptr) {
-                            first1 = redoLogRecord1;
-                            first2 = redoLogRecord2;
-                            last1 = redoLogRecord1;
-                            last2 = redoLogRecord2;
-                        } else {
-                            if (last1->suppLogBdba == redoLogRecord1->suppLogBdba && last1->suppLogSlot == redoLogRecord1->suppLogSlot) {
-                                if (type == TRANSACTION_INSERT) {
-                                    redoLogRecord1->next = first1;
-                                    redoLogRecord2->next = first2;
-                                    first1->prev = redoLogRecord1;
-                                    first2->prev = redoLogRecord2;
-                                    first1 = redoLogRecord1;
-                                    first2 = redoLogRecord2;
-                                } else {
-                                    if (op == 0x05010B06 && last2->opCode == 0x0B02) {
-                                        if (last1->prev == nullptr) {
-                                            first1 = redoLogRecord1;
-                                            first2 = redoLogRecord2;
-                                            first1->next = last1;
-                                            first2->next = last2;
-                                            last1->prev = first1;
-                                            last2->prev = first2;
-                                        } else {
-                                            redoLogRecord1->prev = last1->prev;
-                                            redoLogRecord2->prev = last2->prev;
-                                            redoLogRecord1->next = last1;
-                                            redoLogRecord2->next = last2;
-                                            last1->prev->next = redoLogRecord1;
-                                            last2->prev->next = redoLogRecord2;
-                                            last1->prev = redoLogRecord1;
-                                            last2->prev = redoLogRecord2;
-                                        }
+                //released rows are remembered to retract them on rollback to savepoint
+                if (provisional) {
+                    uint8_t *trailer = tc->buffer + pos + redoLogRecord1->length + redoLogRecord2->length;
+                    StreamedOp streamedOp;
+                    streamedOp.uba = *((typeuba*)(trailer + ROW_HEADER_UBA));
+                    streamedOp.dba = *((typedba*)(trailer + ROW_HEADER_DBA));
+                    streamedOp.slt = *((typeslt*)(trailer + ROW_HEADER_SLT));
+                    streamedOp.rci = *((typerci*)(trailer + ROW_HEADER_RCI));
+                    rowOps.push_back(streamedOp);
+                }
+                pos += redoLogRecord1->length + redoLogRecord2->length + ROW_HEADER_TOTAL;
+
+                uint64_t first = 1, last = 0;
+                opFlush = false;
+                switch (op) {
+                //insert row piece
+                case 0x05010B02:
+                //delete row piece
+                case 0x05010B03:
+                //update row piece
+                case 0x05010B05:
+                //overwrite row piece
+                case 0x05010B06:
+                //change row forwading address
+                case 0x05010B08:
+
+                    redoLogRecord2->suppLogAfter = redoLogRecord1->suppLogAfter;
+                    if (type == 0) {
+                        if ((redoLogRecord1->suppLogFb & FB_F) != 0 && op == 0x05010B02 &&
+                                ((redoLogRecord1->suppLogBdba == redoLogRecord2->bdba && redoLogRecord1->suppLogSlot == redoLogRecord2->slot) || redoLogRecord1->suppLogBdba == 0))
+                            type = TRANSACTION_INSERT;
+                        else if ((redoLogRecord1->suppLogFb & FB_F) != 0 && op == 0x05010B03)
+                            type = TRANSACTION_DELETE;
+                        else
+                            type = TRANSACTION_UPDATE;
+                    }
+
+                    if (first1 == nullptr) {
+                        first1 = redoLogRecord1;
+                        first2 = redoLogRecord2;
+                        last1 = redoLogRecord1;
+                        last2 = redoLogRecord2;
+                    } else {
+                        if (last1->suppLogBdba == redoLogRecord1->suppLogBdba && last1->suppLogSlot == redoLogRecord1->suppLogSlot) {
+                            if (type == TRANSACTION_INSERT) {
+                                redoLogRecord1->next = first1;
+                                redoLogRecord2->next = first2;
+                                first1->prev = redoLogRecord1;
+                                first2->prev = redoLogRecord2;
+                                first1 = redoLogRecord1;
+                                first2 = redoLogRecord2;
+                            } else {
+                                if (op == 0x05010B06 && last2->opCode == 0x0B02) {
+                                    if (last1->prev == nullptr) {
+                                        first1 = redoLogRecord1;
+                                        first2 = redoLogRecord2;
+                                        first1->next = last1;
+                                        first2->next = last2;
+                                        last1->prev = first1;
+                                        last2->prev = first2;
                                     } else {
-                                        last1->next = redoLogRecord1;
-                                        last2->next = redoLogRecord2;
-                                        redoLogRecord1->prev = last1;
-                                        redoLogRecord2->prev = last2;
-                                        last1 = redoLogRecord1;
-                                        last2 = redoLogRecord2;
+                                        redoLogRecord1->prev = last1->prev;
+                                        redoLogRecord2->prev = last2->prev;
+                                        redoLogRecord1->next = last1;
+                                        redoLogRecord2->next = last2;
+                                        last1->prev->next = redoLogRecord1;
+                                        last2->prev->next = redoLogRecord2;
+                                        last1->prev = redoLogRecord1;
+                                        last2->prev = redoLogRecord2;
                                     }
+                                } else {
+                                    last1->next = redoLogRecord1;
+                                    last2->next = redoLogRecord2;
+                                    redoLogRecord1->prev = last1;
+                                    redoLogRecord2->prev = last2;
+                                    last1 = redoLogRecord1;
+                                    last2 = redoLogRecord2;
                                 }
-                            } else {
-                                cerr << "ERROR: next BDBA/SLOT does not match" << endl;
                             }
+                        } else {
+                            cerr << "ERROR: next BDBA/SLOT does not match" << endl;
                         }
+                    }
 
-                        if ((redoLogRecord1->suppLogFb & FB_L) != 0) {
+                    if ((redoLogRecord1->suppLogFb & FB_L) != 0) {
+                        if (first1->object->filter == nullptr || first1->object->filter->matchesDML(first1, first2, type)) {
                             if (hasPrev)
-                                oracleReader->commandBuffer->writer->next();
-                            oracleReader->commandBuffer->writer->parseDML(first1, first2, type);
-                            opFlush = true;
+                                commandBuffer->writer->next();
+                            else
+                                openBatch(commandBuffer, provisional);
+                            first = commandBuffer->writer->dmlNo;
+                            commandBuffer->writer->parseDML(first1, first2, type);
+                            last = commandBuffer->writer->dmlNo;
+                            hasPrev = true;
                         }
-                        break;
-
-                    //insert multiple rows
-                    case 0x05010B0B:
-                        if (hasPrev)
-                            oracleReader->commandBuffer->writer->next();
-                        oracleReader->commandBuffer->writer->parseInsertMultiple(redoLogRecord1, redoLogRecord2);
                         opFlush = true;
-                        break;
+                    }
+                    break;
 
-                    //delete multiple rows
-                    case 0x05010B0C:
+                //insert multiple rows
+                case 0x05010B0B:
+                    if (redoLogRecord1->object->filter == nullptr || redoLogRecord1->object->filter->matchesAnyRow(redoLogRecord2, 3)) {
                         if (hasPrev)
-                            oracleReader->commandBuffer->writer->next();
-                        oracleReader->commandBuffer->writer->parseDeleteMultiple(redoLogRecord1, redoLogRecord2);
-                        opFlush = true;
-                        break;
+                            commandBuffer->writer->next();
+                        else
+                            openBatch(commandBuffer, provisional);
+                        first = commandBuffer->writer->dmlNo;
+                        commandBuffer->writer->parseInsertMultiple(redoLogRecord1, redoLogRecord2);
+                        last = commandBuffer->writer->dmlNo;
+                        hasPrev = true;
+                    }
+                    opFlush = true;
+                    break;
 
-                    //truncate table
-                    case 0x18010000:
+                //delete multiple rows
+                case 0x05010B0C:
+                    if (redoLogRecord1->object->filter == nullptr || redoLogRecord1->object->filter->matchesAnyRow(redoLogRecord1, 5)) {
                         if (hasPrev)
-                            oracleReader->commandBuffer->writer->next();
-                        oracleReader->commandBuffer->writer->parseDDL(redoLogRecord1);
-                        opFlush = true;
-                        break;
-
-                    default:
-                        cerr << "ERROR: Unknown OpCode " << hex << op << endl;
+                            commandBuffer->writer->next();
+                        else
+                            openBatch(commandBuffer, provisional);
+                        first = commandBuffer->writer->dmlNo;
+                        commandBuffer->writer->parseDeleteMultiple(redoLogRecord1, redoLogRecord2);
+                        last = commandBuffer->writer->dmlNo;
+                        hasPrev = true;
                     }
+                    opFlush = true;
+                    break;
+
+                //truncate table
+                case 0x18010000:
+                    if (hasPrev)
+                        commandBuffer->writer->next();
+                    else
+                        openBatch(commandBuffer, provisional);
+                    first = commandBuffer->writer->dmlNo;
+                    commandBuffer->writer->parseDDL(redoLogRecord1);
+                    last = commandBuffer->writer->dmlNo;
+                    hasPrev = true;
+                    opFlush = true;
+                    break;
+
+                default:
+                    cerr << "ERROR: Unknown OpCode " << hex << op << endl;
+                    if (provisional)
+                        rowOps.pop_back();
+                }
 
-                    //split very big transactions
-                    if (oracleReader->commandBuffer->currentTranSize() >= oracleReader->commandBuffer->outputBufferSize/4) {
-                        cerr << "WARNING: Big transaction divided (" << oracleReader->commandBuffer->currentTranSize() << ")" << endl;
-                        oracleReader->commandBuffer->writer->commitTran();
-                        if (oracleReader->commandBuffer->posEnd >= oracleReader->commandBuffer->outputBufferSize - (oracleReader->commandBuffer->outputBufferSize/4))
-                            oracleReader->commandBuffer->rewind();
-                        oracleReader->commandBuffer->writer->beginTran(lastScn, commitTime, xid);
-                        hasPrev = false;
+                if (opFlush) {
+                    for (auto &rowOp : rowOps) {
+                        rowOp.batch = batches;
+                        rowOp.first = first;
+                        rowOp.last = last;
+                        streamedOps.push_back(rowOp);
                     }
+                    rowOps.clear();
+                    first1 = nullptr;
+                    last1 = nullptr;
+                    first2 = nullptr;
+                    last2 = nullptr;
+                    type = 0;
+                    restTc = tc;
+                    restPos = pos;
+                    restElements = i + 1;
+                }
+
+                //split very big transactions
+                if (commandBuffer->currentTranSize() >= commandBuffer->outputBufferSize/2) {
+                    cerr << "WARNING: Big transaction divided (" << commandBuffer->currentTranSize() << ")" << endl;
+                    commandBuffer->writer->commitTran();
+                    hasPrev = false;
+                }
+                prevScn = scn;
+            }
+            tc = tc->next;
+        }
+
+        if (hasPrev)
+            commandBuffer->writer->commitTran();
+
+        if (restTc != endTc && restPos == restTc->size) {
+            restTc = restTc->next;
+            restPos = 0;
+            restElements = 0;
+        }
+
+        return restTc != firstTc || restPos > 0;
+    }
 
-                    if (opFlush) {
+    //copy of one element to the transaction of a shard lane, created on first use
+    void Transaction::splitElement(OracleReader *oracleReader, TransactionBuffer *transactionBuffer, Transaction* &shardTransaction,
+            uint8_t *element) {
+        if (shardTransaction == nullptr) {
+            shardTransaction = transactionBuffer->newTransaction(oracleReader, xid);
+            shardTransaction->firstSequence = firstSequence;
+            shardTransaction->firstScn = firstScn;
+            shardTransaction->lastScn = lastScn;
+            shardTransaction->commitTime = commitTime;
+            shardTransaction->isBegin = isBegin;
+            shardTransaction->isCommit = isCommit;
+            shardTransaction->isRollback = isRollback;
+        }
+
+        RedoLogRecord *redoLogRecord1 = (RedoLogRecord *)(element + ROW_HEADER_REDO1),
+                      *redoLogRecord2 = (RedoLogRecord *)(element + ROW_HEADER_REDO2);
+        uint8_t *trailer = element + redoLogRecord1->length + redoLogRecord2->length;
+
+        transactionBuffer->addTransactionChunk(oracleReader, shardTransaction->firstTc, shardTransaction->lastTc,
+                *((typeobj*)(trailer + ROW_HEADER_OBJN)), *((typeobj*)(trailer + ROW_HEADER_OBJD)),
+                *((typeuba*)(trailer + ROW_HEADER_UBA)), *((typedba*)(trailer + ROW_HEADER_DBA)),
+                *((typeslt*)(trailer + ROW_HEADER_SLT)), *((typerci*)(trailer + ROW_HEADER_RCI)), redoLogRecord1, redoLogRecord2);
+        ++shardTransaction->opCodes;
+    }
+
+    //sharded output: rows are divided between the lanes once, every lane gets a transaction with only its own rows,
+    //multi-row operations go to every lane owning some of the rows, truncate goes to all lanes
+    void Transaction::split(OracleReader *oracleReader, TransactionBuffer *transactionBuffer, CommandBuffer *commandBuffer,
+            Transaction **shardTransactions, bool *shardRows) {
+        vector<uint8_t*> rowElements;
+        RedoLogRecord *first1 = nullptr, *first2 = nullptr, *last1 = nullptr, *last2 = nullptr;
+
+        for (uint64_t j = 0; j < commandBuffer->shards; ++j)
+            shardTransactions[j] = nullptr;
+        if (opCodes == 0 || isRollback)
+            return;
+
+        for (TransactionChunk *tc = firstTc; tc != nullptr; tc = tc->next) {
+            uint64_t pos = 0;
+            for (uint64_t i = 0; i < tc->elements; ++i) {
+                uint8_t *element = tc->buffer + pos;
+                typeop2 op = *((typeop2*)(element + ROW_HEADER_OP));
+                RedoLogRecord *redoLogRecord1 = (RedoLogRecord *)(element + ROW_HEADER_REDO1),
+                              *redoLogRecord2 = (RedoLogRecord *)(element + ROW_HEADER_REDO2);
+                redoLogRecord1->data = element + ROW_HEADER_DATA;
+                redoLogRecord2->data = element + ROW_HEADER_DATA + redoLogRecord1->length;
+                redoLogRecord1->next = nullptr;
+                redoLogRecord2->next = nullptr;
+                typeobj objn = *((typeobj*)(element + ROW_HEADER_OBJN + redoLogRecord1->length + redoLogRecord2->length));
+                pos += redoLogRecord1->length + redoLogRecord2->length + ROW_HEADER_TOTAL;
+
+                switch (op) {
+                //row pieces follow each other, the key is looked up in all pieces
+                case 0x05010B02:
+                case 0x05010B03:
+                case 0x05010B05:
+                case 0x05010B06:
+                case 0x05010B08:
+                    redoLogRecord2->suppLogAfter = redoLogRecord1->suppLogAfter;
+                    if (first1 == nullptr) {
+                        first1 = redoLogRecord1;
+                        first2 = redoLogRecord2;
+                    } else {
+                        last1->next = redoLogRecord1;
+                        last2->next = redoLogRecord2;
+                    }
+                    last1 = redoLogRecord1;
+                    last2 = redoLogRecord2;
+                    rowElements.push_back(element);
+
+                    if ((redoLogRecord1->suppLogFb & FB_L) != 0) {
+                        uint64_t shard = commandBuffer->getShard(objn, redoLogRecord1->suppLogBdba != 0 ? redoLogRecord1->suppLogBdba : redoLogRecord2->bdba,
+                                first1, first2);
+                        for (uint8_t *rowElement : rowElements)
+                            splitElement(oracleReader, transactionBuffer, shardTransactions[shard], rowElement);
+                        rowElements.clear();
                         first1 = nullptr;
-                        last1 = nullptr;
                         first2 = nullptr;
-                        last2 = nullptr;
-                        hasPrev = true;
-                        type = 0;
                     }
-                    prevScn = scn;
+                    break;
+
+                //insert multiple rows
+                case 0x05010B0B:
+                //delete multiple rows
+                case 0x05010B0C: {
+                    RedoLogRecord *redoLogRecord = (op == 0x05010B0B) ? redoLogRecord2 : redoLogRecord1;
+                    uint64_t headerFields = (op == 0x05010B0B) ? 3 : 5, fieldPos = redoLogRecord->fieldPos;
+                    for (uint64_t j = 1; j <= headerFields; ++j)
+                        fieldPos += (oracleReader->read16(redoLogRecord->data + redoLogRecord->fieldLengthsDelta + j * 2) + 3) & 0xFFFC;
+
+                    for (uint64_t j = 0; j < commandBuffer->shards; ++j)
+                        shardRows[j] = false;
+                    for (uint64_t r = 0; r < redoLogRecord->nrow; ++r) {
+                        shardRows[commandBuffer->getRowShard(objn, redoLogRecord2->bdba, redoLogRecord, fieldPos)] = true;
+                        fieldPos += oracleReader->read16(redoLogRecord->data + redoLogRecord->rowLenghsDelta + r * 2);
+                    }
+
+                    for (uint64_t j = 0; j < commandBuffer->shards; ++j)
+                        if (shardRows[j])
+                            splitElement(oracleReader, transactionBuffer, shardTransactions[j], element);
+                    break;
+                }
+
+                //truncate table
+                case 0x18010000:
+                    for (uint64_t j = 0; j < commandBuffer->shards; ++j)
+                        splitElement(oracleReader, transactionBuffer, shardTransactions[j], element);
+                    break;
+
+                default:
+                    cerr << "ERROR: Unknown OpCode " << hex << op << endl;
                 }
-                tc = tc->next;
+            }
+        }
+    }
+
+    //big transaction: output complete rows before commit, the rest is output at commit with a commit or rollback marker
+    void Transaction::stream(OracleReader *oracleReader, TransactionBuffer *transactionBuffer) {
+        //rows are no longer streamed when too many are remembered for rollback to savepoint
+        if (oracleReader->streamTransactionRows > 0 && streamedOps.size() >= oracleReader->streamTransactionRows) {
+            if (!isStreamLimit) {
+                cerr << "WARNING: transaction " << PRINTXID(xid) << " streamed " << dec << streamedOps.size() <<
+                        " rows (stream-transaction-rows), the rest is output at commit" << endl;
+                isStreamLimit = true;
+            }
+            return;
+        }
+
+        uint64_t size = 0;
+        for (TransactionChunk *tc = firstTc; tc != lastTc; tc = tc->next)
+            size += tc->size;
+        if (size < oracleReader->streamTransactionSize)
+            return;
+
+        //transactions committed earlier are output first
+        if (oracleReader->formatterPool != nullptr)
+            oracleReader->formatterPool->drain();
+
+        if ((oracleReader->trace2 & TRACE2_TRANSACTION) != 0) {
+            cerr << endl << "TRANSACTION (batch " << dec << (batches + 1) << "): " << *this << endl;
+        }
+
+        TransactionChunk *restTc;
+        uint64_t restPos, restElements;
+        if (flushChunks(oracleReader, oracleReader->commandBuffer, lastTc, true, restTc, restPos, restElements))
+            transactionBuffer->releaseTransactionChunks(firstTc, restTc, restPos, restElements);
+    }
+
+    void Transaction::flush(OracleReader *oracleReader, CommandBuffer *commandBuffer) {
+        TransactionChunk *restTc;
+        uint64_t restPos, restElements;
+
+        //rows were already partially output
+        if (batches > 0) {
+            if ((oracleReader->trace2 & TRACE2_TRANSACTION) != 0) {
+                cerr << endl << "TRANSACTION (batches " << dec << batches << "): " << *this << endl;
+            }
+
+            if (!isRollback) {
+                flushChunks(oracleReader, commandBuffer, nullptr, false, restTc, restPos, restElements);
+                for (auto &retractedOp : retractedOps)
+                    commandBuffer->writer->retractDml(lastScn, xid, retractedOp.batch, retractedOp.first, retractedOp.last);
+            }
+
+            if (isRollback)
+                commandBuffer->writer->rollbackBatches(lastScn, xid, batches);
+            else
+                commandBuffer->writer->commitBatches(lastScn, commitTime, xid, batches);
+            return;
+        }
+
+        //transaction that has some DML's
+        if (opCodes > 0 && !isRollback) {
+            if ((oracleReader->trace2 & TRACE2_TRANSACTION) != 0) {
+                cerr << endl << "TRANSACTION: " << *this << endl;
             }
 
-            oracleReader->commandBuffer->writer->commitTran();
+            flushChunks(oracleReader, commandBuffer, nullptr, false, restTc, restPos, restElements);
         }
     }
 
@@ -398,12 +689,14 @@ namespace OpenLogReplicator {
             lastSlt(0),
             lastRci(0),
             commitTime(0),
+            batches(0),
             isBegin(false),
             isCommit(false),
             isRollback(false),
             isShutdown(false),
+            isStreamLimit(false),
             next(nullptr) {
-        firstTc = transactionBuffer->newTransactionChunk(oracleReader);
+        firstTc = transactionBuffer->newTransactionChunk(oracleReader, 0);
         lastTc = firstTc;
     }
 
@@ -17,6 +17,7 @@ You should have received a copy of the GNU General Public License
 along with Open Log Replicator; see the file LICENSE.txt  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <vector>
 #include "types.h"
 
 #ifndef TRANSACTION_H_
@@ -31,8 +32,28 @@ namespace OpenLogReplicator {
     class OpCode0504;
     class RedoLogRecord;
     class OracleReader;
+    class CommandBuffer;
+
+    //operation output in a provisional batch, rollback to savepoint retracts its dml entries;
+    //kept for every streamed row until commit (32 bytes), limited by stream-transaction-rows
+    struct StreamedOp {
+        typeuba uba;
+        typedba dba;
+        uint32_t batch;
+        uint32_t first;             //first > last - nothing was output, e.g. filtered rows
+        uint32_t last;
+        typeslt slt;
+        typerci rci;
+    };
 
     class Transaction {
+    protected:
+        vector<StreamedOp> streamedOps;
+        vector<StreamedOp> retractedOps;    //dml ranges to retract at commit
+
+        void retractOp(uint64_t op);
+        void setLastOp(void);
+
     public:
         typexid xid;
         typeseq firstSequence;
@@ -47,13 +68,14 @@ namespace OpenLogReplicator {
         typeslt lastSlt;
         typerci lastRci;
         typetime commitTime;
+        uint64_t batches;
         bool isBegin;
         bool isCommit;
         bool isRollback;
         bool isShutdown;
+        bool isStreamLimit;
         Transaction *next;
 
-        bool operator< (Transaction &p);
         void touch(typescn scn, typeseq sequence);
         void add(OracleReader *oracleReader, typeobj objn, typeobj objd, typeuba uba, typedba dba, typeslt slt, typerci rci,
                 RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2, TransactionBuffer *transactionBuffer, typeseq sequence);
@@ -61,7 +83,14 @@ namespace OpenLogReplicator {
         bool rollbackPartOp(OracleReader *oracleReader, typescn scn, TransactionBuffer *transactionBuffer, typeuba uba,
                 typedba dba, typeslt slt, typerci rci, uint64_t opFlags);
 
-        void flush(OracleReader *oracleReader);
+        void openBatch(CommandBuffer *commandBuffer, bool provisional);
+        bool flushChunks(OracleReader *oracleReader, CommandBuffer *commandBuffer, TransactionChunk *endTc, bool provisional,
+                TransactionChunk* &restTc, uint64_t &restPos, uint64_t &restElements);
+        void splitElement(OracleReader *oracleReader, TransactionBuffer *transactionBuffer, Transaction* &shardTransaction, uint8_t *element);
+        void split(OracleReader *oracleReader, TransactionBuffer *transactionBuffer, CommandBuffer *commandBuffer,
+                Transaction **shardTransactions, bool *shardRows);
+        void stream(OracleReader *oracleReader, TransactionBuffer *transactionBuffer);
+        void flush(OracleReader *oracleReader, CommandBuffer *commandBuffer);
 
         Transaction(OracleReader *oracleReader, typexid xid, TransactionBuffer *transactionBuffer);
         virtual ~Transaction();
@@ -24,8 +24,10 @@ along with Open Log Replicator; see the file LICENSE.txt  If not see
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <new>
 #include "TransactionBuffer.h"
 #include "MemoryException.h"
+#include "Transaction.h"
 #include "TransactionChunk.h"
 #include "RedoLogRecord.h"
 #include "OracleReader.h"
@@ -35,68 +37,188 @@ using namespace std;
 namespace OpenLogReplicator {
 
     TransactionBuffer::TransactionBuffer(uint64_t redoBuffers, uint64_t redoBufferSize) :
+        copyTc(nullptr),
         redoBufferSize(redoBufferSize),
+        allocatedBuffers(0),
+        unusedTransactions(nullptr),
+        transactionSlabs(nullptr),
         freeBuffers(redoBuffers),
-        redoBuffers(redoBuffers) {
-        TransactionChunk *tc, *prevTc;
+        redoBuffers(redoBuffers),
+        usedSize(0) {
+
+        for (uint64_t i = 0; i < TRANSACTION_CHUNK_CLASSES; ++i) {
+            unusedTc[i] = nullptr;
+            carvedTc[i] = nullptr;
+            chunkSize[i] = redoBufferSize >> (TRANSACTION_CHUNK_CLASS_SHIFT * (TRANSACTION_CHUNK_CLASSES - 1 - i));
+            if (chunkSize[i] < ROW_HEADER_TOTAL)
+                chunkSize[i] = redoBufferSize;
+        }
 
-        prevTc = new TransactionChunk(nullptr, redoBufferSize);
         copyTc = new TransactionChunk(nullptr, redoBufferSize);
-        if (prevTc == nullptr || copyTc == nullptr) {
+        if (copyTc == nullptr) {
             cerr << "ERROR: out of memory for transaction buffer, for size: " << dec << this->redoBuffers << endl;
             throw MemoryException("out of memory");
         }
-        unusedTc = prevTc;
+    }
 
-        for (uint64_t a = 1; a < this->redoBuffers; ++a) {
-            tc = new TransactionChunk(prevTc, redoBufferSize);
-            if (tc == nullptr) {
-                cerr << "ERROR: out of memory for transaction buffer, for size: " << dec << this->redoBuffers << endl;
-                throw MemoryException("out of memory");
-            }
-            prevTc = tc;
+    uint64_t TransactionBuffer::getSizeClass(uint64_t size) {
+        for (uint64_t i = 0; i < TRANSACTION_CHUNK_CLASSES - 1; ++i)
+            if (size <= chunkSize[i])
+                return i;
+        return TRANSACTION_CHUNK_CLASSES - 1;
+    }
+
+    //growing transactions get bigger chunks
+    uint64_t TransactionBuffer::nextSizeClass(TransactionChunk *tc, uint64_t size) {
+        uint64_t sizeClass = getSizeClass(size);
+        if (tc != nullptr && tc->elements > 0 && sizeClass <= tc->sizeClass) {
+            if (tc->sizeClass < TRANSACTION_CHUNK_CLASSES - 1)
+                sizeClass = tc->sizeClass + 1;
+            else
+                sizeClass = TRANSACTION_CHUNK_CLASSES - 1;
         }
+        return sizeClass;
     }
 
-    TransactionChunk *TransactionBuffer::newTransactionChunk(OracleReader *oracleReader) {
-        if (unusedTc == nullptr) {
-            cerr << "ERROR: out of transaction buffer, size1: " << dec << freeBuffers << endl;
-            oracleReader->dumpTransactions();
-            throw MemoryException("out of memory");
+    //full size chunk, memory is allocated on first use
+    TransactionChunk *TransactionBuffer::getSlab(void) {
+        if (unusedTc[TRANSACTION_CHUNK_CLASSES - 1] == nullptr) {
+            if (allocatedBuffers < redoBuffers) {
+                TransactionChunk *tc = new TransactionChunk(nullptr, redoBufferSize);
+                if (tc == nullptr) {
+                    cerr << "ERROR: out of memory for transaction buffer, for size: " << dec << redoBuffers << endl;
+                    throw MemoryException("out of memory");
+                }
+                ++allocatedBuffers;
+                --freeBuffers;
+                return tc;
+            }
+
+            reclaimSlabs();
+            if (unusedTc[TRANSACTION_CHUNK_CLASSES - 1] == nullptr)
+                return nullptr;
         }
 
-        TransactionChunk *tc = unusedTc;
-        unusedTc = unusedTc->next;
+        TransactionChunk *tc = unusedTc[TRANSACTION_CHUNK_CLASSES - 1];
+        unusedTc[TRANSACTION_CHUNK_CLASSES - 1] = tc->next;
+        if (tc->next != nullptr)
+            tc->next->prev = nullptr;
+        tc->next = nullptr;
+        --freeBuffers;
+        return tc;
+    }
 
-        if (unusedTc == nullptr) {
+    void TransactionBuffer::carveSlab(OracleReader *oracleReader, uint64_t sizeClass) {
+        TransactionChunk *slab = getSlab();
+        if (slab == nullptr) {
             cerr << "ERROR: out of transaction buffer, you can increase the redo-buffer-mb parameter" << endl;
             oracleReader->dumpTransactions();
             throw MemoryException("out of memory");
         }
 
-        unusedTc->prev = nullptr;
+        slab->slabUsed = 0;
+        for (uint64_t pos = 0; pos + chunkSize[sizeClass] <= redoBufferSize; pos += chunkSize[sizeClass]) {
+            TransactionChunk *tc = new TransactionChunk(slab, sizeClass, chunkSize[sizeClass], slab->buffer + pos);
+            if (tc == nullptr) {
+                cerr << "ERROR: out of memory for transaction buffer, for size: " << dec << redoBuffers << endl;
+                throw MemoryException("out of memory");
+            }
+            tc->sibling = slab->sibling;
+            slab->sibling = tc;
+            tc->next = unusedTc[sizeClass];
+            if (unusedTc[sizeClass] != nullptr)
+                unusedTc[sizeClass]->prev = tc;
+            unusedTc[sizeClass] = tc;
+        }
+
+        slab->prev = nullptr;
+        slab->next = carvedTc[sizeClass];
+        if (carvedTc[sizeClass] != nullptr)
+            carvedTc[sizeClass]->prev = slab;
+        carvedTc[sizeClass] = slab;
+    }
+
+    //return completely unused carved slabs back to the full size list
+    void TransactionBuffer::reclaimSlabs(void) {
+        for (uint64_t i = 0; i < TRANSACTION_CHUNK_CLASSES - 1; ++i) {
+            TransactionChunk *slab = carvedTc[i];
+            while (slab != nullptr) {
+                TransactionChunk *nextSlab = slab->next;
+                if (slab->slabUsed == 0) {
+                    while (slab->sibling != nullptr) {
+                        TransactionChunk *tc = slab->sibling;
+                        slab->sibling = tc->sibling;
+                        if (unusedTc[i] == tc)
+                            unusedTc[i] = tc->next;
+                        delete tc;
+                    }
+
+                    if (carvedTc[i] == slab)
+                        carvedTc[i] = slab->next;
+                    if (slab->prev != nullptr)
+                        slab->prev->next = slab->next;
+                    if (slab->next != nullptr)
+                        slab->next->prev = slab->prev;
+
+                    slab->prev = nullptr;
+                    slab->next = unusedTc[TRANSACTION_CHUNK_CLASSES - 1];
+                    if (unusedTc[TRANSACTION_CHUNK_CLASSES - 1] != nullptr)
+                        unusedTc[TRANSACTION_CHUNK_CLASSES - 1]->prev = slab;
+                    unusedTc[TRANSACTION_CHUNK_CLASSES - 1] = slab;
+                    ++freeBuffers;
+                }
+                slab = nextSlab;
+            }
+        }
+    }
+
+    TransactionChunk *TransactionBuffer::newTransactionChunk(OracleReader *oracleReader, uint64_t sizeClass) {
+        TransactionChunk *tc;
+        if (sizeClass == TRANSACTION_CHUNK_CLASSES - 1) {
+            tc = getSlab();
+            if (tc == nullptr) {
+                cerr << "ERROR: out of transaction buffer, you can increase the redo-buffer-mb parameter" << endl;
+                oracleReader->dumpTransactions();
+                throw MemoryException("out of memory");
+            }
+        } else {
+            if (unusedTc[sizeClass] == nullptr)
+                carveSlab(oracleReader, sizeClass);
+
+            tc = unusedTc[sizeClass];
+            unusedTc[sizeClass] = tc->next;
+            if (tc->next != nullptr)
+                tc->next->prev = nullptr;
+            ++tc->slab->slabUsed;
+        }
+
+        tc->prev = nullptr;
         tc->next = nullptr;
         tc->size = 0;
         tc->elements = 0;
-
-        --freeBuffers;
-
+        usedSize += tc->capacity;
         return tc;
     }
 
     void TransactionBuffer::deleteTransactionChunk(TransactionChunk* tc) {
-        ++freeBuffers;
+        usedSize -= tc->capacity;
+        if (tc->slab != nullptr)
+            --tc->slab->slabUsed;
+        else
+            ++freeBuffers;
 
         tc->prev = nullptr;
-        tc->next = unusedTc;
-        unusedTc->prev = tc;
-        unusedTc = tc;
+        tc->next = unusedTc[tc->sizeClass];
+        if (unusedTc[tc->sizeClass] != nullptr)
+            unusedTc[tc->sizeClass]->prev = tc;
+        unusedTc[tc->sizeClass] = tc;
     }
 
-    bool TransactionBuffer::addTransactionChunk(OracleReader *oracleReader, TransactionChunk* &lastTc, typeobj objn, typeobj objd,
+    bool TransactionBuffer::addTransactionChunk(OracleReader *oracleReader, TransactionChunk* &firstTc, TransactionChunk* &lastTc, typeobj objn, typeobj objd,
             typeuba uba, typedba dba, typeslt slt, typerci rci, RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2) {
 
-        if (redoLogRecord1->length + redoLogRecord2->length + ROW_HEADER_TOTAL > redoBufferSize) {
+        uint64_t length = redoLogRecord1->length + redoLogRecord2->length + ROW_HEADER_TOTAL;
+        if (length > redoBufferSize) {
             cerr << "ERROR: block size (" << dec << (redoLogRecord1->length + redoLogRecord2->length + ROW_HEADER_TOTAL)
                     << ") exceeding redo buffer size (" << redoBufferSize << "), try increasing the redo-buffer-size parameter" << endl;
             oracleReader->dumpTransactions();
@@ -147,8 +269,8 @@ namespace OpenLogReplicator {
 
                 if (pos < tc->size) {
                     //does the block need to be divided
-                    if (tc->size + redoLogRecord1->length + redoLogRecord2->length + ROW_HEADER_TOTAL > redoBufferSize) {
-                        TransactionChunk *tmpTc = newTransactionChunk(oracleReader);
+                    if (tc->size + length > tc->capacity) {
+                        TransactionChunk *tmpTc = newTransactionChunk(oracleReader, getSizeClass(tc->size - pos));
                         tmpTc->elements = elementsSkipped;
                         tmpTc->size = tc->size - pos;
                         tmpTc->prev = tc;
@@ -177,12 +299,22 @@ namespace OpenLogReplicator {
                 }
 
                 //new block needed
-                if (tc->size + redoLogRecord1->length + redoLogRecord2->length + ROW_HEADER_TOTAL > redoBufferSize) {
-                    TransactionChunk *tcNew = newTransactionChunk(oracleReader);
-                    tcNew->prev = tc;
+                if (tc->size + length > tc->capacity) {
+                    TransactionChunk *tcNew = newTransactionChunk(oracleReader, getSizeClass(length));
                     tcNew->next = tc->next;
                     tc->next->prev = tcNew;
-                    tc->next = tcNew;
+                    if (tc->elements == 0) {
+                        //chunk emptied by division is too small, replace it
+                        tcNew->prev = tc->prev;
+                        if (tc->prev != nullptr)
+                            tc->prev->next = tcNew;
+                        else
+                            firstTc = tcNew;
+                        deleteTransactionChunk(tc);
+                    } else {
+                        tcNew->prev = tc;
+                        tc->next = tcNew;
+                    }
                     tc = tcNew;
                 }
                 appendTransactionChunk(tc, objn, objd, uba, dba, slt, rci, redoLogRecord1, redoLogRecord2);
@@ -192,12 +324,20 @@ namespace OpenLogReplicator {
         }
 
         //new block needed
-        if (lastTc->size + redoLogRecord1->length + redoLogRecord2->length + ROW_HEADER_TOTAL > redoBufferSize) {
-            TransactionChunk *tcNew = newTransactionChunk(oracleReader);
-            tcNew->prev = lastTc;
-            tcNew->elements = 0;
-            tcNew->size = 0;
-            lastTc->next = tcNew;
+        if (lastTc->size + length > lastTc->capacity) {
+            TransactionChunk *tcNew = newTransactionChunk(oracleReader, nextSizeClass(lastTc, length));
+            if (lastTc->elements == 0) {
+                //empty chunk is too small, replace it with a bigger one
+                tcNew->prev = lastTc->prev;
+                if (lastTc->prev != nullptr)
+                    lastTc->prev->next = tcNew;
+                if (firstTc == lastTc)
+                    firstTc = tcNew;
+                deleteTransactionChunk(lastTc);
+            } else {
+                tcNew->prev = lastTc;
+                lastTc->next = tcNew;
+            }
             lastTc = tcNew;
         }
         appendTransactionChunk(lastTc, objn, objd, uba, dba, slt, rci, redoLogRecord1, redoLogRecord2);
@@ -342,15 +482,60 @@ namespace OpenLogReplicator {
 
     void TransactionBuffer::deleteTransactionChunks(TransactionChunk* startTc, TransactionChunk* endTc) {
         TransactionChunk* tc = startTc;
-        ++freeBuffers;
-        while (tc->next != nullptr) {
-            ++freeBuffers;
-            tc = tc->next;
+        while (tc != nullptr) {
+            TransactionChunk* nextTc = tc->next;
+            deleteTransactionChunk(tc);
+            if (tc == endTc)
+                break;
+            tc = nextTc;
+        }
+    }
+
+    //drop rows which were already output, restTc and restPos point to the first row which is kept
+    void TransactionBuffer::releaseTransactionChunks(TransactionChunk* &firstTc, TransactionChunk* restTc, uint64_t restPos, uint64_t restElements) {
+        while (firstTc != restTc) {
+            TransactionChunk* nextTc = firstTc->next;
+            deleteTransactionChunk(firstTc);
+            firstTc = nextTc;
+        }
+        firstTc->prev = nullptr;
+
+        if (restPos > 0) {
+            memmove(restTc->buffer, restTc->buffer + restPos, restTc->size - restPos);
+            restTc->size -= restPos;
+            restTc->elements -= restElements;
+        }
+    }
+
+    //transaction objects are allocated in slabs and reused
+    Transaction* TransactionBuffer::newTransaction(OracleReader *oracleReader, typexid xid) {
+        if (unusedTransactions == nullptr) {
+            uint8_t *slab = (uint8_t*)malloc(sizeof(Transaction) * (TRANSACTIONS_PER_SLAB + 1));
+            if (slab == nullptr) {
+                cerr << "ERROR: out of memory for transactions, for size: " << dec << (sizeof(Transaction) * (TRANSACTIONS_PER_SLAB + 1)) << endl;
+                throw MemoryException("out of memory");
+            }
+            //first element is used to chain the slabs
+            *((uint8_t**)slab) = transactionSlabs;
+            transactionSlabs = slab;
+
+            for (uint64_t i = 1; i <= TRANSACTIONS_PER_SLAB; ++i) {
+                uint8_t *element = slab + sizeof(Transaction) * i;
+                *((uint8_t**)element) = unusedTransactions;
+                unusedTransactions = element;
+            }
         }
 
-        endTc->next = unusedTc;
-        unusedTc->prev = endTc;
-        unusedTc = startTc;
+        uint8_t *element = unusedTransactions;
+        unusedTransactions = *((uint8_t**)element);
+        return new (element) Transaction(oracleReader, xid, this);
+    }
+
+    void TransactionBuffer::deleteTransaction(Transaction *transaction) {
+        transaction->~Transaction();
+        uint8_t *element = (uint8_t*)transaction;
+        *((uint8_t**)element) = unusedTransactions;
+        unusedTransactions = element;
     }
 
     TransactionBuffer::~TransactionBuffer() {
@@ -359,10 +544,31 @@ namespace OpenLogReplicator {
             copyTc = nullptr;
         }
 
-        while (unusedTc != nullptr) {
-            TransactionChunk *tc = unusedTc->next;
-            delete unusedTc;
-            unusedTc = tc;
+        for (uint64_t i = 0; i < TRANSACTION_CHUNK_CLASSES - 1; ++i) {
+            while (carvedTc[i] != nullptr) {
+                TransactionChunk *slab = carvedTc[i];
+                carvedTc[i] = slab->next;
+                while (slab->sibling != nullptr) {
+                    TransactionChunk *tc = slab->sibling;
+                    slab->sibling = tc->sibling;
+                    delete tc;
+                }
+                delete slab;
+            }
+            unusedTc[i] = nullptr;
+        }
+
+        while (unusedTc[TRANSACTION_CHUNK_CLASSES - 1] != nullptr) {
+            TransactionChunk *tc = unusedTc[TRANSACTION_CHUNK_CLASSES - 1]->next;
+            delete unusedTc[TRANSACTION_CHUNK_CLASSES - 1];
+            unusedTc[TRANSACTION_CHUNK_CLASSES - 1] = tc;
+        }
+
+        while (transactionSlabs != nullptr) {
+            uint8_t *slab = *((uint8_t**)transactionSlabs);
+            free(transactionSlabs);
+            transactionSlabs = slab;
         }
+        unusedTransactions = nullptr;
     }
 }
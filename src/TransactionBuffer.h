@@ -18,6 +18,7 @@ along with Open Log Replicator; see the file LICENSE.txt  If not see
 <http://www.gnu.org/licenses/>.  */
 
 #include "types.h"
+#include "TransactionChunk.h"
 
 #ifndef TRANSACTIONBUFFER_H_
 #define TRANSACTIONBUFFER_H_
@@ -37,26 +38,40 @@ along with Open Log Replicator; see the file LICENSE.txt  If not see
 #define ROW_HEADER_SCN      (sizeof(typeop2)+sizeof(struct RedoLogRecord)+sizeof(struct RedoLogRecord)+sizeof(typeobj)+sizeof(typeobj)+sizeof(uint64_t)+sizeof(uint32_t)+sizeof(typedba)+sizeof(typeuba))
 #define ROW_HEADER_TOTAL    (sizeof(typeop2)+sizeof(struct RedoLogRecord)+sizeof(struct RedoLogRecord)+sizeof(typeobj)+sizeof(typeobj)+sizeof(uint64_t)+sizeof(uint32_t)+sizeof(typedba)+sizeof(typeuba)+sizeof(typescn))
 
+#define TRANSACTIONS_PER_SLAB 256
+
 namespace OpenLogReplicator {
 
     class OracleReader;
+    class Transaction;
     class TransactionChunk;
     class RedoLogRecord;
 
     class TransactionBuffer {
     protected:
-        TransactionChunk *unusedTc;
+        TransactionChunk *unusedTc[TRANSACTION_CHUNK_CLASSES];
+        TransactionChunk *carvedTc[TRANSACTION_CHUNK_CLASSES];
+        uint64_t chunkSize[TRANSACTION_CHUNK_CLASSES];
         TransactionChunk *copyTc;
         uint64_t redoBufferSize;
+        uint64_t allocatedBuffers;
+        uint8_t *unusedTransactions;
+        uint8_t *transactionSlabs;
 
+        TransactionChunk* getSlab(void);
+        void carveSlab(OracleReader *oracleReader, uint64_t sizeClass);
+        void reclaimSlabs(void);
+        uint64_t nextSizeClass(TransactionChunk *tc, uint64_t size);
         void appendTransactionChunk(TransactionChunk* tc, typeobj objn, typeobj objd, typeuba uba, typedba dba,
                 uint8_t slt, uint8_t rci, RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2);
     public:
         uint64_t freeBuffers;
         uint64_t redoBuffers;
+        uint64_t usedSize;
 
-        TransactionChunk* newTransactionChunk(OracleReader *oracleReader);
-        bool addTransactionChunk(OracleReader *oracleReader, TransactionChunk* &lastTc, typeobj objn, typeobj objd, typeuba uba, typedba dba,
+        uint64_t getSizeClass(uint64_t size);
+        TransactionChunk* newTransactionChunk(OracleReader *oracleReader, uint64_t sizeClass);
+        bool addTransactionChunk(OracleReader *oracleReader, TransactionChunk* &firstTc, TransactionChunk* &lastTc, typeobj objn, typeobj objd, typeuba uba, typedba dba,
                 uint8_t slt, uint8_t rci, RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2);
         void rollbackTransactionChunk(OracleReader *oracleReader, TransactionChunk* &lastTc, typeuba &lastUba, typedba &lastDba,
                 uint8_t &lastSlt, uint8_t &lastRci);
@@ -65,6 +80,9 @@ namespace OpenLogReplicator {
                 uint64_t opFlags);
         void deleteTransactionChunk(TransactionChunk* tc);
         void deleteTransactionChunks(TransactionChunk* startTc, TransactionChunk* endTc);
+        void releaseTransactionChunks(TransactionChunk* &firstTc, TransactionChunk* restTc, uint64_t restPos, uint64_t restElements);
+        Transaction* newTransaction(OracleReader *oracleReader, typexid xid);
+        void deleteTransaction(Transaction *transaction);
 
         TransactionBuffer(uint64_t redoBuffers, uint64_t redoBufferSize);
         virtual ~TransactionBuffer();
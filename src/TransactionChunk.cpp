@@ -26,8 +26,13 @@ namespace OpenLogReplicator {
     TransactionChunk::TransactionChunk(TransactionChunk *prev, uint64_t redoBufferSize) :
             elements(0),
             size(0),
+            sizeClass(TRANSACTION_CHUNK_CLASSES - 1),
+            capacity(redoBufferSize),
             prev(prev),
-            next(nullptr) {
+            next(nullptr),
+            slab(nullptr),
+            sibling(nullptr),
+            slabUsed(0) {
         if (prev != nullptr) {
             prev->next = this;
         }
@@ -39,8 +44,22 @@ namespace OpenLogReplicator {
         }
     }
 
+    TransactionChunk::TransactionChunk(TransactionChunk *slab, uint64_t sizeClass, uint64_t capacity, uint8_t *buffer) :
+            elements(0),
+            size(0),
+            sizeClass(sizeClass),
+            capacity(capacity),
+            buffer(buffer),
+            prev(nullptr),
+            next(nullptr),
+            slab(slab),
+            sibling(nullptr),
+            slabUsed(0) {
+    }
+
     TransactionChunk::~TransactionChunk() {
-        free(buffer);
+        if (slab == nullptr)
+            free(buffer);
         if (prev != nullptr)
             prev->next = next;
         if (next != nullptr)
@@ -22,17 +22,28 @@ along with Open Log Replicator; see the file LICENSE.txt  If not see
 #ifndef TRANSACTIONCHUNK_H_
 #define TRANSACTIONCHUNK_H_
 
+//chunk size classes, each class is 4 times bigger then previous, the last one is redo-buffer-size
+#define TRANSACTION_CHUNK_CLASSES       4
+#define TRANSACTION_CHUNK_CLASS_SHIFT   2
+
 namespace OpenLogReplicator {
 
     class TransactionChunk {
     public:
         uint64_t elements;
         uint64_t size;
+        uint64_t sizeClass;
+        uint64_t capacity;
         uint8_t *buffer;
         TransactionChunk *prev;
         TransactionChunk *next;
+        //smaller chunks are carved from full size chunks (slabs)
+        TransactionChunk *slab;
+        TransactionChunk *sibling;
+        uint64_t slabUsed;
 
         TransactionChunk(TransactionChunk *prev, uint64_t redoBufferSize);
+        TransactionChunk(TransactionChunk *slab, uint64_t sizeClass, uint64_t capacity, uint8_t *buffer);
         virtual ~TransactionChunk();
     };
 }
@@ -23,115 +23,104 @@ along with Open Log Replicator; see the file LICENSE.txt  If not see
 #include "MemoryException.h"
 #include "Transaction.h"
 
+#define HEAPKEYLESS(a,b)        ((a).scn < (b).scn || ((a).scn == (b).scn && (a).xid < (b).xid))
+
 using namespace std;
 
 namespace OpenLogReplicator {
 
+    //committed transactions ordered by commit SCN
     void TransactionHeap::pop() {
-        pop((uint64_t)1);
-    }
-
-    void TransactionHeap::pop(uint64_t pos) {
-        if (pos > heapSize) {
-            cerr << "ERROR: pop of non existent transaction from heap pos: " << dec << pos << ", heapSize: " << heapSize << endl;
+        if (heapSize == 0) {
+            cerr << "ERROR: pop of non existent transaction from heap" << endl;
             throw MemoryException("heap inconsistency");
         }
 
+        uint64_t pos = 1;
+        TransactionHeapKey &last = heap[heapSize];
         while ((pos << 1) < heapSize) {
-            if (*heap[pos << 1] < *heap[heapSize]) {
-                if ((pos << 1) + 1 < heapSize && *heap[(pos << 1) + 1] < *heap[pos << 1]) {
-                    heap[pos] = heap[(pos << 1) + 1];
-                    heap[pos]->pos = pos;
-                    pos = (pos << 1) + 1;
-                } else {
-                    heap[pos] = heap[pos << 1];
-                    heap[pos]->pos = pos;
-                    pos = pos << 1;
-                }
-            } else
-            if ((pos << 1) + 1 < heapSize && *heap[(pos << 1) + 1] < *heap[heapSize]) {
-                heap[pos] = heap[(pos << 1) + 1];
-                heap[pos]->pos = pos;
-                pos = (pos << 1) + 1;
-            } else
+            uint64_t child = pos << 1;
+            if (child + 1 < heapSize && HEAPKEYLESS(heap[child + 1], heap[child]))
+                ++child;
+            if (!HEAPKEYLESS(heap[child], last))
                 break;
+            heap[pos] = heap[child];
+            pos = child;
         }
 
-        heap[pos] = heap[heapSize];
-        heap[pos]->pos = pos;
+        heap[pos] = last;
         --heapSize;
     }
 
     Transaction *TransactionHeap::top() {
         if (heapSize > 0)
-            return heap[1];
+            return heap[1].transaction;
         else
             return nullptr;
     }
 
-    uint64_t TransactionHeap::add(Transaction *transaction) {
-        if (heapSize + 1 == heapMaxSize) {
-            cerr << "ERROR: transactions heap exceeded: " << heapSize << ", you can try to increase max-concurrent-transactions parameter" << endl;
-            for (uint64_t i = 1; i <= heapSize; ++i) {
-                cout << "[" << dec << i << "]: " << *heap[i] << endl;
+    //open transactions are not ordered
+    void TransactionHeap::add(Transaction *transaction) {
+        if (openSize + heapSize + 1 >= heapMaxSize) {
+            cerr << "ERROR: transactions heap exceeded: " << dec << (openSize + heapSize) << ", you can try to increase max-concurrent-transactions parameter" << endl;
+            for (uint64_t i = 0; i < size(); ++i) {
+                cout << "[" << dec << i << "]: " << *at(i) << endl;
             }
             throw MemoryException("out of memory");
         }
 
+        open[openSize] = transaction;
+        transaction->pos = openSize;
+        ++openSize;
+    }
+
+    void TransactionHeap::erase(Transaction *transaction) {
+        uint64_t pos = transaction->pos;
+        if (pos >= openSize || open[pos] != transaction) {
+            cerr << "ERROR: erase of non existent transaction pos: " << dec << pos << ", openSize: " << openSize << endl;
+            throw MemoryException("heap inconsistency");
+        }
+
+        --openSize;
+        open[pos] = open[openSize];
+        open[pos]->pos = pos;
+    }
+
+    void TransactionHeap::commit(Transaction *transaction) {
+        erase(transaction);
+
+        TransactionHeapKey key;
+        key.scn = transaction->lastScn;
+        key.xid = transaction->xid;
+        key.transaction = transaction;
+
         uint64_t pos = heapSize + 1;
         ++heapSize;
-
-        while (pos > 1 && *transaction < *heap[pos >> 1]) {
+        while (pos > 1 && HEAPKEYLESS(key, heap[pos >> 1])) {
             heap[pos] = heap[pos >> 1];
-            heap[pos]->pos = pos;
             pos >>= 1;
         }
-        heap[pos] = transaction;
-        heap[pos]->pos = pos;
-        return pos;
+        heap[pos] = key;
     }
 
-    void TransactionHeap::update(uint64_t pos) {
-        if (pos > heapSize) {
-            cerr << "ERROR: update of non existent transaction pos: " << dec << pos << ", heapSize: " << heapSize << endl;
-            throw MemoryException("heap inconsistency");
-        }
-
-        Transaction *transaction = heap[pos];
-        while (true) {
-            if ((pos << 1) < heapSize && *heap[pos << 1] < *transaction) {
-                if ((pos << 1) + 1 < heapSize && *heap[(pos << 1) + 1] < *heap[pos << 1]) {
-                    heap[pos] = heap[(pos << 1) + 1];
-                    heap[pos]->pos = pos;
-                    pos = (pos << 1) + 1;
-                } else {
-                    heap[pos] = heap[pos << 1];
-                    heap[pos]->pos = pos;
-                    pos <<= 1;
-                }
-            } else
-            if ((pos << 1) + 1 < heapSize && *heap[(pos << 1) + 1] < *transaction) {
-                heap[pos] = heap[(pos << 1) + 1];
-                heap[pos]->pos = pos;
-                pos = (pos << 1) + 1;
-            } else
-            if (pos > 1 && *transaction < *heap[pos >> 1]) {
-                heap[pos] = heap[pos >> 1];
-                heap[pos]->pos = pos;
-                pos >>= 1;
-            } else
-                break;
-        }
+    uint64_t TransactionHeap::size() {
+        return openSize + heapSize;
+    }
 
-        heap[pos] = transaction;
-        heap[pos]->pos = pos;
+    //open transactions first, then committed
+    Transaction *TransactionHeap::at(uint64_t pos) {
+        if (pos < openSize)
+            return open[pos];
+        return heap[pos - openSize + 1].transaction;
     }
 
     TransactionHeap::TransactionHeap(uint64_t heapMaxSize) :
         heapMaxSize(heapMaxSize),
-        heapSize(0) {
-        heap = new Transaction*[heapMaxSize];
-        if (heap == nullptr) {
+        heapSize(0),
+        openSize(0) {
+        heap = new TransactionHeapKey[heapMaxSize];
+        open = new Transaction*[heapMaxSize];
+        if (heap == nullptr || open == nullptr) {
             cerr << "ERROR: can't allocate transaction heap, for size: " << dec << heapMaxSize << endl;
             throw MemoryException("out of memory");
         }
@@ -142,5 +131,9 @@ namespace OpenLogReplicator {
             delete[] heap;
             heap = nullptr;
         }
+        if (open != nullptr) {
+            delete[] open;
+            open = nullptr;
+        }
     }
 }
@@ -26,17 +26,27 @@ namespace OpenLogReplicator {
 
     class Transaction;
 
+    struct TransactionHeapKey {
+        typescn scn;
+        typexid xid;
+        Transaction *transaction;
+    };
+
     class TransactionHeap {
     public:
         uint64_t heapMaxSize;
         uint64_t heapSize;
-        Transaction **heap;
+        uint64_t openSize;
+        TransactionHeapKey *heap;
+        Transaction **open;
 
         void pop();
-        void pop(uint64_t pos);
         Transaction *top();
-        uint64_t add(Transaction *element);
-        void update(uint64_t pos);
+        void add(Transaction *transaction);
+        void erase(Transaction *transaction);
+        void commit(Transaction *transaction);
+        uint64_t size();
+        Transaction *at(uint64_t pos);
 
         TransactionHeap(uint64_t heapMaxSize);
         virtual ~TransactionHeap();
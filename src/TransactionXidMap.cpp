@@ -0,0 +1,152 @@
+/* Open addressing hash map of transactions by XID
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <iostream>
+#include <iomanip>
+#include <string.h>
+#include "MemoryException.h"
+#include "TransactionXidMap.h"
+
+using namespace std;
+
+namespace OpenLogReplicator {
+
+    TransactionXidEntry* TransactionXidMap::find(typexid xid) {
+        uint64_t pos = XIDHASHINGFUNCTION(xid);
+
+        while (hashMap[pos].used) {
+            if (hashMap[pos].xid == xid)
+                return hashMap + pos;
+            pos = (pos + 1) & hashMask;
+        }
+
+        return nullptr;
+    }
+
+    Transaction* TransactionXidMap::get(typexid xid) {
+        TransactionXidEntry *entry = find(xid);
+        if (entry == nullptr)
+            return nullptr;
+        return entry->transaction;
+    }
+
+    TransactionXidEntry* TransactionXidMap::add(typexid xid) {
+        uint64_t pos = XIDHASHINGFUNCTION(xid);
+
+        while (hashMap[pos].used) {
+            if (hashMap[pos].xid == xid)
+                return hashMap + pos;
+            pos = (pos + 1) & hashMask;
+        }
+
+        //keep at least half of the slots empty for short probe sequences
+        if ((elements + 1) * 2 > capacity) {
+            cerr << "ERROR: transactions map exceeded: " << dec << elements << ", you can try to increase max-concurrent-transactions parameter" << endl;
+            throw MemoryException("out of memory");
+        }
+
+        hashMap[pos].xid = xid;
+        hashMap[pos].transaction = nullptr;
+        hashMap[pos].beginScn = ZERO_SCN;
+        hashMap[pos].beginSequence = 0;
+        hashMap[pos].used = true;
+        ++elements;
+        ++markers;
+        return hashMap + pos;
+    }
+
+    void TransactionXidMap::set(typexid xid, Transaction *transaction) {
+        TransactionXidEntry *entry = add(xid);
+        if (entry->transaction == nullptr)
+            --markers;
+        entry->transaction = transaction;
+    }
+
+    void TransactionXidMap::setBegin(typexid xid, typescn scn, typeseq sequence) {
+        TransactionXidEntry *entry = add(xid);
+        if (entry->beginSequence == 0 || entry->beginSequence > sequence)
+            entry->beginSequence = sequence;
+        if (entry->beginScn == ZERO_SCN || entry->beginScn > scn)
+            entry->beginScn = scn;
+    }
+
+    void TransactionXidMap::erase(typexid xid) {
+        uint64_t pos = XIDHASHINGFUNCTION(xid);
+
+        while (hashMap[pos].used) {
+            if (hashMap[pos].xid == xid)
+                break;
+            pos = (pos + 1) & hashMask;
+        }
+
+        if (!hashMap[pos].used) {
+            cerr << "ERROR: transaction does not exists in xid map: " << PRINTXID(xid) << endl;
+            return;
+        }
+        if (hashMap[pos].transaction == nullptr)
+            --markers;
+
+        //shift back following entries of the probe sequence
+        uint64_t next = (pos + 1) & hashMask;
+        while (hashMap[next].used) {
+            uint64_t home = XIDHASHINGFUNCTION(hashMap[next].xid);
+            if (((next - home) & hashMask) >= ((next - pos) & hashMask)) {
+                hashMap[pos] = hashMap[next];
+                pos = next;
+            }
+            next = (next + 1) & hashMask;
+        }
+
+        memset(hashMap + pos, 0, sizeof(TransactionXidEntry));
+        --elements;
+    }
+
+    Transaction* TransactionXidMap::at(uint64_t pos) {
+        return hashMap[pos].transaction;
+    }
+
+    TransactionXidEntry* TransactionXidMap::entryAt(uint64_t pos) {
+        return hashMap + pos;
+    }
+
+    TransactionXidMap::TransactionXidMap(uint64_t maxConcurrentTransactions) :
+        hashBits(1),
+        elements(0),
+        markers(0) {
+
+        while ((1ULL << hashBits) < maxConcurrentTransactions * 2)
+            ++hashBits;
+        capacity = 1ULL << hashBits;
+        hashMask = capacity - 1;
+
+        hashMap = new TransactionXidEntry[capacity];
+        if (hashMap == nullptr) {
+            cerr << "ERROR: unable allocate memory for Transaction xid map(" << dec << maxConcurrentTransactions << ")" << endl;
+            throw MemoryException("out of memory");
+        }
+        memset(hashMap, 0, sizeof(TransactionXidEntry) * capacity);
+    }
+
+    TransactionXidMap::~TransactionXidMap() {
+        if (hashMap != nullptr) {
+            delete[] hashMap;
+            hashMap = nullptr;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+/* Header for TransactionXidMap class
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include "types.h"
+
+#ifndef TRANSACTIONXIDMAP_H_
+#define TRANSACTIONXIDMAP_H_
+
+#define XIDHASHINGFUNCTION(xid)     (((xid)*0x9E3779B97F4A7C15ULL)>>(64-hashBits))
+
+namespace OpenLogReplicator {
+
+    class Transaction;
+
+    //transaction is created on first tracked change, until then only begin position is kept
+    struct TransactionXidEntry {
+        typexid xid;
+        Transaction *transaction;
+        typescn beginScn;
+        typeseq beginSequence;
+        bool used;
+    };
+
+    class TransactionXidMap {
+    protected:
+        uint64_t hashBits;
+        uint64_t hashMask;
+        TransactionXidEntry *hashMap;
+
+        TransactionXidEntry* add(typexid xid);
+
+    public:
+        uint64_t elements;
+        uint64_t markers;
+        uint64_t capacity;
+
+        TransactionXidEntry* find(typexid xid);
+        Transaction* get(typexid xid);
+        void set(typexid xid, Transaction *transaction);
+        void setBegin(typexid xid, typescn scn, typeseq sequence);
+        void erase(typexid xid);
+        Transaction* at(uint64_t pos);
+        TransactionXidEntry* entryAt(uint64_t pos);
+
+        TransactionXidMap(uint64_t maxConcurrentTransactions);
+        virtual ~TransactionXidMap();
+    };
+}
+
+#endif
@@ -41,9 +41,18 @@ namespace OpenLogReplicator {
         singleDml(singleDml),
         nullColumns(nullColumns),
         test(test),
-        timestampFormat(timestampFormat) {
+        timestampFormat(timestampFormat),
+        cursor(0),
+        dmlNo(0) {
     }
 
     Writer::~Writer() {
     }
+
+    //targets sharing one output buffer receive messages formatted by the first of them
+    bool Writer::sameFormat(Writer *writer) {
+        return stream == writer->stream && sortColumns == writer->sortColumns && metadata == writer->metadata &&
+                singleDml == writer->singleDml && nullColumns == writer->nullColumns && test == writer->test &&
+                timestampFormat == writer->timestampFormat;
+    }
 }
@@ -48,16 +48,25 @@ namespace OpenLogReplicator {
         uint64_t timestampFormat;   //0 - timestamp in ISO 8601 format, 1 - timestamp in Unix epoch format
 
     public:
+        uint64_t cursor;            //position of this writer in the output buffer
+        uint64_t dmlNo;             //position of the last dml in the open message, advanced by next()
+
         void stop(void);
         virtual void *run() = 0;
         uint64_t initialize();
+        bool sameFormat(Writer *writer);
         virtual void beginTran(typescn scn, typetime time, typexid xid) = 0;
         virtual void next() = 0;
         virtual void commitTran() = 0;
+        virtual void beginBatch(typescn scn, typexid xid, uint64_t batch) = 0;
+        virtual void commitBatches(typescn scn, typetime time, typexid xid, uint64_t batches) = 0;
+        virtual void rollbackBatches(typescn scn, typexid xid, uint64_t batches) = 0;
+        virtual void retractDml(typescn scn, typexid xid, uint64_t batch, uint64_t first, uint64_t last) = 0;
         virtual void parseInsertMultiple(RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2) = 0;
         virtual void parseDeleteMultiple(RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2) = 0;
         virtual void parseDML(RedoLogRecord *redoLogRecord1, RedoLogRecord *redoLogRecord2, uint64_t type) = 0;
         virtual void parseDDL(RedoLogRecord *redoLogRecord1) = 0;
+        virtual Writer* newFormatter(CommandBuffer *commandBuffer) = 0;
 
         Writer(const string alias, OracleReader *oracleReader, uint64_t stream, uint64_t sortColumns, uint64_t metadata, uint64_t singleDml, uint64_t nullColumns,
                 uint64_t test, uint64_t timestampFormat);
@@ -50,6 +50,11 @@ typedef uint32_t typeseq;
 
 #define STREAM_JSON                 1
 #define STREAM_DBZ_JSON             2
+#define STREAM_AVRO                 3
+#define STREAM_ARROW                4
+
+#define SHARD_BY_TABLE              1
+#define SHARD_BY_KEY                2
 
 #define TRACE_NO                    0
 #define TRACE_WARN                  1
@@ -117,16 +122,27 @@ namespace OpenLogReplicator {
             return *this;
         }
 
+        //days since 1970-01-01 in the proleptic Gregorian calendar, days past the end of a month roll over to the next one
+        static int64_t daysFromCivil(int64_t year, uint64_t month, uint64_t day) {
+            if (month <= 2)
+                --year;
+            int64_t era = (year >= 0 ? year : year - 399) / 400;
+            uint64_t yoe = (uint64_t)(year - era * 400);
+            uint64_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+            uint64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+            return era * 146097 + (int64_t)doe - 719468;
+        }
+
+        //seconds since epoch, time is taken as UTC
         time_t toTime() {
-            struct tm epochtime;
             uint64_t rest = val;
-            epochtime.tm_sec = rest % 60; rest /= 60;
-            epochtime.tm_min = rest % 60; rest /= 60;
-            epochtime.tm_hour = rest % 24; rest /= 24;
-            epochtime.tm_mday = (rest % 31) + 1; rest /= 31;
-            epochtime.tm_mon = (rest % 12); rest /= 12;
-            epochtime.tm_year = rest + 88;
-            return mktime(&epochtime);
+            uint64_t ss = rest % 60; rest /= 60;
+            uint64_t mi = rest % 60; rest /= 60;
+            uint64_t hh = rest % 24; rest /= 24;
+            uint64_t dd = (rest % 31) + 1; rest /= 31;
+            uint64_t mm = (rest % 12) + 1; rest /= 12;
+            uint64_t yy = rest + 1988;
+            return daysFromCivil(yy, mm, dd) * 86400 + hh * 3600 + mi * 60 + ss;
         }
 
         friend ostream& operator<<(ostream& os, const typetime& time) {
@@ -148,4 +164,7 @@ namespace OpenLogReplicator {
 
 #define CHECKPOINT_SIZE 12
 
+#define SCHEMA_MAGIC                0x4F4C5253
+#define SCHEMA_VERSION              1
+
 #endif
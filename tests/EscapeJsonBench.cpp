@@ -0,0 +1,124 @@
+/* Benchmark of JSON string escaping
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include "CommandBuffer.h"
+#include "OracleReader.h"
+
+using namespace std;
+using namespace OpenLogReplicator;
+
+namespace OpenLogReplicator {
+    //CommandBuffer.o refers to it for dates, linking OracleReader.o would need the Oracle client
+    uint32_t OracleReader::read32Big(const uint8_t* buf) {
+        return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) |
+                ((uint32_t)buf[2] << 8) | (uint32_t)buf[3];
+    }
+}
+
+//one byte at a time, same output as escapeJson
+uint64_t escapeBytes(uint8_t *out, const uint8_t *text, uint64_t length) {
+    uint8_t *pos = out;
+
+    for (uint64_t i = 0; i < length; ++i) {
+        switch (text[i]) {
+        case '\b': *pos++ = '\\'; *pos++ = 'b'; break;
+        case '\t': *pos++ = '\\'; *pos++ = 't'; break;
+        case '\n': *pos++ = '\\'; *pos++ = 'n'; break;
+        case '\f': *pos++ = '\\'; *pos++ = 'f'; break;
+        case '\r': *pos++ = '\\'; *pos++ = 'r'; break;
+        case '"':
+        case '\\':
+        case '/':
+            *pos++ = '\\';
+            *pos++ = text[i];
+            break;
+        default:
+            *pos++ = text[i];
+        }
+    }
+
+    return pos - out;
+}
+
+void run(const char *name, const uint8_t *text, uint64_t length, uint64_t rounds) {
+    vector<uint8_t> out(2 * length + 1);
+    uint64_t sum = 0;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (uint64_t r = 0; r < rounds; ++r) {
+        sum += escapeBytes(out.data(), text, length);
+        __asm__ __volatile__("" : : "r"(out.data()) : "memory");
+    }
+    chrono::steady_clock::time_point bytesEnd = chrono::steady_clock::now();
+    for (uint64_t r = 0; r < rounds; ++r) {
+        sum += CommandBuffer::escapeJson(out.data(), text, length);
+        __asm__ __volatile__("" : : "r"(out.data()) : "memory");
+    }
+    chrono::steady_clock::time_point jsonEnd = chrono::steady_clock::now();
+
+    double bytes = chrono::duration<double, nano>(bytesEnd - start).count() / rounds,
+           json = chrono::duration<double, nano>(jsonEnd - bytesEnd).count() / rounds;
+    cout << name << " " << dec << length << " bytes: byte loop " << bytes << " ns, escapeJson " << json << " ns, " <<
+            bytes / json << "x (" << (sum & 0xFF) << ")" << endl;
+}
+
+int main(int argc, char **argv) {
+    uint64_t rounds = 2000000, errors = 0;
+    mt19937_64 rng(1);
+    uint8_t text[4096], out1[8192], out2[8192];
+
+    if (argc > 1)
+        rounds = strtoull(argv[1], nullptr, 10);
+
+    //random text with escaped characters at random places, every length and alignment of the blocks
+    for (uint64_t i = 0; i < 200000; ++i) {
+        uint64_t length = rng() % 300;
+        for (uint64_t j = 0; j < length; ++j)
+            text[j] = (rng() % 16 == 0) ? "\"\\/\b\t\n\f\r\x01\x1F\x7F\xC4"[rng() % 12] : ' ' + rng() % 95;
+        uint64_t length1 = escapeBytes(out1, text, length), length2 = CommandBuffer::escapeJson(out2, text, length);
+        if (length1 != length2 || memcmp(out1, out2, length1) != 0)
+            ++errors;
+    }
+    if (errors > 0) {
+        cerr << "ERROR: escapeJson output differs from the byte loop for " << dec << errors << " strings" << endl;
+        return 1;
+    }
+
+    const char *samples[] = {
+            "John Smith",
+            "1600 Pennsylvania Avenue NW, Washington, DC 20500",
+            "Order shipped via UPS/ground, tracking 1Z999AA10123456784",
+            "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua.\n"
+            "Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip ex ea commodo consequat."
+    };
+    for (uint64_t i = 0; i < sizeof(samples) / sizeof(samples[0]); ++i)
+        run("text", (const uint8_t*)samples[i], strlen(samples[i]), rounds);
+
+    for (uint64_t j = 0; j < 4000; ++j)
+        text[j] = ' ' + rng() % 95;
+    run("random", text, 4000, rounds / 20);
+
+    return 0;
+}
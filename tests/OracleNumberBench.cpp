@@ -0,0 +1,115 @@
+/* Benchmark of Oracle NUMBER conversions
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <stdlib.h>
+#include "OracleNumber.h"
+
+using namespace std;
+using namespace OpenLogReplicator;
+
+#define VALUES 4096
+
+struct Number {
+    uint8_t data[22];
+    uint64_t length;
+};
+
+//integer of the given number of base 100 digits, optionally with 2 decimal places
+void makeNumber(mt19937_64 &rng, Number &number, uint64_t digits, bool money) {
+    bool negative = (rng() % 10) == 0;
+    uint64_t length = 1;
+
+    for (uint64_t i = 0; i < digits + (money ? 1 : 0); ++i) {
+        uint64_t val = rng() % 100;
+        if (i == 0 && val == 0)
+            val = 1 + rng() % 99;
+        number.data[length++] = negative ? 101 - val : val + 1;
+    }
+    //no trailing 00 digit
+    while (length > 2 && number.data[length - 1] == (negative ? 101 : 1))
+        --length;
+
+    if (negative) {
+        number.data[0] = 0x3E - (digits - 1);
+        number.data[length++] = 0x66;
+    } else
+        number.data[0] = 0xC1 + (digits - 1);
+    number.length = length;
+}
+
+void run(const char *name, vector<Number> &numbers, uint64_t rounds) {
+    char text[NUMBER_TEXT_MAX];
+    uint64_t sum = 0, scale;
+    typedec128 value;
+    int64_t value64;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (uint64_t r = 0; r < rounds; ++r)
+        for (uint64_t i = 0; i < VALUES; ++i)
+            sum += OracleNumber::toText(numbers[i].data, numbers[i].length, text) + text[0];
+    chrono::steady_clock::time_point textEnd = chrono::steady_clock::now();
+    for (uint64_t r = 0; r < rounds; ++r)
+        for (uint64_t i = 0; i < VALUES; ++i)
+            sum += OracleNumber::textLength(numbers[i].data, numbers[i].length);
+    chrono::steady_clock::time_point lengthEnd = chrono::steady_clock::now();
+    for (uint64_t r = 0; r < rounds; ++r)
+        for (uint64_t i = 0; i < VALUES; ++i)
+            if (OracleNumber::toDecimal128(numbers[i].data, numbers[i].length, value, scale))
+                sum += (uint64_t)value + scale;
+    chrono::steady_clock::time_point decimalEnd = chrono::steady_clock::now();
+    for (uint64_t r = 0; r < rounds; ++r)
+        for (uint64_t i = 0; i < VALUES; ++i)
+            if (OracleNumber::toInt64(numbers[i].data, numbers[i].length, value64))
+                sum += value64;
+    chrono::steady_clock::time_point int64End = chrono::steady_clock::now();
+
+    double count = rounds * VALUES;
+    cout << name << ": toText " << chrono::duration<double, nano>(textEnd - start).count() / count << " ns" <<
+            ", textLength " << chrono::duration<double, nano>(lengthEnd - textEnd).count() / count << " ns" <<
+            ", toDecimal128 " << chrono::duration<double, nano>(decimalEnd - lengthEnd).count() / count << " ns" <<
+            ", toInt64 " << chrono::duration<double, nano>(int64End - decimalEnd).count() / count << " ns" <<
+            " (" << (sum & 0xFF) << ")" << endl;
+}
+
+int main(int argc, char **argv) {
+    uint64_t rounds = 2000;
+    mt19937_64 rng(1);
+    vector<Number> numbers(VALUES);
+
+    if (argc > 1)
+        rounds = strtoull(argv[1], nullptr, 10);
+
+    for (uint64_t i = 0; i < VALUES; ++i)
+        makeNumber(rng, numbers[i], 1 + rng() % 5, false);
+    run("id", numbers, rounds);
+
+    for (uint64_t i = 0; i < VALUES; ++i)
+        makeNumber(rng, numbers[i], 1 + rng() % 4, true);
+    run("amount", numbers, rounds);
+
+    for (uint64_t i = 0; i < VALUES; ++i)
+        makeNumber(rng, numbers[i], 15 + rng() % 5, true);
+    run("long", numbers, rounds);
+
+    return 0;
+}
@@ -0,0 +1,219 @@
+/* Randomized cross-check of Oracle NUMBER conversions
+   Copyright (C) 2018-2020 Adam Leszczynski.
+
+This file is part of Open Log Replicator.
+
+Open Log Replicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+Open Log Replicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Open Log Replicator; see the file LICENSE.txt  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <string.h>
+#include <stdlib.h>
+#include "OracleNumber.h"
+
+using namespace std;
+using namespace OpenLogReplicator;
+
+//slow conversion straight from the base 100 digits, used as the reference for toText
+string referenceText(const uint8_t *data, uint64_t length) {
+    if (length == 1 && data[0] == 0x80)
+        return "0";
+
+    bool negative = data[0] < 0x80;
+    int64_t exponent = negative ? 0x3E - ((int64_t)data[0]) : ((int64_t)data[0]) - 0xC1;
+    uint64_t digits = length - 1;
+    if (negative && data[length - 1] == 0x66)
+        --digits;
+
+    string all;
+    for (uint64_t i = 1; i <= digits; ++i) {
+        uint64_t val = negative ? 101 - data[i] : data[i] - 1;
+        all += (char)('0' + val / 10);
+        all += (char)('0' + val % 10);
+    }
+
+    string intPart, fracPart;
+    if (exponent >= 0) {
+        uint64_t intLength = (exponent + 1) * 2;
+        while (all.length() < intLength)
+            all += '0';
+        intPart = all.substr(0, intLength);
+        fracPart = all.substr(intLength);
+    } else {
+        intPart = "0";
+        fracPart = string((-exponent - 1) * 2, '0') + all;
+    }
+
+    while (intPart.length() > 1 && intPart[0] == '0')
+        intPart.erase(0, 1);
+    while (fracPart.length() > 0 && fracPart[fracPart.length() - 1] == '0')
+        fracPart.erase(fracPart.length() - 1);
+
+    return (negative ? "-" : "") + intPart + (fracPart.length() > 0 ? "." + fracPart : "");
+}
+
+string decimalText(typedec128 value, uint64_t scale) {
+    bool negative = value < 0;
+    string text;
+
+    if (negative)
+        value = -value;
+    do {
+        text.insert(text.begin(), (char)('0' + (int)(value % 10)));
+        value /= 10;
+    } while (value > 0);
+
+    if (scale > 0) {
+        while (text.length() <= scale)
+            text.insert(text.begin(), '0');
+        text.insert(text.length() - scale, ".");
+    }
+
+    return (negative ? "-" : "") + text;
+}
+
+//canonical value as written by the database: no leading or trailing 00 digit, 0x66 terminator for short negative values
+uint64_t randomNumber(mt19937_64 &rng, uint8_t *data) {
+    uint64_t digits = 1 + rng() % 20, length = digits + 1;
+    bool negative = (rng() & 1) != 0;
+    int64_t exponent = ((int64_t)(rng() % 127)) - 65;
+
+    for (uint64_t i = 1; i <= digits; ++i) {
+        uint64_t val = rng() % 100;
+        if ((i == 1 || i == digits) && val == 0)
+            val = 1 + rng() % 99;
+        data[i] = negative ? 101 - val : val + 1;
+    }
+
+    if (negative) {
+        data[0] = 0x3E - exponent;
+        if (digits < 20)
+            data[length++] = 0x66;
+    } else
+        data[0] = 0xC1 + exponent;
+
+    return length;
+}
+
+uint64_t checkNumber(const uint8_t *data, uint64_t length, bool canonical) {
+    char text[NUMBER_TEXT_MAX + 1];
+    uint64_t textLength = OracleNumber::textLength(data, length),
+             written = OracleNumber::toText(data, length, text),
+             errors = 0;
+    text[written] = 0;
+
+    if (textLength != written) {
+        cerr << "ERROR: textLength " << dec << textLength << " but toText wrote " << written << " characters: " << text << endl;
+        ++errors;
+    }
+    if (written > NUMBER_TEXT_MAX) {
+        cerr << "ERROR: text longer than NUMBER_TEXT_MAX: " << text << endl;
+        ++errors;
+    }
+    if (canonical) {
+        string reference = referenceText(data, length);
+        if (reference.compare(text) != 0) {
+            cerr << "ERROR: toText: " << text << ", expected: " << reference << endl;
+            ++errors;
+        }
+    }
+
+    typedec128 value;
+    uint64_t scale;
+    if (OracleNumber::toDecimal128(data, length, value, scale)) {
+        if (written == 0) {
+            cerr << "ERROR: toDecimal128 accepted a value rejected by toText" << endl;
+            ++errors;
+        } else if (decimalText(value, scale).compare(text) != 0) {
+            cerr << "ERROR: toDecimal128: " << decimalText(value, scale) << ", toText: " << text << endl;
+            ++errors;
+        }
+
+        int64_t value64;
+        if (OracleNumber::toInt64(data, length, value64)) {
+            if (scale > 0 || to_string(value64).compare(text) != 0) {
+                cerr << "ERROR: toInt64: " << value64 << ", toText: " << text << endl;
+                ++errors;
+            }
+        } else if (scale == 0 && value <= (typedec128)INT64_MAX && value >= (typedec128)INT64_MIN) {
+            cerr << "ERROR: toInt64 rejected " << text << endl;
+            ++errors;
+        }
+    } else if (canonical) {
+        //every value below 10^36 fits
+        string unscaled;
+        for (uint64_t j = 0; j < written; ++j)
+            if (text[j] >= '0' && text[j] <= '9' && (unscaled.length() > 0 || text[j] != '0'))
+                unscaled += text[j];
+        if (unscaled.length() <= 36) {
+            cerr << "ERROR: toDecimal128 rejected " << text << endl;
+            ++errors;
+        }
+    }
+
+    return errors;
+}
+
+int main(int argc, char **argv) {
+    uint64_t iterations = 2000000, seed = 1, errors = 0, i;
+    uint8_t data[24];
+
+    if (argc > 1)
+        iterations = strtoull(argv[1], nullptr, 10);
+    if (argc > 2)
+        seed = strtoull(argv[2], nullptr, 10);
+    mt19937_64 rng(seed);
+
+    //known values
+    const struct { uint8_t data[4]; uint64_t length; const char *text; } known[] = {
+        {{0x80}, 1, "0"},
+        {{0xC1, 0x02}, 2, "1"},
+        {{0xC2, 0x02, 0x18}, 3, "123"},
+        {{0xC3, 0x02}, 2, "10000"},
+        {{0xC1, 0x02, 0x33}, 3, "1.5"},
+        {{0xC0, 0x33}, 2, "0.5"},
+        {{0xBF, 0x0B}, 2, "0.001"},
+        {{0x3E, 0x60, 0x66}, 3, "-5"},
+        {{0x3F, 0x33, 0x66}, 3, "-0.5"}
+    };
+    for (i = 0; i < sizeof(known) / sizeof(known[0]); ++i) {
+        char text[NUMBER_TEXT_MAX + 1];
+        uint64_t written = OracleNumber::toText(known[i].data, known[i].length, text);
+        text[written] = 0;
+        if (strcmp(text, known[i].text) != 0) {
+            cerr << "ERROR: toText: " << text << ", expected: " << known[i].text << endl;
+            ++errors;
+        }
+        errors += checkNumber(known[i].data, known[i].length, true);
+    }
+
+    for (i = 0; i < iterations && errors < 100; ++i) {
+        uint64_t length;
+        if (i % 8 == 7) {
+            //any bytes, only the conversions have to agree
+            length = 1 + rng() % 22;
+            for (uint64_t j = 0; j < length; ++j)
+                data[j] = rng();
+            errors += checkNumber(data, length, false);
+        } else {
+            length = randomNumber(rng, data);
+            errors += checkNumber(data, length, true);
+        }
+    }
+
+    cout << "checked: " << dec << i << " seed: " << seed << " errors: " << errors << endl;
+    return errors > 0 ? 1 : 0;
+}